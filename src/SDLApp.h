@@ -1,6 +1,15 @@
 /*
     SDLApp.h - SDL2 + ImGui Application Framework
     Encapsulates all SDL2 and ImGui initialization, rendering, and cleanup
+
+    Define ENGINE_HEADLESS for builds that have no SDL2 library to link
+    against (benchmarks, build machines): the windowed paths compile out and
+    only InitHeadless() is usable. SDL headers are still needed for types.
+
+    Presenting is paced by presentMode: vsync, adaptive vsync (on while
+    frames keep up with the display, off once they fall behind, so a slow
+    frame tears instead of waiting a whole extra refresh), capped to
+    fpsCap without vsync, or uncapped.
 */
 
 #pragma once
@@ -13,6 +22,8 @@
 #include "imgui_impl_sdl2.h"
 #include "imgui_impl_sdlrenderer2.h"
 
+#include "core/framebuffer.h"
+
 // ============== Color Structure ==============
 struct Color {
     Uint8 r = 255, g = 255, b = 255, a = 255;
@@ -31,6 +42,11 @@ struct Color {
     Color operator*(float f) const {
         return Color((Uint8)(r * f), (Uint8)(g * f), (Uint8)(b * f), a);
     }
+
+    // Pack into the framebuffer's 0xAARRGGBB layout
+    Uint32 Pack() const {
+        return ((Uint32)a << 24) | ((Uint32)r << 16) | ((Uint32)g << 8) | (Uint32)b;
+    }
 };
 
 // ============== SDL Application Class ==============
@@ -38,10 +54,30 @@ class SDLApp {
 public:
     SDL_Window* window = nullptr;
     SDL_Renderer* renderer = nullptr;
+    SDL_Texture* frameTexture = nullptr;    // Streaming texture of the window's size, frames are uploaded here
+    Framebuffer framebuffer;                // All drawing goes into this CPU buffer
+    bool headless = false;                  // No window/renderer, framebuffer only
     int screenWidth = 1024;
     int screenHeight = 960;
     float deltaTime = 0.0f;
     bool running = true;
+    Uint64 lastFrameTime = 0;               // Performance counter at the last BeginUI()
+    int pendingWidth = 0, pendingHeight = 0;    // Window resize not yet applied
+
+    // Presentation and frame pacing
+    enum PresentMode { PRESENT_VSYNC, PRESENT_ADAPTIVE, PRESENT_CAPPED, PRESENT_UNCAPPED, PRESENT_MODE_COUNT };
+    int presentMode = PRESENT_VSYNC;
+    int fpsCap = 60;
+    int refreshRate = 60;                       // Of the window's display, Hz
+    bool vsyncOn = true;                        // What the renderer currently does
+    Uint64 nextPresent = 0;                     // Capped mode: performance counter deadline
+    Uint64 lastPresent = 0;
+    int adaptiveVotes = 0;                      // Frames in a row that asked to flip vsync
+
+    static const char* const* PresentModeNames() {
+        static const char* const names[PRESENT_MODE_COUNT] = {"VSync", "Adaptive VSync", "Capped", "Uncapped"};
+        return names;
+    }
     
     // Keyboard state
     const Uint8* keyState = nullptr;
@@ -49,7 +85,10 @@ public:
     bool Init(const std::string& title, int width = 1024, int height = 960) {
         screenWidth = width;
         screenHeight = height;
-        
+#ifdef ENGINE_HEADLESS
+        (void)title;
+        return false;
+#else
         if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
             SDL_Log("SDL_Init Error: %s", SDL_GetError());
             return false;
@@ -63,6 +102,8 @@ public:
         renderer = SDL_CreateRenderer(window, -1, 
             SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
         if (!renderer) return false;
+        SDL_DisplayMode mode;
+        if (SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0) refreshRate = mode.refresh_rate;
         
         // Initialize ImGui
         IMGUI_CHECKVERSION();
@@ -73,108 +114,189 @@ public:
         ImGui_ImplSDL2_InitForSDLRenderer(window, renderer);
         ImGui_ImplSDLRenderer2_Init(renderer);
         
+        framebuffer.Resize(screenWidth, screenHeight);
+        if (!CreateFrameTexture()) return false;
+
         keyState = SDL_GetKeyboardState(NULL);
         return true;
+#endif
+    }
+
+    // Framebuffer-only setup: no SDL video, no ImGui, nothing is presented.
+    // The caller drives BeginFrame/EndFrame and reads framebuffer.pixels.
+    bool InitHeadless(int width, int height) {
+        headless = true;
+        screenWidth = width;
+        screenHeight = height;
+        framebuffer.Resize(screenWidth, screenHeight);
+        static const Uint8 noKeys[SDL_NUM_SCANCODES] = {};
+        keyState = noKeys;
+        return true;
+    }
+
+    bool CreateFrameTexture() {
+#ifdef ENGINE_HEADLESS
+        return false;
+#else
+        if (frameTexture) SDL_DestroyTexture(frameTexture);
+        frameTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING, screenWidth, screenHeight);
+        if (!frameTexture) {
+            SDL_Log("SDL_CreateTexture Error: %s", SDL_GetError());
+            return false;
+        }
+        SDL_SetTextureBlendMode(frameTexture, SDL_BLENDMODE_NONE);
+        SDL_SetTextureScaleMode(frameTexture, SDL_ScaleModeLinear);     // Frames below window size are stretched
+        return true;
+#endif
+    }
+
+    void Resize(int width, int height) {
+        screenWidth = width;
+        screenHeight = height;
+        framebuffer.Resize(screenWidth, screenHeight);
+        if (!headless) CreateFrameTexture();
     }
     
+    // Resizes are only recorded here; ApplyResize() carries them out once
+    // nothing is drawing into the framebuffer
     void ProcessEvents() {
+        if (headless) return;
+#ifndef ENGINE_HEADLESS
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
             ImGui_ImplSDL2_ProcessEvent(&event);
             if (event.type == SDL_QUIT) running = false;
             if (event.type == SDL_WINDOWEVENT && 
                 event.window.event == SDL_WINDOWEVENT_RESIZED) {
-                screenWidth = event.window.data1;
-                screenHeight = event.window.data2;
+                pendingWidth = event.window.data1;
+                pendingHeight = event.window.data2;
             }
         }
+#endif
+    }
+
+    // Sleep until an event arrives or timeoutMs passed (idle main loop).
+    // The time slept does not count towards the next deltaTime.
+    void WaitEvent(int timeoutMs) {
+        if (headless) return;
+#ifdef ENGINE_HEADLESS
+        (void)timeoutMs;
+#else
+        SDL_WaitEventTimeout(NULL, timeoutMs);
+        lastFrameTime = SDL_GetPerformanceCounter();
+#endif
+    }
+
+    // Returns true if the size changed
+    bool ApplyResize() {
+        if (!pendingWidth) return false;
+        Resize(pendingWidth, pendingHeight);
+        pendingWidth = pendingHeight = 0;
+        return true;
     }
     
-    void BeginFrame() {
-        static Uint64 lastTime = SDL_GetPerformanceCounter();
+    // Frame timing and a new ImGui frame; the framebuffer is cleared by its user
+    void BeginUI() {
+        if (headless) return;   // deltaTime is set by the caller
+#ifndef ENGINE_HEADLESS
         Uint64 currentTime = SDL_GetPerformanceCounter();
-        deltaTime = (float)(currentTime - lastTime) / SDL_GetPerformanceFrequency();
-        lastTime = currentTime;
+        if (!lastFrameTime) lastFrameTime = currentTime;
+        deltaTime = (float)(currentTime - lastFrameTime) / SDL_GetPerformanceFrequency();
+        lastFrameTime = currentTime;
         
         ImGui_ImplSDLRenderer2_NewFrame();
         ImGui_ImplSDL2_NewFrame();
         ImGui::NewFrame();
-        
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
+#endif
     }
     
-    void EndFrame() {
+    // Show `frame` (framebuffer or a finished copy, at most the window's
+    // size) with the UI on top; a smaller frame is stretched over the
+    // window. changed = false: the texture still holds frame, only the UI
+    // is drawn again.
+    void Present(const Framebuffer& frame, bool changed = true) {
+        if (headless) return;
+#ifdef ENGINE_HEADLESS
+        (void)frame; (void)changed;
+#else
+
+        // One upload + one copy per frame for everything the engine drew,
+        // into the texture's top-left corner and from there over the window
+        SDL_Rect area = {0, 0, frame.width, frame.height};
+        if (changed) SDL_UpdateTexture(frameTexture, &area, frame.pixels.data(), frame.Pitch());
+        SDL_RenderCopy(renderer, frameTexture, &area, NULL);
+
         ImGui::Render();
         ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData(), renderer);
+        PaceFrame();
         SDL_RenderPresent(renderer);
+#endif
+    }
+
+    void SetVSync(bool on) {
+        if (on == vsyncOn) return;
+#ifndef ENGINE_HEADLESS
+        if (SDL_RenderSetVSync(renderer, on ? 1 : 0) == 0) vsyncOn = on;
+#endif
+    }
+
+    // Before each present: switch vsync for the mode, and in capped mode
+    // wait for the next deadline (sleeping, then spinning the last ms)
+    void PaceFrame() {
+#ifndef ENGINE_HEADLESS
+        Uint64 freq = SDL_GetPerformanceFrequency();
+        Uint64 now = SDL_GetPerformanceCounter();
+        double interval = lastPresent ? (double)(now - lastPresent) / freq : 0.0;
+        lastPresent = now;
+        switch (presentMode) {
+        case PRESENT_VSYNC:
+            SetVSync(true);
+            break;
+        case PRESENT_UNCAPPED:
+            SetVSync(false);
+            break;
+        case PRESENT_CAPPED: {
+            SetVSync(false);
+            Uint64 period = freq / std::max(fpsCap, 1);
+            if (now > nextPresent + period) nextPresent = now;     // Fell behind, don't catch up
+            while (now < nextPresent) {
+                Uint32 ms = (Uint32)((nextPresent - now) * 1000 / freq);
+                if (ms > 1) SDL_Delay(ms - 1);
+                now = SDL_GetPerformanceCounter();
+            }
+            nextPresent += period;
+            lastPresent = now;
+            break;
+        }
+        case PRESENT_ADAPTIVE: {
+            // Missing a refresh with vsync shows as ~2 periods; 8 frames in a row flip it
+            double period = 1.0 / refreshRate;
+            bool flip = vsyncOn ? interval > period * 1.5 : interval > 0 && interval < period * 0.9;
+            adaptiveVotes = flip ? adaptiveVotes + 1 : 0;
+            if (adaptiveVotes >= 8) {
+                SetVSync(!vsyncOn);
+                adaptiveVotes = 0;
+            }
+            break;
+        }
+        }
+#endif
     }
     
     void Cleanup() {
+        if (headless) return;
+#ifndef ENGINE_HEADLESS
         ImGui_ImplSDLRenderer2_Shutdown();
         ImGui_ImplSDL2_Shutdown();
         ImGui::DestroyContext();
+        SDL_DestroyTexture(frameTexture);
         SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
         SDL_Quit();
+#endif
     }
     
-    // Drawing functions
-    void DrawPixel(int x, int y, const Color& c) {
-        SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
-        SDL_RenderDrawPoint(renderer, x, y);
-    }
-    
-    void DrawLine(int x1, int y1, int x2, int y2, const Color& c) {
-        SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
-        SDL_RenderDrawLine(renderer, x1, y1, x2, y2);
-    }
-    
-    void DrawTriangle(int x1, int y1, int x2, int y2, int x3, int y3, const Color& c) {
-        DrawLine(x1, y1, x2, y2, c);
-        DrawLine(x2, y2, x3, y3, c);
-        DrawLine(x3, y3, x1, y1, c);
-    }
-
-    void FillTriangle(int x1, int y1, int x2, int y2, int x3, int y3, const Color& c) {
-        // Sort vertices by y
-        if (y2 < y1) { std::swap(y1, y2); std::swap(x1, x2); }
-        if (y3 < y1) { std::swap(y1, y3); std::swap(x1, x3); }
-        if (y3 < y2) { std::swap(y2, y3); std::swap(x2, x3); }
-
-        SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
-
-        auto drawScanline = [&](int sy, int ax, int bx) {
-            if (ax > bx) std::swap(ax, bx);
-            SDL_RenderDrawLine(renderer, ax, sy, bx, sy);
-        };
-
-        int dy1 = y2 - y1, dx1 = x2 - x1;
-        int dy2 = y3 - y1, dx2 = x3 - x1;
-        float dax_step = 0, dbx_step = 0;
-        if (dy1) dax_step = dx1 / (float)abs(dy1);
-        if (dy2) dbx_step = dx2 / (float)abs(dy2);
-
-        if (dy1) {
-            for (int i = y1; i <= y2; i++) {
-                int ax = x1 + (int)((float)(i - y1) * dax_step);
-                int bx = x1 + (int)((float)(i - y1) * dbx_step);
-                drawScanline(i, ax, bx);
-            }
-        }
-
-        dy1 = y3 - y2; dx1 = x3 - x2;
-        if (dy1) dax_step = dx1 / (float)abs(dy1);
-
-        if (dy1) {
-            for (int i = y2; i <= y3; i++) {
-                int ax = x2 + (int)((float)(i - y2) * dax_step);
-                int bx = x1 + (int)((float)(i - y1) * dbx_step);
-                drawScanline(i, ax, bx);
-            }
-        }
-    }
-
     // Key checking
     bool IsKeyDown(SDL_Scancode key) const { return keyState[key] != 0; }
 };
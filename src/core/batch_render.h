@@ -0,0 +1,230 @@
+/*
+    batch_render.h - Offline Image Sequences
+    Renders an animation without a window and writes every frame to an
+    image file (turntable renders): the object makes `turns` full turns
+    about its up axis over the sequence, everything else stays as set up
+    in the source engine.
+
+    A frame depends only on its number, so render threads each take whole
+    frames and draw them with their own Engine3D (rasterizing on one
+    thread, sharing the source engine's mesh and texture). Finished frames
+    wait in a bounded queue for the writer threads, which encode and save
+    them: writing overlaps rendering, and no more than queueDepth frames
+    are ever held in memory. Pixel buffers go back and forth between the
+    two sides instead of being copied.
+*/
+
+#pragma once
+
+#include "engine.h"
+#include "image_writer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BatchOptions {
+    std::string outDir = ".";        // Existing directory for frame_00000.png, ...
+    std::string format = "png";      // "png" or "ppm"
+    int frames = 120;
+    int width = 1920, height = 1080;
+    int threads = ThreadPool::HardwareThreads();   // Frames rendered at once
+    int writers = 2;                 // Threads encoding and writing files
+    int queueDepth = 0;              // Finished frames waiting for a writer, 0 = 2 per render thread
+    float turns = 1.0f;              // Full turns of the object over the sequence
+};
+
+struct BatchStats {
+    int framesWritten = 0;
+    size_t bytesWritten = 0;
+    double seconds = 0;              // Wall clock for the whole sequence
+    double renderSeconds = 0;        // Summed over render threads
+    double writeSeconds = 0;         // Encoding and writing, summed over writer threads
+    double stallSeconds = 0;         // Render threads waiting for room in the queue
+    std::string error;               // First failure, empty if all frames were written
+};
+
+// ============== Frame Queue ==============
+namespace batch {
+
+// FIFO of fixed capacity: Push() blocks while it is full, Pop() while it is
+// empty. After Close() pushes fail and Pop() hands out what is left.
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(std::max<size_t>(capacity, 1)) {}
+
+    bool Push(T&& item) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [&] { return closed || items.size() < capacity; });
+            if (closed) return false;
+            items.push_back(std::move(item));
+        }
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // False once the queue is closed and empty
+    bool Pop(T& item) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [&] { return closed || !items.empty(); });
+            if (items.empty()) return false;
+            item = std::move(items.front());
+            items.pop_front();
+        }
+        notFull.notify_one();
+        return true;
+    }
+
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable notFull, notEmpty;
+    bool closed = false;
+};
+
+struct Frame {
+    int index = 0;
+    std::vector<uint32_t> pixels;
+};
+
+inline double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace batch
+
+// ============== Batch Rendering ==============
+inline std::string Batch_FramePath(const BatchOptions& opt, int index) {
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%05d.", index);
+    return opt.outDir + "/" + name + opt.format;
+}
+
+// A headless engine drawing the same scene as `scene`. Mesh, levels of
+// detail, texture and points are shared read-only; only the buffers drawn
+// into (frame, depth, arena) belong to each engine.
+inline void Batch_SetupEngine(Engine3D& engine, const Engine3D& scene, int width, int height) {
+    engine.InitHeadless(width, height);
+    engine.SetMesh(scene.geometry, scene.levels);
+    engine.texture = scene.texture;
+    engine.SetPoints(scene.points);
+    static_cast<FrameSettings&>(engine) = scene.Settings();
+    engine.CreateInstanceGrid(scene.instanceCount);
+    engine.rasterThreads = 1;           // Parallel over frames instead
+    engine.occlusionCulling = false;    // The previous frame drawn is not the previous frame
+}
+
+// Render opt.frames frames of `scene` and write them. progress (optional)
+// is called with the number of frames written so far, one call at a time.
+inline bool Batch_Render(const Engine3D& scene, const BatchOptions& opt, BatchStats& stats,
+                         const std::function<void(int)>& progress = nullptr) {
+    using namespace batch;
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    stats = BatchStats();
+    if (opt.frames <= 0 || opt.width <= 0 || opt.height <= 0) {
+        stats.error = "Nothing to render";
+        return false;
+    }
+    bool png = opt.format == "png";
+    if (!png && opt.format != "ppm") {
+        stats.error = "Unknown image format: " + opt.format;
+        return false;
+    }
+
+    int nThreads = std::max(1, std::min(opt.threads, opt.frames));
+    int nWriters = std::max(1, opt.writers);
+    BoundedQueue<Frame> queue(opt.queueDepth > 0 ? opt.queueDepth : 2 * nThreads);
+    std::atomic<int> nextFrame{0};
+    std::atomic<bool> failed{false};
+    std::mutex mutex;                   // stats, spare buffers, progress calls
+    std::vector<std::vector<uint32_t>> spare;
+    size_t pixelCount = (size_t)opt.width * opt.height;
+
+    auto fail = [&](const std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stats.error.empty()) stats.error = error;
+        failed = true;
+    };
+
+    auto renderLoop = [&] {
+        Engine3D engine;
+        Batch_SetupEngine(engine, scene, opt.width, opt.height);
+        double render = 0, stall = 0;
+        int index;
+        while (!failed && (index = nextFrame++) < opt.frames) {
+            Clock::time_point t0 = Clock::now();
+            engine.BeginFrame();
+            engine.rotY = scene.rotY + 6.2831853f * opt.turns * index / opt.frames;
+            engine.instanceLod.clear();     // Levels of detail from this frame alone
+            engine.Render();
+            render += SecondsSince(t0);
+
+            // Hand the pixels over, keep drawing into a spare buffer
+            Frame frame;
+            frame.index = index;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!spare.empty()) { frame.pixels = std::move(spare.back()); spare.pop_back(); }
+            }
+            if (frame.pixels.size() != pixelCount) frame.pixels.assign(pixelCount, 0);
+            frame.pixels.swap(engine.app.framebuffer.pixels);
+            Clock::time_point t1 = Clock::now();
+            if (!queue.Push(std::move(frame))) break;
+            stall += SecondsSince(t1);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.renderSeconds += render;
+        stats.stallSeconds += stall;
+    };
+
+    auto writeLoop = [&] {
+        Frame frame;
+        std::vector<uint8_t> data;
+        while (queue.Pop(frame)) {
+            if (failed) continue;       // Drain so no render thread stays blocked
+            Clock::time_point t0 = Clock::now();
+            if (png) Image_EncodePng(frame.pixels.data(), opt.width, opt.height, data);
+            else Image_EncodePpm(frame.pixels.data(), opt.width, opt.height, data);
+            std::string error;
+            if (!imageio::WriteFile(Batch_FramePath(opt, frame.index).c_str(), data, error)) {
+                fail(error);
+                queue.Close();
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.writeSeconds += SecondsSince(t0);
+            stats.bytesWritten += data.size();
+            stats.framesWritten++;
+            spare.push_back(std::move(frame.pixels));
+            if (progress) progress(stats.framesWritten);
+        }
+    };
+
+    std::vector<std::thread> renderers, writers;
+    for (int i = 0; i < nWriters; i++) writers.emplace_back(writeLoop);
+    for (int i = 0; i < nThreads; i++) renderers.emplace_back(renderLoop);
+    for (auto& t : renderers) t.join();
+    queue.Close();
+    for (auto& t : writers) t.join();
+    stats.seconds = SecondsSince(start);
+    return !failed;
+}
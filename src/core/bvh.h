@@ -0,0 +1,378 @@
+/*
+    bvh.h - Bounding Volume Hierarchy
+    Axis-aligned box tree over arbitrary primitives (instances, mesh
+    chunks), built with the surface area heuristic and refittable when
+    primitives move. Traversal drops whole subtrees outside the frustum and
+    can drop subtrees hidden behind an occlusion buffer.
+
+    Nodes live in one array with the root at 0. An inner node's children
+    are stored next to each other after it, in the order of their
+    primitive ranges. Traversal visits the nearer child first, so leaves
+    come out roughly front to back, which suits hierarchical Z.
+
+    Mesh chunks: Mesh_BuildChunks() cuts a mesh into spatially compact
+    runs of triangles (reordering its triangles and vertices) and builds
+    the tree over them, so a frame only touches the chunks it can see.
+    Within a chunk, triangles are in vertex cache order.
+*/
+
+#pragma once
+
+#include "../math3d/math3d.h"
+#include "frustum.h"
+#include "mesh.h"
+#include "vertex_cache.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// ============== Boxes ==============
+struct Aabb {
+    vec3d min = {1e30f, 1e30f, 1e30f};
+    vec3d max = {-1e30f, -1e30f, -1e30f};
+};
+
+inline void Aabb_Grow(Aabb& box, const vec3d& p) {
+    box.min.x = std::min(box.min.x, p.x); box.max.x = std::max(box.max.x, p.x);
+    box.min.y = std::min(box.min.y, p.y); box.max.y = std::max(box.max.y, p.y);
+    box.min.z = std::min(box.min.z, p.z); box.max.z = std::max(box.max.z, p.z);
+}
+
+inline void Aabb_Grow(Aabb& box, const Aabb& other) {
+    Aabb_Grow(box, other.min);
+    Aabb_Grow(box, other.max);
+}
+
+inline Aabb Aabb_FromSphere(const vec3d& c, float r) {
+    Aabb box;
+    box.min = {c.x - r, c.y - r, c.z - r};
+    box.max = {c.x + r, c.y + r, c.z + r};
+    return box;
+}
+
+inline vec3d Aabb_Center(const Aabb& box) {
+    return {(box.min.x + box.max.x) * 0.5f, (box.min.y + box.max.y) * 0.5f, (box.min.z + box.max.z) * 0.5f};
+}
+
+// Half the surface area, enough for comparing SAH costs
+inline float Aabb_HalfArea(const Aabb& box) {
+    float dx = box.max.x - box.min.x, dy = box.max.y - box.min.y, dz = box.max.z - box.min.z;
+    if (dx < 0 || dy < 0 || dz < 0) return 0;
+    return dx * dy + dy * dz + dz * dx;
+}
+
+inline bool Aabb_Equal(const Aabb& a, const Aabb& b) {
+    return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z &&
+           a.max.x == b.max.x && a.max.y == b.max.y && a.max.z == b.max.z;
+}
+
+// ============== BVH ==============
+const int BVH_BINS = 12;            // SAH candidate planes per axis - 1
+const int BVH_MAX_DEPTH = 64;       // Traversal stack size; deeper subtrees become leaves
+
+struct BvhNode {
+    Aabb box;
+    uint32_t first = 0;     // Leaf: first entry in prims; inner: left child (right = first + 1)
+    uint32_t count = 0;     // Primitives in a leaf, 0 for inner nodes
+};
+
+struct Bvh {
+    std::vector<BvhNode> nodes;
+    std::vector<uint32_t> prims;        // Primitive indices, leaf ranges point here
+    std::vector<uint32_t> parent;       // Per node, root's is itself
+    std::vector<uint32_t> primLeaf;     // Leaf holding each primitive
+
+    size_t PrimCount() const { return prims.size(); }
+    bool Empty() const { return nodes.empty(); }
+
+    void Clear() {
+        nodes.clear(); prims.clear(); parent.clear(); primLeaf.clear();
+    }
+
+    // Build over `boxes` (one per primitive). Leaves hold at most maxLeaf
+    // primitives; with fillLeaves any node that fits becomes a leaf,
+    // otherwise only where splitting it does not pay off.
+    void Build(const std::vector<Aabb>& boxes, int maxLeaf, bool fillLeaves = false) {
+        Clear();
+        size_t n = boxes.size();
+        if (n == 0) return;
+        prims.resize(n);
+        for (size_t i = 0; i < n; i++) prims[i] = (uint32_t)i;
+        centers.resize(n);
+        for (size_t i = 0; i < n; i++) centers[i] = Aabb_Center(boxes[i]);
+        nodes.reserve(2 * n / std::max(maxLeaf, 1) + 1);
+        parent.reserve(nodes.capacity());
+        nodes.push_back(BvhNode());
+        parent.push_back(0);
+        leafSize = (uint32_t)std::max(maxLeaf, 1);
+        fillLeafNodes = fillLeaves;
+        Subdivide(boxes, 0, 0, (uint32_t)n, 0);
+        primLeaf.resize(n);
+        for (size_t i = 0; i < nodes.size(); i++)
+            for (uint32_t p = 0; p < nodes[i].count; p++) primLeaf[prims[nodes[i].first + p]] = (uint32_t)i;
+        std::vector<vec3d>().swap(centers);
+    }
+
+    // Recompute every node box for moved primitives, keeping the topology
+    void Refit(const std::vector<Aabb>& boxes) {
+        for (size_t i = nodes.size(); i-- > 0;) RefitNode(boxes, (uint32_t)i);
+    }
+
+    // Refit only the leaves of `changed` primitives and their ancestors
+    void Refit(const std::vector<Aabb>& boxes, const uint32_t* changed, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            uint32_t node = primLeaf[changed[i]];
+            while (true) {
+                Aabb old = nodes[node].box;
+                RefitNode(boxes, node);
+                if (node == 0 || Aabb_Equal(old, nodes[node].box)) break;
+                node = parent[node];
+            }
+        }
+    }
+
+    // Calls visit(prims, count, mask) for every leaf that intersects the
+    // frustum and is not `hidden(box)`, nearest first along the view
+    // direction (the near plane's normal); mask holds the frustum planes
+    // the leaf still crosses (0: fully inside). Returns the nodes visited.
+    template <class Hidden, class Visit>
+    size_t Query(const Frustum& frustum, Hidden&& hidden, Visit&& visit) const {
+        if (nodes.empty()) return 0;
+        struct Entry { uint32_t node; int mask; };
+        Entry stack[BVH_MAX_DEPTH + 1];
+        int top = 0;
+        stack[top++] = {0, FRUSTUM_ALL_PLANES};
+        size_t visited = 0;
+        while (top) {
+            Entry e = stack[--top];
+            const BvhNode& n = nodes[e.node];
+            visited++;
+            if (e.mask && !Frustum_BoxVisible(frustum, n.box.min, n.box.max, e.mask)) continue;
+            if (hidden(n.box)) continue;
+            if (n.count) {
+                visit(&prims[n.first], n.count, e.mask);
+                continue;
+            }
+            const Plane& front = frustum.planes[0];
+            uint32_t first = n.first, second = n.first + 1;
+            if (Plane_Dist(front, Aabb_Center(nodes[second].box)) < Plane_Dist(front, Aabb_Center(nodes[first].box)))
+                std::swap(first, second);
+            stack[top++] = {second, e.mask};
+            stack[top++] = {first, e.mask};
+        }
+        return visited;
+    }
+
+private:
+    // Build only
+    std::vector<vec3d> centers;
+    uint32_t leafSize = 1;
+    bool fillLeafNodes = false;
+
+    void RefitNode(const std::vector<Aabb>& boxes, uint32_t i) {
+        BvhNode& n = nodes[i];
+        Aabb box;
+        if (n.count) {
+            for (uint32_t p = 0; p < n.count; p++) Aabb_Grow(box, boxes[prims[n.first + p]]);
+        } else {
+            box = nodes[n.first].box;
+            Aabb_Grow(box, nodes[n.first + 1].box);
+        }
+        n.box = box;
+    }
+
+    void Subdivide(const std::vector<Aabb>& boxes, uint32_t node, uint32_t first, uint32_t count, int depth) {
+        Aabb box, centerBox;
+        for (uint32_t i = first; i < first + count; i++) {
+            Aabb_Grow(box, boxes[prims[i]]);
+            Aabb_Grow(centerBox, centers[prims[i]]);
+        }
+        nodes[node].box = box;
+        nodes[node].first = first;
+        nodes[node].count = count;
+        if (count <= 1 || depth >= BVH_MAX_DEPTH - 1) return;
+        if (fillLeafNodes && count <= leafSize) return;
+
+        // Binned SAH along the widest axis of the centers
+        float ext[3] = {centerBox.max.x - centerBox.min.x, centerBox.max.y - centerBox.min.y,
+                        centerBox.max.z - centerBox.min.z};
+        int axis = ext[0] >= ext[1] && ext[0] >= ext[2] ? 0 : ext[1] >= ext[2] ? 1 : 2;
+        float lo = axis == 0 ? centerBox.min.x : axis == 1 ? centerBox.min.y : centerBox.min.z;
+        auto coord = [&](uint32_t p) {
+            const vec3d& c = centers[p];
+            return axis == 0 ? c.x : axis == 1 ? c.y : c.z;
+        };
+
+        uint32_t mid = first + count / 2;
+        if (ext[axis] > 0) {
+            float scale = BVH_BINS / ext[axis];
+            auto binOf = [&](uint32_t p) { return std::min(BVH_BINS - 1, (int)((coord(p) - lo) * scale)); };
+            Aabb binBox[BVH_BINS];
+            uint32_t binCount[BVH_BINS] = {};
+            for (uint32_t i = first; i < first + count; i++) {
+                int b = binOf(prims[i]);
+                binCount[b]++;
+                Aabb_Grow(binBox[b], boxes[prims[i]]);
+            }
+            // Sweep from the right for the right-hand areas, then from the left
+            float rightArea[BVH_BINS];
+            uint32_t rightCount[BVH_BINS];
+            Aabb acc;
+            uint32_t sum = 0;
+            for (int b = BVH_BINS - 1; b > 0; b--) {
+                Aabb_Grow(acc, binBox[b]);
+                sum += binCount[b];
+                rightArea[b] = Aabb_HalfArea(acc);
+                rightCount[b] = sum;
+            }
+            float bestCost = 1e30f;
+            int bestSplit = 0;
+            acc = Aabb();
+            sum = 0;
+            for (int b = 1; b < BVH_BINS; b++) {
+                Aabb_Grow(acc, binBox[b - 1]);
+                sum += binCount[b - 1];
+                if (!sum || !rightCount[b]) continue;
+                float cost = Aabb_HalfArea(acc) * sum + rightArea[b] * rightCount[b];
+                if (cost < bestCost) { bestCost = cost; bestSplit = b; }
+            }
+            // Leaf if no split beats intersecting every primitive (one box test each)
+            if (count <= leafSize && bestCost >= Aabb_HalfArea(box) * (count - 1)) return;
+            if (bestSplit) {
+                uint32_t* split = std::partition(&prims[first], &prims[first] + count,
+                                                 [&](uint32_t p) { return binOf(p) < bestSplit; });
+                mid = (uint32_t)(split - prims.data());
+            } else {
+                std::nth_element(&prims[first], &prims[mid], &prims[first] + count,
+                                 [&](uint32_t a, uint32_t b) { return coord(a) < coord(b); });
+            }
+        } else if (count <= leafSize) {
+            return;     // All centers coincide, nothing to gain from splitting
+        }
+
+        uint32_t left = (uint32_t)nodes.size();
+        nodes.push_back(BvhNode());
+        nodes.push_back(BvhNode());
+        parent.push_back(node);
+        parent.push_back(node);
+        nodes[node].first = left;
+        nodes[node].count = 0;
+        Subdivide(boxes, left, first, mid - first, depth + 1);
+        Subdivide(boxes, left + 1, mid, first + count - mid, depth + 1);
+    }
+};
+
+// ============== Mesh Chunks ==============
+const int MESH_CHUNK_TRIS = 128;    // Triangles per chunk at most
+
+struct MeshChunk {
+    uint32_t triFirst, triCount;    // Triangle range
+    uint32_t vertFirst, vertEnd;    // Vertices this chunk uses first
+    uint32_t depFirst, depCount;    // Range in MeshChunks::deps
+};
+
+// Vertices are stored in chunk order, so chunk c owns the contiguous range
+// [vertFirst, vertEnd). Triangles on a chunk border also use vertices owned
+// by neighbours; those chunks are listed in deps and must be transformed too.
+struct MeshChunks {
+    std::vector<MeshChunk> chunks;
+    std::vector<uint32_t> deps;     // Chunks owning vertices a chunk borrows
+    Bvh bvh;                        // Over chunk bounds, one chunk per leaf
+
+    void Clear() { chunks.clear(); deps.clear(); bvh.Clear(); }
+};
+
+// Cut `mesh` into chunks of nearby triangles. Triangles are reordered so
+// each chunk is a contiguous range (in vertex cache order inside it), and
+// vertices by first use so each chunk owns a contiguous vertex range. The
+// shape is unchanged.
+inline void Mesh_BuildChunks(Mesh& mesh, MeshChunks& out) {
+    out.Clear();
+    size_t nTris = mesh.TriangleCount(), nVerts = mesh.VertexCount();
+    if (nTris == 0) return;
+
+    // Partition the triangles with a BVH whose leaves are the chunks
+    std::vector<Aabb> boxes(nTris);
+    for (size_t t = 0; t < nTris; t++)
+        for (int i = 0; i < 3; i++) Aabb_Grow(boxes[t], mesh.Vertex(mesh.indices[t * 3 + i]));
+    Bvh& bvh = out.bvh;
+    bvh.Build(boxes, MESH_CHUNK_TRIS, true);
+
+    // Leaves become chunks, numbered by triangle range
+    std::vector<uint32_t> leaves;
+    for (size_t i = 0; i < bvh.nodes.size(); i++)
+        if (bvh.nodes[i].count) leaves.push_back((uint32_t)i);
+    std::sort(leaves.begin(), leaves.end(),
+              [&](uint32_t a, uint32_t b) { return bvh.nodes[a].first < bvh.nodes[b].first; });
+
+    // Triangles in leaf order, vertices in order of first use
+    std::vector<uint32_t> indices(nTris * 3);
+    std::vector<uint32_t> remap(nVerts, UINT32_MAX), owner;
+    std::vector<uint32_t> localId(nVerts, UINT32_MAX), localVerts, localIndices, order;
+    std::vector<float> x, y, z, tu, tv;
+    x.reserve(nVerts); y.reserve(nVerts); z.reserve(nVerts);
+    bool hasUVs = mesh.HasUVs();
+    if (hasUVs) { tu.reserve(nVerts); tv.reserve(nVerts); }
+    owner.reserve(nVerts);
+    out.chunks.resize(leaves.size());
+    for (size_t c = 0; c < leaves.size(); c++) {
+        BvhNode& leaf = bvh.nodes[leaves[c]];
+        MeshChunk& chunk = out.chunks[c];
+        chunk.triFirst = leaf.first;
+        chunk.triCount = leaf.count;
+        chunk.vertFirst = (uint32_t)x.size();
+
+        // Cache order of the leaf's triangles, on chunk-local vertex ids
+        localVerts.clear();
+        localIndices.resize(leaf.count * 3);
+        for (uint32_t i = 0; i < leaf.count * 3; i++) {
+            uint32_t v = mesh.indices[bvh.prims[leaf.first + i / 3] * 3 + i % 3];
+            if (localId[v] == UINT32_MAX) {
+                localId[v] = (uint32_t)localVerts.size();
+                localVerts.push_back(v);
+            }
+            localIndices[i] = localId[v];
+        }
+        for (uint32_t v : localVerts) localId[v] = UINT32_MAX;
+        order.resize(leaf.count);
+        VertexCache_Order(localIndices.data(), leaf.count, localVerts.size(), order.data());
+
+        for (uint32_t t = leaf.first; t < leaf.first + leaf.count; t++) {
+            const uint32_t* src = &mesh.indices[bvh.prims[leaf.first + order[t - leaf.first]] * 3];
+            for (int i = 0; i < 3; i++) {
+                uint32_t v = src[i];
+                if (remap[v] == UINT32_MAX) {
+                    remap[v] = (uint32_t)x.size();
+                    x.push_back(mesh.x[v]); y.push_back(mesh.y[v]); z.push_back(mesh.z[v]);
+                    if (hasUVs) { tu.push_back(mesh.u[v]); tv.push_back(mesh.v[v]); }
+                    owner.push_back((uint32_t)c);
+                }
+                indices[t * 3 + i] = remap[v];
+            }
+        }
+        chunk.vertEnd = (uint32_t)x.size();
+
+        // Neighbours whose vertices this chunk borrows
+        chunk.depFirst = (uint32_t)out.deps.size();
+        for (uint32_t i = leaf.first * 3; i < (leaf.first + leaf.count) * 3; i++) {
+            uint32_t o = owner[indices[i]];
+            if (o != c && std::find(out.deps.begin() + chunk.depFirst, out.deps.end(), o) == out.deps.end())
+                out.deps.push_back(o);
+        }
+        chunk.depCount = (uint32_t)out.deps.size() - chunk.depFirst;
+
+        leaf.first = (uint32_t)c;
+        leaf.count = 1;
+    }
+    mesh.indices.swap(indices);
+    mesh.x.swap(x); mesh.y.swap(y); mesh.z.swap(z);     // Drops unused vertices
+    mesh.u.swap(tu); mesh.v.swap(tv);
+    if (!mesh.nx.empty()) Mesh_ComputeFacePlanes(mesh);
+
+    bvh.prims.resize(leaves.size());
+    bvh.primLeaf.resize(leaves.size());
+    for (size_t c = 0; c < leaves.size(); c++) {
+        bvh.prims[c] = (uint32_t)c;
+        bvh.primLeaf[c] = leaves[c];
+    }
+}
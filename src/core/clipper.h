@@ -0,0 +1,116 @@
+/*
+    clipper.h - Homogeneous Clip-space Triangle Clipping
+    Clips before the perspective divide, against the planes of the
+    projection in mat4x4 Mat_Proj form (0 <= z <= w, |x|, |y| <= w).
+
+    The side planes use a guard band: a triangle is only clipped in x/y
+    when it leaves a region GUARD_BAND times wider than the screen. Inside
+    the guard band the rasterizer's scissor does the work, so triangles
+    that merely overlap a screen edge are never split.
+
+    The clipper is a fixed-capacity Sutherland-Hodgman loop on the stack:
+    no allocation, each plane is visited at most once.
+*/
+
+#pragma once
+
+#include "../math3d/math3d.h"
+#include <cstdint>
+
+// ============== Clip Vertex ==============
+// Attributes are linear in clip space (before the divide), so new vertices
+// interpolate them with the same t as the position
+struct ClipVertex {
+    vec3d p;            // Clip-space position (x, y, z, w)
+    float u = 0, v = 0; // Texture coordinates
+};
+
+inline ClipVertex Clip_Lerp(const ClipVertex& a, const ClipVertex& b, float t) {
+    ClipVertex r;
+    r.p.x = a.p.x + (b.p.x - a.p.x) * t;
+    r.p.y = a.p.y + (b.p.y - a.p.y) * t;
+    r.p.z = a.p.z + (b.p.z - a.p.z) * t;
+    r.p.w = a.p.w + (b.p.w - a.p.w) * t;
+    r.u = a.u + (b.u - a.u) * t;
+    r.v = a.v + (b.v - a.v) * t;
+    return r;
+}
+
+// ============== Outcodes ==============
+enum ClipPlaneBits : uint8_t {
+    CLIP_NEAR   = 1 << 0,   // z < 0
+    CLIP_FAR    = 1 << 1,   // z > w
+    CLIP_LEFT   = 1 << 2,   // x < -w          (outside the screen)
+    CLIP_RIGHT  = 1 << 3,   // x >  w
+    CLIP_BOTTOM = 1 << 4,   // y < -w
+    CLIP_TOP    = 1 << 5,   // y >  w
+    CLIP_GB_X   = 1 << 6,   // |x| > GB * w   (outside the guard band)
+    CLIP_GB_Y   = 1 << 7,   // |y| > GB * w
+};
+
+// Any bit shared by all three vertices: triangle is entirely off screen
+const uint8_t CLIP_REJECT_MASK = CLIP_NEAR | CLIP_FAR | CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP;
+// Any of these set on some vertex: the triangle has to be clipped
+const uint8_t CLIP_NEEDED_MASK = CLIP_NEAR | CLIP_FAR | CLIP_GB_X | CLIP_GB_Y;
+
+const float GUARD_BAND = 3.0f;      // In units of the half screen size
+const int CLIP_MAX_VERTS = 9;       // 3 + one per clipped plane (6 planes)
+
+inline uint8_t Clip_Outcode(float x, float y, float z, float w) {
+    uint8_t c = 0;
+    if (z < 0) c |= CLIP_NEAR;
+    if (z > w) c |= CLIP_FAR;
+    if (x < -w) c |= CLIP_LEFT;
+    if (x > w) c |= CLIP_RIGHT;
+    if (y < -w) c |= CLIP_BOTTOM;
+    if (y > w) c |= CLIP_TOP;
+    float gw = GUARD_BAND * w;
+    if (x < -gw || x > gw) c |= CLIP_GB_X;
+    if (y < -gw || y > gw) c |= CLIP_GB_Y;
+    return c;
+}
+
+// ============== Polygon Clipper ==============
+
+// Signed distance to one clip plane (>= 0 is inside)
+inline float Clip_PlaneDist(const vec3d& p, int plane) {
+    switch (plane) {
+        case 0: return p.z;                         // near
+        case 1: return p.w - p.z;                   // far
+        case 2: return GUARD_BAND * p.w + p.x;      // guard band left
+        case 3: return GUARD_BAND * p.w - p.x;      // guard band right
+        case 4: return GUARD_BAND * p.w + p.y;      // guard band bottom
+        default: return GUARD_BAND * p.w - p.y;     // guard band top
+    }
+}
+
+// Clip one triangle against the planes flagged in `codes` (OR of the vertex
+// outcodes). Writes a convex polygon to out and returns its vertex count
+// (0 if nothing is left). out must hold CLIP_MAX_VERTS entries.
+inline int Clip_Triangle(const ClipVertex in[3], uint8_t codes, ClipVertex* out) {
+    ClipVertex bufA[CLIP_MAX_VERTS], bufB[CLIP_MAX_VERTS];
+    ClipVertex* src = bufA;
+    ClipVertex* dst = bufB;
+    src[0] = in[0]; src[1] = in[1]; src[2] = in[2];
+    int n = 3;
+
+    const uint8_t planeBits[6] = {CLIP_NEAR, CLIP_FAR, CLIP_GB_X, CLIP_GB_X, CLIP_GB_Y, CLIP_GB_Y};
+    for (int plane = 0; plane < 6 && n > 0; plane++) {
+        if (!(codes & planeBits[plane])) continue;
+        int m = 0;
+        ClipVertex* prev = &src[n - 1];
+        float dPrev = Clip_PlaneDist(prev->p, plane);
+        for (int i = 0; i < n; i++) {
+            ClipVertex* cur = &src[i];
+            float dCur = Clip_PlaneDist(cur->p, plane);
+            if ((dPrev >= 0) != (dCur >= 0))
+                dst[m++] = Clip_Lerp(*prev, *cur, dPrev / (dPrev - dCur));
+            if (dCur >= 0) dst[m++] = *cur;
+            prev = cur; dPrev = dCur;
+        }
+        n = m;
+        ClipVertex* t = src; src = dst; dst = t;
+    }
+    for (int i = 0; i < n; i++) out[i] = src[i];
+    return n;
+}
@@ -0,0 +1,105 @@
+/*
+    depth_buffer.h - Per-pixel Depth Buffer with Hierarchical Z
+    Stores 1/w per pixel (larger = closer, 0 = empty) plus a coarse
+    min/max per 8x8 tile so hidden triangles can be rejected early.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// ============== Depth Buffer ==============
+struct DepthBuffer {
+    static const int TILE_SHIFT = 3;
+    static const int TILE_SIZE = 1 << TILE_SHIFT;   // 8x8 pixels per tile
+
+    int width = 0, height = 0;
+    int tilesX = 0, tilesY = 0;
+
+    // One allocation: [pixels][tileMin][tileMax], cleared with a single memset.
+    // 1/w == 0 means "infinitely far", so all-zero bits is the cleared state.
+    std::vector<float> storage;
+    float* depth = nullptr;     // width * height, 1/w
+    float* tileMin = nullptr;   // Farthest 1/w in each tile (conservative, for rejection)
+    float* tileMax = nullptr;   // Nearest 1/w in each tile (for trivial accept)
+
+    // The pointers above point into storage, so copies and moves re-point
+    // them at their own storage
+    DepthBuffer() = default;
+    DepthBuffer(const DepthBuffer& other) { *this = other; }
+    DepthBuffer(DepthBuffer&& other) noexcept { *this = std::move(other); }
+
+    DepthBuffer& operator=(const DepthBuffer& other) {
+        if (this == &other) return *this;
+        width = other.width; height = other.height;
+        tilesX = other.tilesX; tilesY = other.tilesY;
+        storage = other.storage;
+        PointIntoStorage();
+        return *this;
+    }
+
+    DepthBuffer& operator=(DepthBuffer&& other) noexcept {
+        if (this == &other) return *this;
+        width = other.width; height = other.height;
+        tilesX = other.tilesX; tilesY = other.tilesY;
+        storage = std::move(other.storage);
+        PointIntoStorage();
+        other.width = other.height = other.tilesX = other.tilesY = 0;
+        other.storage.clear();
+        other.PointIntoStorage();
+        return *this;
+    }
+
+    void Resize(int w, int h) {
+        width = w; height = h;
+        tilesX = (w + TILE_SIZE - 1) >> TILE_SHIFT;
+        tilesY = (h + TILE_SIZE - 1) >> TILE_SHIFT;
+        storage.assign((size_t)w * h + 2 * (size_t)tilesX * tilesY, 0.0f);
+        PointIntoStorage();
+    }
+
+    void Clear() {
+        memset(storage.data(), 0, storage.size() * sizeof(float));
+    }
+
+    // Clear [x0, x1) × [y0, y1) and its tiles. The corners must lie on tile
+    // boundaries (or the buffer edge), so every tile touched is cleared whole.
+    void ClearRect(int x0, int y0, int x1, int y1) {
+        for (int y = y0; y < y1; y++) memset(Row(y) + x0, 0, (x1 - x0) * sizeof(float));
+        for (int ty = y0 >> TILE_SHIFT; ty < (y1 + TILE_SIZE - 1) >> TILE_SHIFT; ty++) {
+            for (int tx = x0 >> TILE_SHIFT; tx < (x1 + TILE_SIZE - 1) >> TILE_SHIFT; tx++)
+                tileMin[TileIndex(tx, ty)] = tileMax[TileIndex(tx, ty)] = 0;
+        }
+    }
+
+    // Contents of a buffer of the same size
+    void CopyFrom(const DepthBuffer& other) {
+        memcpy(storage.data(), other.storage.data(), storage.size() * sizeof(float));
+    }
+
+    float* Row(int y) { return depth + (size_t)y * width; }
+    int TileIndex(int tx, int ty) const { return ty * tilesX + tx; }
+
+    void PointIntoStorage() {
+        size_t nPix = (size_t)width * height, nTiles = (size_t)tilesX * tilesY;
+        depth = storage.empty() ? nullptr : storage.data();
+        tileMin = depth ? depth + nPix : nullptr;
+        tileMax = depth ? tileMin + nTiles : nullptr;
+    }
+
+    // Recompute the exact farthest depth of one tile after it was written
+    void RefreshTileMin(int tx, int ty) {
+        int x0 = tx << TILE_SHIFT, y0 = ty << TILE_SHIFT;
+        int x1 = x0 + TILE_SIZE < width ? x0 + TILE_SIZE : width;
+        int y1 = y0 + TILE_SIZE < height ? y0 + TILE_SIZE : height;
+        float m = 3.4e38f;
+        for (int y = y0; y < y1; y++) {
+            const float* row = Row(y);
+            for (int x = x0; x < x1; x++) m = row[x] < m ? row[x] : m;
+        }
+        tileMin[TileIndex(tx, ty)] = m;
+    }
+};
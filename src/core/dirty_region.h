@@ -0,0 +1,117 @@
+/*
+    dirty_region.h - Screen Regions for Incremental Redraw
+    The part of the screen a frame has to draw again: everything, or a few
+    disjoint rectangles around what moved. Rectangles are aligned to the
+    8x8 depth tiles (and raster blocks), so clearing them keeps the
+    hierarchical Z exact and the rasterizer's whole-block path applies
+    inside them.
+
+    A region is drawn by clearing its rectangles, culling against the
+    frustum of its bounding rectangle and rasterizing with each rectangle
+    as the scissor. The rasterizer produces the same pixels inside a
+    scissor however the screen is split, so a partial redraw matches a
+    full one.
+*/
+
+#pragma once
+
+#include "../math3d/math3d.h"
+#include "bvh.h"
+#include "frustum.h"
+#include "rasterizer.h"
+#include <algorithm>
+#include <vector>
+
+const int DIRTY_MAX_RECTS = 16;      // More than this and the whole screen is redrawn
+
+// ============== Dirty Region ==============
+struct DirtyRegion {
+    bool full = true;
+    std::vector<RasterRect> rects;   // Disjoint and tile aligned, when not full
+    RasterRect bounds;               // Of all rects
+
+    void SetFull() { full = true; rects.clear(); }
+    void SetEmpty() { full = false; rects.clear(); bounds = RasterRect(); }
+    bool Empty() const { return !full && rects.empty(); }
+
+    size_t Area() const {
+        size_t area = 0;
+        for (const RasterRect& r : rects) area += (size_t)(r.x1 - r.x0) * (r.y1 - r.y0);
+        return area;
+    }
+
+    // Add r (pixels) grown to whole tiles and clipped to the screen;
+    // overlapping rectangles are merged into one
+    void Add(RasterRect r, int width, int height) {
+        if (full) return;
+        const int mask = DepthBuffer::TILE_SIZE - 1;
+        r.x0 = std::max(r.x0, 0) & ~mask;
+        r.y0 = std::max(r.y0, 0) & ~mask;
+        r.x1 = std::min((r.x1 + mask) & ~mask, width);
+        r.y1 = std::min((r.y1 + mask) & ~mask, height);
+        if (r.x0 >= r.x1 || r.y0 >= r.y1) return;
+        for (size_t i = 0; i < rects.size(); ) {
+            const RasterRect& q = rects[i];
+            if (q.x0 >= r.x1 || r.x0 >= q.x1 || q.y0 >= r.y1 || r.y0 >= q.y1) { i++; continue; }
+            r.x0 = std::min(r.x0, q.x0); r.y0 = std::min(r.y0, q.y0);
+            r.x1 = std::max(r.x1, q.x1); r.y1 = std::max(r.y1, q.y1);
+            rects.erase(rects.begin() + i);
+            i = 0;                   // The union may reach rectangles passed already
+        }
+        rects.push_back(r);
+        if (rects.size() > (size_t)DIRTY_MAX_RECTS) { SetFull(); return; }
+        if (rects.size() == 1) bounds = r;
+        bounds.x0 = std::min(bounds.x0, r.x0); bounds.y0 = std::min(bounds.y0, r.y0);
+        bounds.x1 = std::max(bounds.x1, r.x1); bounds.y1 = std::max(bounds.y1, r.y1);
+    }
+
+    // f(rect) for each part of the region inside clip
+    template <class F>
+    void ForEach(const RasterRect& clip, F f) const {
+        if (full) { f(clip); return; }
+        for (const RasterRect& q : rects) {
+            RasterRect r;
+            r.x0 = std::max(q.x0, clip.x0); r.x1 = std::min(q.x1, clip.x1);
+            r.y0 = std::max(q.y0, clip.y0); r.y1 = std::min(q.y1, clip.y1);
+            if (r.x0 < r.x1 && r.y0 < r.y1) f(r);
+        }
+    }
+};
+
+// ============== Projection ==============
+// Screen rectangle (pixels, one pixel of margin) covering the box, with
+// the engine's clip -> screen mapping. False if the box reaches behind
+// the camera, where its corners give no bound.
+inline bool DirtyRegion_ScreenRect(const Aabb& box, const mat4x4& toClip, int width, int height, RasterRect& out) {
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    for (int i = 0; i < 8; i++) {
+        vec3d p = {i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z};
+        vec3d c = Mat_MulVec(toClip, p);
+        if (c.w <= 1e-6f) return false;
+        float invW = 1.0f / c.w;
+        float sx = (1.0f - c.x * invW) * 0.5f * width, sy = (1.0f - c.y * invW) * 0.5f * height;
+        minX = std::min(minX, sx); maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy); maxY = std::max(maxY, sy);
+    }
+    // Far off screen: clamp before converting so nothing overflows
+    auto clamp = [](float v, int limit) { return (int)std::min(std::max(v, -1.0f), limit + 1.0f); };
+    out.x0 = clamp(minX - 1.0f, width);
+    out.y0 = clamp(minY - 1.0f, height);
+    out.x1 = clamp(maxX + 2.0f, width);
+    out.y1 = clamp(maxY + 2.0f, height);
+    return true;
+}
+
+// Clip space -> clip space of the sub-view showing only rect r, so that
+// Frustum_FromMatrix(Mat_Mul(viewProj, m)) culls to r
+inline mat4x4 DirtyRegion_ClipMatrix(const RasterRect& r, int width, int height) {
+    // Screen x maps to NDC 1 - 2x / width (and y likewise): scale and
+    // shift the rect's NDC range onto [-1, 1]
+    float ax = 1.0f - 2.0f * r.x1 / width, bx = 1.0f - 2.0f * r.x0 / width;
+    float ay = 1.0f - 2.0f * r.y1 / height, by = 1.0f - 2.0f * r.y0 / height;
+    float sx = 2.0f / (bx - ax), sy = 2.0f / (by - ay);
+    mat4x4 m = Mat_Identity();
+    m.m[0][0] = sx; m.m[3][0] = -sx * 0.5f * (ax + bx);
+    m.m[1][1] = sy; m.m[3][1] = -sy * 0.5f * (ay + by);
+    return m;
+}
@@ -0,0 +1,63 @@
+/*
+    dynamic_resolution.h - Render Scale Controller
+    Chooses the fraction of the window's width and height frames are drawn
+    at so that rendering stays within a time budget; the smaller frame is
+    stretched over the window when presented. The cost model follows the
+    pipeline: the raster stage fills pixels and grows with scale², the
+    other stages do not depend on the resolution. Both parts are averaged
+    over recent frames, and the scale moves in RESOLUTION_STEP steps,
+    growing only once a step clearly fits, so it settles on one size
+    instead of hunting between two.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// ============== Render Scale ==============
+const float RESOLUTION_MIN_SCALE = 0.5f;
+const float RESOLUTION_MAX_SCALE = 1.0f;
+const float RESOLUTION_STEP = 0.05f;        // Scales the controller picks are multiples of this
+const float RESOLUTION_HEADROOM = 0.9f;     // Grow only while the budget would be this full
+
+// Pixels of a window dimension drawn at `scale`, at least 1
+inline int Resolution_Scaled(int size, float scale) {
+    return std::max(1, (int)(size * scale + 0.5f));
+}
+
+struct ResolutionController {
+    float smoothing = 0.2f;         // Weight of a new frame in the averages
+    double fixedSeconds = -1;       // Render time outside the raster stage, < 0 = no frame yet
+    double rasterSeconds = 0;       // Raster time as if drawn at scale 1
+
+    void Reset() { fixedSeconds = -1; rasterSeconds = 0; }
+
+    // A frame drawn whole at `scale` spent `raster` of its `total` render
+    // seconds in the raster stage
+    void AddFrame(float scale, double raster, double total) {
+        double full = raster / std::max(scale * scale, 1e-4f);
+        double fixed = std::max(total - raster, 0.0);
+        if (fixedSeconds < 0) {
+            fixedSeconds = fixed;
+            rasterSeconds = full;
+            return;
+        }
+        fixedSeconds += (fixed - fixedSeconds) * smoothing;
+        rasterSeconds += (full - rasterSeconds) * smoothing;
+    }
+
+    // Scale for the next frames, from the current one, to render within
+    // `budget` seconds: shrinks as soon as the budget is exceeded, grows
+    // once a larger step fits with RESOLUTION_HEADROOM to spare
+    float Choose(float scale, double budget) const {
+        if (fixedSeconds < 0) return scale;
+        double room = std::max(budget - fixedSeconds, 0.0);
+        float fit = rasterSeconds > 0 ? (float)std::sqrt(room / rasterSeconds) : RESOLUTION_MAX_SCALE;
+        float target = scale;
+        auto stepBelow = [](float s) { return std::floor(s / RESOLUTION_STEP + 1e-3f) * RESOLUTION_STEP; };
+        if (fit < scale) target = stepBelow(fit);
+        else if (fit * RESOLUTION_HEADROOM >= scale + RESOLUTION_STEP) target = stepBelow(fit * RESOLUTION_HEADROOM);
+        return std::min(std::max(target, RESOLUTION_MIN_SCALE), RESOLUTION_MAX_SCALE);
+    }
+};
@@ -7,8 +7,33 @@
 
 #include "../SDLApp.h"
 #include "../math3d/math3d.h"
+#include "rasterizer.h"
+#include "texture.h"
+#include "clipper.h"
+#include "frustum.h"
+#include "bvh.h"
+#include "occlusion.h"
+#include "dirty_region.h"
+#include "input_log.h"
+#include "scene_graph.h"
+#include "mesh.h"
+#include "mesh_loader.h"
+#include "mesh_cache.h"
+#include "mesh_levels.h"
+#include "mesh_simplify.h"
+#include "point_cloud.h"
+#include "point_splat.h"
+#include "dynamic_resolution.h"
+#include "thread_pool.h"
+#include "render_thread.h"
+#include "frame_arena.h"
+#include "profiler.h"
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <memory>
 #include <vector>
-#include <list>
 #include <algorithm>
 
 // ============== Triangle Structure ==============
@@ -17,69 +42,91 @@ struct triangle {
     Color color;    // Face color
 };
 
-// ============== Triangle Clipping ==============
-
-// Calculate intersection point of line with plane
-inline vec3d Vec_IntersectPlane(vec3d& plane_p, vec3d& plane_n, vec3d& start, vec3d& end, float& t) {
-    plane_n = Vec_Norm(plane_n);
-    float pd = -Vec_Dot(plane_n, plane_p);
-    float ad = Vec_Dot(start, plane_n);
-    float bd = Vec_Dot(end, plane_n);
-    t = (-pd - ad) / (bd - ad);
-    return Vec_Add(start, Vec_Mul(Vec_Sub(end, start), t));
-}
-
-// Clip triangle against a plane, returns 0-2 triangles
-inline int ClipTriangle(vec3d plane_p, vec3d plane_n, triangle& in, triangle& out1, triangle& out2) {
-    plane_n = Vec_Norm(plane_n);
-    auto dist = [&](vec3d& p) { return Vec_Dot(plane_n, p) - Vec_Dot(plane_n, plane_p); };
-
-    vec3d* inside[3];  int nIn = 0;
-    vec3d* outside[3]; int nOut = 0;
-
-    float d0 = dist(in.p[0]), d1 = dist(in.p[1]), d2 = dist(in.p[2]);
-    if (d0 >= 0) inside[nIn++] = &in.p[0]; else outside[nOut++] = &in.p[0];
-    if (d1 >= 0) inside[nIn++] = &in.p[1]; else outside[nOut++] = &in.p[1];
-    if (d2 >= 0) inside[nIn++] = &in.p[2]; else outside[nOut++] = &in.p[2];
-
-    if (nIn == 0) return 0;
-    if (nIn == 3) { out1 = in; return 1; }
-
-    if (nIn == 1) {
-        out1.color = in.color;
-        out1.p[0] = *inside[0];
-        float t;
-        out1.p[1] = Vec_IntersectPlane(plane_p, plane_n, *inside[0], *outside[0], t);
-        out1.p[2] = Vec_IntersectPlane(plane_p, plane_n, *inside[0], *outside[1], t);
-        return 1;
-    }
-
-    if (nIn == 2) {
-        out1.color = in.color; out2.color = in.color;
-        out1.p[0] = *inside[0]; out1.p[1] = *inside[1];
-        float t;
-        out1.p[2] = Vec_IntersectPlane(plane_p, plane_n, *inside[0], *outside[0], t);
-        out2.p[0] = *inside[1]; out2.p[1] = out1.p[2];
-        out2.p[2] = Vec_IntersectPlane(plane_p, plane_n, *inside[1], *outside[0], t);
-        return 2;
-    }
-    return 0;
-}
+// ============== Transformed Vertex Streams ==============
+// Per-frame output of the batch transforms, one entry per mesh vertex.
+// Lives in the frame arena; w is only allocated when asked for.
+struct VertexStreams {
+    float *x = nullptr, *y = nullptr, *z = nullptr, *w = nullptr;
 
-// ============== 3D Engine Class ==============
-class Engine3D {
-public:
-    SDLApp app;
-    std::vector<triangle> cubeTris;  // Cube triangles
-    mat4x4 matProj;                  // Projection matrix
+    void Alloc(FrameArena& arena, size_t n, bool withW) {
+        x = arena.AllocArray<float>(n);
+        y = arena.AllocArray<float>(n);
+        z = arena.AllocArray<float>(n);
+        w = withW ? arena.AllocArray<float>(n) : nullptr;
+    }
+    vec3d Get(size_t i) const { return {x[i], y[i], z[i], w ? w[i] : 1.0f}; }
+};
+
+// Contiguous run of vertices to transform
+struct VertexRange {
+    uint32_t first, count;
+};
+
+// ============== Instances ==============
+// Copies of the engine's mesh, each a node in the engine's scene graph
+// with its own color. Instance transforms are relative to the object
+// origin (0, 0, objDist); the object rotation spins every copy in place.
+struct InstanceList {
+    std::vector<int> nodes;         // SceneGraph node per instance
+    std::vector<Color> colors;
+
+    size_t Count() const { return nodes.size(); }
+    void Clear() { nodes.clear(); colors.clear(); }
+};
+
+// ============== Render Statistics ==============
+// Work done and time spent per pipeline stage, filled by every Render()
+struct RenderStats {
+    enum Stage { TRANSFORM, CULL, CLIP, RASTER, STAGE_COUNT };
+
+    double seconds[STAGE_COUNT] = {};
+    size_t instances = 0;       // Objects drawn (1 without instancing)
+    size_t instancesVisible = 0;// Left after frustum and occlusion culling
+    size_t chunksVisible = 0;   // Mesh chunks left over all visible instances
+    size_t vertices = 0;        // Transformed to clip space
+    size_t vertexRefs = 0;      // Corners of the triangles tested, each a post-transform fetch
+    size_t trisIn = 0;          // Mesh triangles submitted, over all instances
+    size_t trisLod = 0;         // Left out by drawing a coarser level of detail
+    size_t trisOutside = 0;     // Rejected by the frustum or occlusion (instance, chunk or outcodes)
+    size_t trisVisible = 0;     // Left after frustum reject and backface culling
+    size_t trisClipped = 0;     // Visible triangles that went through the clipper
+    size_t trisRaster = 0;      // Screen triangles after clipping (fans count each piece)
+    size_t pixels = 0;          // Filled pixels that passed the depth test
+    size_t points = 0;          // Point cloud points splatted (chunksVisible: their chunks)
+
+    static const char* StageName(int stage) {
+        static const char* names[STAGE_COUNT] = {"transform", "cull", "clip", "raster"};
+        return names[stage];
+    }
+    // Triangles entering a stage
+    size_t StageTris(int stage) const {
+        return stage == CLIP ? trisVisible : stage == RASTER ? trisRaster : trisIn;
+    }
+    // Whether a stage fills pixels (its pixel rate is pixels / seconds)
+    static bool StageFillsPixels(int stage) { return stage == RASTER; }
+    // Fetches served by an already transformed vertex
+    double VertexHitRate() const {
+        return vertexRefs ? 1.0 - (double)vertices / vertexRefs : 0.0;
+    }
+    double TotalSeconds() const {
+        double t = 0;
+        for (int i = 0; i < STAGE_COUNT; i++) t += seconds[i];
+        return t;
+    }
+};
 
+// ============== Frame Settings ==============
+// Everything input and the control panel change that a frame is drawn
+// with. Engine3D edits its own copy on the main thread; each frame
+// renders from a snapshot, so the UI can move on while it is drawn.
+struct FrameSettings {
     // Camera parameters
     vec3d camera = {0, 0, 0};
-    vec3d lookDir;
     float camRotX = 0, camRotY = 0;
 
     // Object parameters
-    float rotX = 0, rotZ = 0;
+    int instanceCount = 0;
+    float rotX = 0, rotY = 0, rotZ = 0;    // rotY turns the object about its up axis (turntable)
     bool autoRotate = true;
     float rotSpeed = 1.0f;
     float objDist = 5.0f;
@@ -90,42 +137,470 @@ public:
     // Display options
     bool showWireframe = true;
     bool showFilled = true;
+    bool textured = false;                // Sample texture where the mesh has texture coordinates
+    bool depthTest = true;
     Color fillColor = Color::Blue();
+    bool occlusionCulling = false;
+    bool lodEnabled = true;
+    float lodPixelError = 0.5f;           // Largest projected error allowed, pixels
+    int rasterThreads = ThreadPool::HardwareThreads();
+    float pointDensity = 4.0f;            // Point clouds: points drawn per pixel a chunk covers, 0 = all
+    float renderScale = 1.0f;             // Frames are drawn at this fraction of the window size
 
     // Projection parameters
     float fov = 90.0f, zNear = 0.1f, zFar = 1000.0f;
 
+    // Whether frames drawn with these settings and with `o` look the same.
+    // Everything above that reaches the image belongs here; autoRotate and
+    // rotSpeed only steer Update(), and the thread count never shows.
+    bool SameImage(const FrameSettings& o) const {
+        auto same = [](const vec3d& a, const vec3d& b) { return a.x == b.x && a.y == b.y && a.z == b.z; };
+        return same(camera, o.camera) && camRotX == o.camRotX && camRotY == o.camRotY &&
+               instanceCount == o.instanceCount && rotX == o.rotX && rotY == o.rotY && rotZ == o.rotZ &&
+               objDist == o.objDist && same(light, o.light) &&
+               showWireframe == o.showWireframe && showFilled == o.showFilled && textured == o.textured &&
+               depthTest == o.depthTest && fillColor.Pack() == o.fillColor.Pack() &&
+               occlusionCulling == o.occlusionCulling && lodEnabled == o.lodEnabled &&
+               lodPixelError == o.lodPixelError && pointDensity == o.pointDensity &&
+               renderScale == o.renderScale && fov == o.fov && zNear == o.zNear && zFar == o.zFar;
+    }
+
+    // Every field once, in the order of the packed layout (input logs)
+    template <class F>
+    void ForEachField(F&& f) {
+        f(camera.x); f(camera.y); f(camera.z); f(camRotX); f(camRotY);
+        f(instanceCount); f(rotX); f(rotY); f(rotZ); f(autoRotate); f(rotSpeed); f(objDist);
+        f(light.x); f(light.y); f(light.z);
+        f(showWireframe); f(showFilled); f(textured); f(depthTest);
+        f(fillColor.r); f(fillColor.g); f(fillColor.b); f(fillColor.a);
+        f(occlusionCulling); f(lodEnabled); f(lodPixelError); f(rasterThreads); f(pointDensity);
+        f(renderScale);
+        f(fov); f(zNear); f(zFar);
+    }
+
+    void Pack(std::vector<uint8_t>& out) const {
+        out.clear();
+        FrameSettings s = *this;
+        s.ForEachField([&](auto& v) { inputlog::Put(out, v); });
+    }
+
+    // False, leaving the settings as they were, if data is not a packed FrameSettings
+    bool Unpack(const std::vector<uint8_t>& data) {
+        FrameSettings s = *this;
+        inputlog::Cursor at;
+        at.p = data.data();
+        at.end = at.p + data.size();
+        s.ForEachField([&](auto& v) { at.Get(v); });
+        if (!at.ok || at.p != at.end) return false;
+        *this = s;
+        return true;
+    }
+};
+
+// ============== 3D Engine Class ==============
+class Engine3D : public FrameSettings {
+public:
+    SDLApp app;
+    // Object being rendered (cube or loaded file) with its triangle chunks.
+    // Read-only once set, so copies of the engine (batch workers) share it.
+    std::shared_ptr<const MeshGeometry> geometry;
+    MeshLoadStats meshStats;         // Filled when a mesh file was loaded
+    double meshBuildSeconds = 0;     // Chunks and face planes of the mesh (0 from a cache)
+    static const int MESH_BUILD_HINT_MS = 1000;     // Suggest a mesh cache when building took longer
+    vec3d meshCenter;                // Bounding sphere of the mesh, object space
+    float meshRadius = 0;
+    float meshAcmr = 0;              // Vertices per triangle through a VCACHE_SIZE FIFO
+    // For textured frames; a checkerboard until one is loaded. Shared like geometry.
+    std::shared_ptr<const Texture> texture;
+
+    // Point cloud drawn instead of the mesh when set. Read-only while
+    // drawing, so copies of the engine (batch workers) share one.
+    std::shared_ptr<const PointCloud> points;
+    MeshLoadStats pointStats;        // Filled when a point cloud file was loaded
+
+    // Levels of detail 1 and up, shared like geometry. Built in the
+    // background after a mesh is set; until SyncFrame() takes them (when
+    // levelsDue) every instance draws the full mesh. Every instance keeps
+    // the level it was drawn with, so a level only changes once the error
+    // is clearly past the limit.
+    std::shared_ptr<const MeshLevels> levels;
+    MeshLevelBuilder levelBuilder;
+    bool levelsDue = false;               // Take the built levels before the next frame (recorded)
+    std::vector<uint8_t> instanceLod;     // Level per instance, last frame
+
+    // Scene: the root sits at the object origin, the single object and all
+    // instances hang below it. World matrices are only recomputed for
+    // subtrees whose transforms changed.
+    SceneGraph scene;
+    int sceneRoot = SceneGraph::NONE;
+    int objectNode = SceneGraph::NONE;   // Drawn with fillColor when there are no instances
+    InstanceList instances;
+    float placedDist = NAN;              // objDist the root transform was built for
+
+    // Culling: a BVH over the instance bounds (rebuilt when instances are
+    // added, refit when they move), the chunk BVH of the mesh, and the tile
+    // depths of the previous frame for occlusion culling
+    Bvh instanceBvh;
+    std::vector<Aabb> instanceBoxes;     // World bounds per instance (the object when there are none)
+    std::vector<int> nodeInstance;       // Instance of each scene node, -1 for others
+    std::vector<uint32_t> movedInstances;
+    bool instanceBvhStale = true;
+    OcclusionBuffer occlusion;
+
+    // Per-frame transient data, all carved from frameArena (reset in BeginFrame)
+    FrameArena frameArena;
+    VertexStreams clipVerts;              // Transformed vertices
+    uint8_t* clipCodes = nullptr;         // Clip outcode per vertex
+    mat4x3* instanceWorld = nullptr;      // World matrix (incl. spin) per visible instance
+    uint32_t* visibleInstances = nullptr; // Instances that passed frustum and occlusion culling
+    uint8_t* instanceLevel = nullptr;     // Level of detail per visible instance
+    size_t* vertBase = nullptr;           // Per visible instance: first vertex slot (+1 entry)
+    uint32_t* chunkStart = nullptr;       // Per visible instance: first entry in visibleChunks (+1 entry)
+    uint32_t* visibleChunks = nullptr;    // Mesh chunks to draw, near to far per instance
+    uint32_t* rangeStart = nullptr;       // Per visible instance: first entry in vertexRanges (+1 entry)
+    VertexRange* vertexRanges = nullptr;  // Vertices the visible chunks use
+    uint32_t* visibleTris = nullptr;      // Mesh triangles that survived culling,
+    uint32_t* visibleSlots = nullptr;     // the visible instance each belongs to,
+    Color* visibleColors = nullptr;       // and their lit colors
+    size_t visibleCount = 0;
+    ArenaArray<triangle> trisToRaster;    // Screen-space triangles, submission order
+    ArenaArray<RasterUV> trisUV;          // and their texture coordinates, when textured
+    uint32_t* tileBinStart = nullptr;     // Per tile: first entry in tileBinTris (tiles + 1 entries)
+    uint32_t* tileBinTris = nullptr;      // Indices into trisToRaster, grouped by tile
+
+    // Tile-binned parallel rasterization
+    static const int RASTER_TILE = 64;           // Multiple of DepthBuffer::TILE_SIZE
+    static const size_t POINT_TASK_POINTS = 16384;  // Points splatted per task, about
+    ThreadPool rasterPool;
+    SplatBuffer splats;              // Depth+color of the point path, empty between frames
+    RenderStats stats;               // Of the last Render()
+
+    // Pipelining: the render thread draws a frame into app.framebuffer
+    // while the main thread runs input and UI and presents the previous
+    // frame from `presented`. They only meet in SyncFrame().
+    FrameSettings frame;             // Snapshot the frame being rendered uses
+    RenderThread renderThread;
+    bool pipelined = true;
+    bool frameInFlight = false;
+    Framebuffer presented;           // Finished frame on screen
+    RenderStats presentedStats;      // and its stats, for the control panel
+    size_t arenaUsed = 0, arenaCapacity = 0, arenaPeak = 0;     // frameArena as of SyncFrame()
+    int arenaHeapAllocs = 0;
+
+    // Incremental redraw: a frame is only drawn when something it shows
+    // changed, and only around the moved instances when nothing else did.
+    // The rest of the screen is taken over from `presented`.
+    bool incrementalRedraw = true;
+    DirtyRegion redraw;              // What the next frame draws (all of it outside DrawFrame)
+    FrameSettings drawnSettings;     // Snapshot of the last frame drawn
+    bool sceneChanged = true;        // Mesh, texture, instances or screen size changed since
+    bool presentedChanged = true;    // presented holds a frame not yet shown
+    int idleFrames = 0;              // Main loop iterations in a row that drew nothing
+    int framesFull = 0, framesPartial = 0, framesSkipped = 0;
+    static const int IDLE_FRAMES_BEFORE_WAIT = 30;  // Let the UI settle (hover, fades) first
+    static const int IDLE_WAIT_MS = 100;
+
+    // Dynamic resolution: with a frame budget, renderScale follows the
+    // render times of the frames drawn whole (UpdateRenderScale())
+    float frameBudgetMs = 0;         // Render time to stay within, 0 = off
+    ResolutionController resolution;
+
+    vec3d lookDir;                   // View direction of the frame's camera
+
+    // Camera matrices, rebuilt by UpdateCamera() only when their inputs change
+    mat4x4 matProj;                  // Projection matrix
+    mat4x3 matView;
+    mat4x4 matViewProj;
+    Frustum frustum;                 // World-space planes of matViewProj
+    float viewKey[5] = {NAN};        // camera, camRotX, camRotY used for matView
+    float projKey[4] = {NAN};        // fov, aspect, zNear, zFar used for matProj
+
+    // Profiler panel
+    int traceFrames = 60;
+
+    // Input recording (Run() writes a frame per iteration while active)
+    InputLogWriter recorder;
+    std::string recordPath;
+
+    Engine3D() {
+        ResetScene();
+        auto checker = std::make_shared<Texture>();
+        Texture_CreateChecker(*checker);
+        texture = checker;
+        SetMesh(Mesh());
+    }
+    ~Engine3D() { renderThread.Stop(); }
+
+    const FrameSettings& Settings() const { return *this; }
+
+    // Whether the frame being rendered samples the texture
+    bool Textured() const { return frame.textured && frame.showFilled && texture->Valid() && geometry->mesh.HasUVs(); }
+
+    // Whether frames draw the point cloud instead of the mesh
+    bool PointMode() const { return points && !points->Empty(); }
+
     void CreateCube() {
-        cubeTris.clear();
-        auto addTri = [&](vec3d a, vec3d b, vec3d c) {
-            triangle t; t.p[0] = a; t.p[1] = b; t.p[2] = c;
-            cubeTris.push_back(t);
-        };
-        // 6 faces × 2 triangles = 12 triangles
-        // SOUTH
-        addTri({0,0,0,1}, {0,1,0,1}, {1,1,0,1});
-        addTri({0,0,0,1}, {1,1,0,1}, {1,0,0,1});
-        // EAST
-        addTri({1,0,0,1}, {1,1,0,1}, {1,1,1,1});
-        addTri({1,0,0,1}, {1,1,1,1}, {1,0,1,1});
-        // NORTH
-        addTri({1,0,1,1}, {1,1,1,1}, {0,1,1,1});
-        addTri({1,0,1,1}, {0,1,1,1}, {0,0,1,1});
-        // WEST
-        addTri({0,0,1,1}, {0,1,1,1}, {0,1,0,1});
-        addTri({0,0,1,1}, {0,1,0,1}, {0,0,0,1});
-        // TOP
-        addTri({0,1,0,1}, {0,1,1,1}, {1,1,1,1});
-        addTri({0,1,0,1}, {1,1,1,1}, {1,1,0,1});
-        // BOTTOM
-        addTri({1,0,1,1}, {0,0,1,1}, {0,0,0,1});
-        addTri({1,0,1,1}, {0,0,0,1}, {1,0,0,1});
-    }
-
-    bool Init() {
+        Mesh cube;
+        Mesh_CreateCube(cube);
+        SetMesh(std::move(cube));
+    }
+
+    // Draw `m` from now on. It is reordered into chunks right away; its
+    // levels of detail are built in the background (see levels).
+    void SetMesh(Mesh m) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::shared_ptr<const MeshGeometry> built = MeshGeometry_Build(std::move(m));
+        meshBuildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        SetMesh(built, std::make_shared<const MeshLevels>());
+        if (built->mesh.TriangleCount() >= MESH_LOD_MIN_TRIS) levelBuilder.Start(built);
+    }
+
+    // Draw a mesh whose chunks and levels of detail are already built (as
+    // read from a mesh cache, or shared with another engine)
+    void SetMesh(std::shared_ptr<const MeshGeometry> g, std::shared_ptr<const MeshLevels> l) {
+        levelBuilder.Cancel();
+        levelsDue = false;
+        geometry = std::move(g);
+        levels = std::move(l);
+        MeshChanged();
+    }
+
+    // Bounds and culling state for a new mesh
+    void MeshChanged() {
+        Mesh_BoundingSphere(geometry->mesh, meshCenter, meshRadius);
+        meshAcmr = VertexCache_Acmr(geometry->mesh);
+        instanceBvhStale = true;
+        scene.SetBounds(objectNode, vec3d(), SpinRadius());
+        for (int node : instances.nodes) scene.SetBounds(node, vec3d(), SpinRadius());
+        MeshLevelsChanged();
+    }
+
+    // Every instance picks its level anew
+    void MeshLevelsChanged() {
+        instanceLod.clear();
+        sceneChanged = true;
+    }
+
+    // Draw with the levels of detail being built in the background once
+    // they are done, or right away after waiting for them if `wait`. Only
+    // while no frame is in flight. Returns whether the levels changed.
+    bool TakeLevels(bool wait) {
+        std::shared_ptr<const MeshLevels> built = levelBuilder.Take(wait);
+        if (!built) return false;
+        levels = std::move(built);
+        MeshLevelsChanged();
+        return true;
+    }
+
+    // The mesh spins about its origin, so bound it by a sphere around the origin
+    float SpinRadius() const {
+        return sqrtf(Vec_Dot(meshCenter, meshCenter)) + meshRadius;
+    }
+
+    int LodCount() const { return 1 + (int)levels->lods.size(); }
+    const Mesh& LodMesh(int level) const { return level ? levels->lods[level - 1].mesh : geometry->mesh; }
+    const MeshChunks& LodChunks(int level) const { return level ? levels->chunks[level - 1] : geometry->chunks; }
+    float LodError(int level) const { return level ? levels->lods[level - 1].error : 0.0f; }
+
+    // Drop all instances and start over with the root and the single object
+    void ResetScene() {
+        scene.Clear();
+        instances.Clear();
+        nodeInstance.clear();
+        instanceLod.clear();
+        instanceBvhStale = true;
+        sceneChanged = true;
+        sceneRoot = scene.AddNode(SceneGraph::NONE, Aff_Identity());
+        objectNode = scene.AddNode(sceneRoot, Aff_Identity());
+        scene.SetBounds(objectNode, vec3d(), SpinRadius());
+        placedDist = NAN;
+    }
+
+    // Add a copy of the mesh below `parent` (the scene root by default),
+    // returns its scene node
+    int AddInstance(const mat4x3& transform, const Color& color, int parent = SceneGraph::NONE) {
+        int node = scene.AddNode(parent == SceneGraph::NONE ? sceneRoot : parent, transform);
+        scene.SetBounds(node, vec3d(), SpinRadius());
+        nodeInstance.resize(scene.Count(), -1);
+        nodeInstance[node] = (int)instances.Count();
+        instanceBvhStale = true;
+        sceneChanged = true;
+        instances.nodes.push_back(node);
+        instances.colors.push_back(color);
+        return node;
+    }
+
+    // n copies on a cube-shaped grid in front of the camera, each turned and
+    // tinted differently (n = 0 goes back to a single object). Every depth
+    // slice of the grid is its own group node.
+    void CreateInstanceGrid(int n) {
+        ResetScene();
+        instanceCount = std::max(n, 0);
+        int k = 1;
+        while (k * k * k < instanceCount) k++;
+        float spacing = 2.0f * meshRadius + 1.0f;
+        float half = (k - 1) * spacing * 0.5f;
+        scene.Reserve(instanceCount + k + 2);
+        int slice = SceneGraph::NONE;
+        for (int i = 0; i < instanceCount; i++) {
+            int gx = i % k, gy = i / k % k, gz = i / (k * k);
+            if (i % (k * k) == 0) slice = scene.AddNode(sceneRoot, Aff_RotEulerTrans(0, 0, 0, 0, 0, gz * spacing));
+            uint32_t h = (uint32_t)i * 2654435761u;
+            mat4x3 t = Aff_RotEulerTrans((h & 255) * 0.0245f, (h >> 8 & 255) * 0.0245f, 0,
+                                         gx * spacing - half, gy * spacing - half, 0);
+            Color c((Uint8)(64 + gx * 191 / k), (Uint8)(64 + gy * 191 / k), (Uint8)(64 + gz * 191 / k));
+            AddInstance(t, c, slice);
+        }
+    }
+
+    // Rebuild the view matrix only when the camera moved and the projection
+    // only when its parameters (or the aspect ratio) changed
+    void UpdateCamera() {
+        float aspect = (float)app.screenHeight / app.screenWidth;
+        float proj[4] = {frame.fov, aspect, frame.zNear, frame.zFar};
+        float view[5] = {frame.camera.x, frame.camera.y, frame.camera.z, frame.camRotX, frame.camRotY};
+        bool projChanged = !std::equal(proj, proj + 4, projKey);
+        bool viewChanged = !std::equal(view, view + 5, viewKey);
+        if (projChanged) {
+            matProj = Mat_Proj(frame.fov, aspect, frame.zNear, frame.zFar);
+            std::copy(proj, proj + 4, projKey);
+        }
+        if (viewChanged) {
+            // Step 1: Build Camera Matrix (View Matrix), RotX × RotY
+            vec3d up = {0, 1, 0}, target = {0, 0, 1};
+            mat4x3 camRot = Aff_RotEuler(frame.camRotX, frame.camRotY, 0);
+            lookDir = Aff_MulDir(camRot, target);
+            target = Vec_Add(frame.camera, lookDir);
+            matView = Aff_QuickInv(Aff_PointAt(frame.camera, target, up));
+            std::copy(view, view + 5, viewKey);
+        }
+        if (projChanged || viewChanged) {
+            matViewProj = Aff_MulMat(matView, matProj);
+            frustum = Frustum_FromMatrix(matViewProj);
+        }
+    }
+
+    // Bring the instance BVH up to date with the scene graph: rebuild after
+    // instances were added or the mesh changed, refit what moved otherwise
+    void UpdateInstanceBvh() {
+        size_t nInst = std::max<size_t>(instances.Count(), 1);
+        const int* nodes = instances.Count() ? instances.nodes.data() : &objectNode;
+        auto boxOf = [&](size_t i) { return Aabb_FromSphere(scene.WorldCenter(nodes[i]), scene.WorldRadius(nodes[i])); };
+        if (instanceBvhStale || instanceBoxes.size() != nInst) {
+            instanceBoxes.resize(nInst);
+            for (size_t i = 0; i < nInst; i++) instanceBoxes[i] = boxOf(i);
+            instanceBvh.Build(instanceBoxes, 4);
+            instanceBvhStale = false;
+            return;
+        }
+        if (scene.Updated().empty()) return;
+        CollectMovedInstances();
+        // Refitting node by node only pays off while few instances moved
+        if (movedInstances.size() * 4 > nInst) {
+            for (size_t i = 0; i < nInst; i++) instanceBoxes[i] = boxOf(i);
+            instanceBvh.Refit(instanceBoxes);
+        } else {
+            for (uint32_t i : movedInstances) instanceBoxes[i] = boxOf(i);
+            instanceBvh.Refit(instanceBoxes, movedInstances.data(), movedInstances.size());
+        }
+    }
+
+    // Instances whose nodes the last scene.Update() recomputed, into movedInstances
+    void CollectMovedInstances() {
+        movedInstances.clear();
+        for (int node : scene.Updated()) {
+            int inst = instances.Count() ? (node < (int)nodeInstance.size() ? nodeInstance[node] : -1)
+                                         : (node == objectNode ? 0 : -1);
+            if (inst >= 0) movedInstances.push_back((uint32_t)inst);
+        }
+    }
+
+    // Load an OBJ/PLY file and fit it into a 2-unit box around the origin,
+    // or a mesh cache (stored fitted, with its chunks and levels of detail)
+    // Levels of detail of a file that is not a cache follow in the background.
+    bool LoadMesh(const char* path) {
+        bool cached = MeshCache_IsCachePath(path);
+        std::shared_ptr<MeshGeometry> loaded = std::make_shared<MeshGeometry>();
+        std::shared_ptr<MeshLevels> loadedLevels = std::make_shared<MeshLevels>();
+        bool ok = cached ? MeshCache_Load(path, loaded->mesh, loaded->chunks, loadedLevels->lods,
+                                          loadedLevels->chunks, meshStats)
+                         : Mesh_Load(path, loaded->mesh, meshStats);
+        if (!ok) {
+            fprintf(stderr, "Failed to load %s: %s\n", path, meshStats.error.c_str());
+            return false;
+        }
+        if (cached) {
+            meshBuildSeconds = 0;
+            SetMesh(std::move(loaded), std::move(loadedLevels));
+        } else {
+            Mesh_Fit(loaded->mesh, 2.0f);
+            SetMesh(std::move(loaded->mesh));
+        }
+        printf("Loaded %s (%s): %zu vertices, %zu triangles, %.1f MB in %.3f s\n",
+               path, meshStats.format, meshStats.vertexCount, meshStats.triangleCount,
+               meshStats.memoryBytes / (1024.0 * 1024.0), meshStats.seconds);
+        if (!cached)
+            printf("Built chunks in %.3f s, levels of detail follow in the background\n", meshBuildSeconds);
+        return true;
+    }
+
+    // Replace the texture with a binary PPM image
+    bool LoadTexture(const char* path) {
+        std::string error;
+        auto loaded = std::make_shared<Texture>();
+        if (!Texture_LoadPpm(path, *loaded, error)) {
+            fprintf(stderr, "Failed to load %s: %s\n", path, error.c_str());
+            return false;
+        }
+        printf("Loaded texture %s: %dx%d, %d mip levels\n", path, loaded->Width(), loaded->Height(), loaded->levelCount);
+        texture = loaded;
+        sceneChanged = true;
+        return true;
+    }
+
+    // Load a point cloud (PLY, XYZ/PTS) and fit it into a 2-unit box
+    // around the origin. It is drawn instead of the mesh from then on.
+    bool LoadPoints(const char* path) {
+        auto cloud = std::make_shared<PointCloud>();
+        if (!PointCloud_Load(path, *cloud, pointStats)) {
+            fprintf(stderr, "Failed to load %s: %s\n", path, pointStats.error.c_str());
+            return false;
+        }
+        PointCloud_Fit(*cloud, 2.0f);
+        PointCloud_BuildChunks(*cloud);
+        printf("Loaded %s (%s): %zu points in %zu chunks, %.1f MB in %.3f s\n", path, pointStats.format,
+               cloud->Count(), cloud->chunks.size(), cloud->MemoryBytes() / (1024.0 * 1024.0), pointStats.seconds);
+        SetPoints(cloud);
+        return true;
+    }
+
+    // Draw a chunked cloud (PointCloud_BuildChunks) instead of the mesh;
+    // nullptr goes back to the mesh
+    void SetPoints(std::shared_ptr<const PointCloud> cloud) {
+        points = std::move(cloud);
+        sceneChanged = true;
+    }
+
+    // Draw the next frame whole, after changing what it shows other than
+    // through the settings and the methods here (e.g. editing texture)
+    void Invalidate() { sceneChanged = true; }
+
+    bool Init(const char* meshPath = nullptr) {
+        if (meshPath) { if (!LoadMesh(meshPath)) return false; }
+        else CreateCube();
         if (!app.Init("3D Demo - Understanding 3D to 2D Projection", 1024, 960)) return false;
+        presented.Resize(app.screenWidth, app.screenHeight);
+        frame = Settings();
+        UpdateCamera();
+        return true;
+    }
+
+    // Render into app.framebuffer only, no window (build machines, benchmarks)
+    bool InitHeadless(int width, int height) {
+        if (!app.InitHeadless(width, height)) return false;
         CreateCube();
-        matProj = Mat_Proj(fov, (float)app.screenHeight / app.screenWidth, zNear, zFar);
+        frame = Settings();
+        UpdateCamera();
         return true;
     }
 
@@ -145,8 +620,44 @@ public:
             ImGui::Checkbox("Auto Rotate", &autoRotate);
             ImGui::SliderFloat("Speed", &rotSpeed, 0.1f, 5.0f);
             ImGui::SliderFloat("Rot X", &rotX, -3.14f, 3.14f);
+            ImGui::SliderFloat("Rot Y", &rotY, -3.14f, 3.14f);
             ImGui::SliderFloat("Rot Z", &rotZ, -3.14f, 3.14f);
             ImGui::SliderFloat("Distance", &objDist, 2.0f, 20.0f);
+            ImGui::SliderInt("Instances", &instanceCount, 0, 100000, "%d", ImGuiSliderFlags_Logarithmic);
+        }
+
+        if (ImGui::CollapsingHeader("Mesh")) {
+            const Mesh& mesh = geometry->mesh;
+            const MeshChunks& chunks = geometry->chunks;
+            ImGui::Text("Vertices: %zu  Triangles: %zu", mesh.VertexCount(), mesh.TriangleCount());
+            ImGui::Text("Chunks: %zu (%zu BVH nodes)", chunks.chunks.size(), chunks.bvh.nodes.size());
+            ImGui::Text("Vertex cache: %.3f vertices/triangle (%d entries)", meshAcmr, VCACHE_SIZE);
+            ImGui::Text("Texture: %dx%d, %d mip levels, %.1f MB", texture->Width(), texture->Height(),
+                        texture->levelCount, texture->MemoryBytes() / (1024.0 * 1024.0));
+            for (size_t l = 0; l < levels->lods.size(); l++)
+                ImGui::Text("LOD %zu: %zu triangles, error %.4f", l + 1, levels->lods[l].mesh.TriangleCount(),
+                            levels->lods[l].error);
+            if (levelBuilder.Running()) ImGui::TextDisabled("Building levels of detail...");
+            if (meshStats.format[0]) {
+                ImGui::Text("%s, %.1f MB file, %.1f MB in memory", meshStats.format,
+                            meshStats.fileBytes / (1024.0 * 1024.0), meshStats.memoryBytes / (1024.0 * 1024.0));
+                ImGui::Text("Loaded in %.3f s, chunks built in %.3f s", meshStats.seconds, meshBuildSeconds);
+                if (levels->seconds > 0)
+                    ImGui::Text("Levels of detail built in %.3f s in the background", levels->seconds);
+                if ((meshBuildSeconds + levels->seconds) * 1e3 > MESH_BUILD_HINT_MS)
+                    ImGui::TextDisabled("Convert to .mcache with 3D_Matrix_meshconv to skip the build");
+            }
+        }
+
+        if (PointMode() && ImGui::CollapsingHeader("Points", ImGuiTreeNodeFlags_DefaultOpen)) {
+            ImGui::Text("Points: %zu in %zu chunks, %.1f MB%s", points->Count(), points->chunks.size(),
+                        points->MemoryBytes() / (1024.0 * 1024.0), points->HasColors() ? "" : " (no colors)");
+            ImGui::Text("Drawn: %zu points from %zu chunks, %zu pixels", presentedStats.points,
+                        presentedStats.chunksVisible, presentedStats.pixels);
+            ImGui::SliderFloat("Points per Pixel", &pointDensity, 0.0f, 16.0f, pointDensity > 0 ? "%.1f" : "all");
+            if (pointStats.format[0])
+                ImGui::Text("%s, %.1f MB file, loaded in %.3f s", pointStats.format,
+                            pointStats.fileBytes / (1024.0 * 1024.0), pointStats.seconds);
         }
 
         if (ImGui::CollapsingHeader("Light")) {
@@ -158,133 +669,926 @@ public:
         if (ImGui::CollapsingHeader("Display", ImGuiTreeNodeFlags_DefaultOpen)) {
             ImGui::Checkbox("Wireframe", &showWireframe);
             ImGui::Checkbox("Filled", &showFilled);
+            ImGui::Checkbox("Textured", &textured);
+            if (textured && !geometry->mesh.HasUVs()) {
+                ImGui::SameLine();
+                ImGui::TextDisabled("(mesh has no texture coordinates)");
+            }
+            ImGui::Checkbox("Depth Test", &depthTest);
+            ImGui::Checkbox("Occlusion Culling", &occlusionCulling);
+            ImGui::Checkbox("Level of Detail", &lodEnabled);
+            ImGui::SliderFloat("LOD Error (px)", &lodPixelError, 0.25f, 8.0f);
+            ImGui::SliderInt("Raster Threads", &rasterThreads, 1, std::max(ThreadPool::HardwareThreads(), 2));
             float c[3] = {fillColor.r/255.f, fillColor.g/255.f, fillColor.b/255.f};
             if (ImGui::ColorEdit3("Color", c)) {
                 fillColor = Color((Uint8)(c[0]*255), (Uint8)(c[1]*255), (Uint8)(c[2]*255));
             }
         }
 
+        if (ImGui::CollapsingHeader("Presentation")) {
+            ImGui::Checkbox("Pipelined Rendering", &pipelined);
+            ImGui::Checkbox("Incremental Redraw", &incrementalRedraw);
+            ImGui::Text("Frames: %d full, %d partial, %d skipped", framesFull, framesPartial, framesSkipped);
+            ImGui::Combo("Present Mode", &app.presentMode, SDLApp::PresentModeNames(), SDLApp::PRESENT_MODE_COUNT);
+            if (app.presentMode == SDLApp::PRESENT_CAPPED) ImGui::SliderInt("FPS Cap", &app.fpsCap, 15, 240);
+            ImGui::Text("VSync: %s (display %d Hz)", app.vsyncOn ? "on" : "off", app.refreshRate);
+            if (ImGui::SliderFloat("Frame Budget (ms)", &frameBudgetMs, 0.0f, 50.0f, frameBudgetMs > 0 ? "%.1f" : "off") &&
+                frameBudgetMs == 0)
+                renderScale = 1.0f;
+            if (frameBudgetMs == 0) ImGui::SliderFloat("Resolution Scale", &renderScale, RESOLUTION_MIN_SCALE, 1.0f);
+            ImGui::Text("Resolution: %dx%d of %dx%d (%.0f%%)", presented.width, presented.height,
+                        app.screenWidth, app.screenHeight, renderScale * 100);
+        }
+
         if (ImGui::CollapsingHeader("Projection")) {
-            bool changed = ImGui::SliderFloat("FOV", &fov, 30, 120);
-            changed |= ImGui::SliderFloat("Near", &zNear, 0.01f, 1.0f);
-            changed |= ImGui::SliderFloat("Far", &zFar, 100, 2000);
-            if (changed) matProj = Mat_Proj(fov, (float)app.screenHeight/app.screenWidth, zNear, zFar);
+            ImGui::SliderFloat("FOV", &fov, 30, 120);
+            ImGui::SliderFloat("Near", &zNear, 0.01f, 1.0f);
+            ImGui::SliderFloat("Far", &zFar, 100, 2000);
         }
 
+#if ENGINE_PROFILER
+        if (ImGui::CollapsingHeader("Profiler")) RenderProfilerUI();
+#endif
+
         ImGui::Separator();
         ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+        if (PointMode())
+            ImGui::Text("Render: %.2f ms, %zu points drawn", presentedStats.TotalSeconds() * 1e3, presentedStats.points);
+        else
+            ImGui::Text("Render: %.2f ms, %zu triangles drawn", presentedStats.TotalSeconds() * 1e3, presentedStats.trisRaster);
+        if (recorder.Active())
+            ImGui::Text("Recording input: %d frames, %.1f KB", recorder.Frames(), recorder.Bytes() / 1024.0);
+        ImGui::Text("Frame arena: %.1f / %.1f MB (peak %.1f MB), heap allocs: %d",
+                    arenaUsed / (1024.0 * 1024.0), arenaCapacity / (1024.0 * 1024.0),
+                    arenaPeak / (1024.0 * 1024.0), arenaHeapAllocs);
         ImGui::End();
     }
 
-    void Update(float dt) {
+#if ENGINE_PROFILER
+    // Rolling per-zone timings, counter averages and trace capture
+    void RenderProfilerUI() {
+        Profiler& prof = Profiler_Get();
+        char overlay[32];
+        snprintf(overlay, sizeof(overlay), "%.2f ms", prof.Average(prof.FrameHistory()));
+        ImGui::PlotLines("Frame", prof.FrameHistory(), prof.HistorySize(), prof.Offset(),
+                         overlay, 0, FLT_MAX, ImVec2(0, 40));
+        for (int i = 0; i < prof.ZoneCount(); i++) {
+            const Profiler::Series& zone = prof.Zone(i);
+            snprintf(overlay, sizeof(overlay), "%.3f ms", prof.Average(zone.history));
+            ImGui::PlotLines(zone.name, zone.history, prof.HistorySize(), prof.Offset(),
+                             overlay, 0, FLT_MAX, ImVec2(0, 30));
+        }
+        for (int i = 0; i < prof.CounterCount(); i++) {
+            const Profiler::Series& counter = prof.Counter(i);
+            ImGui::Text("%-20s %12.0f", counter.name, prof.Average(counter.history));
+        }
+        ImGui::SliderInt("Trace Frames", &traceFrames, 1, 600);
+        if (ImGui::Button("Capture Trace") && !prof.Capturing()) prof.StartTrace(traceFrames, "trace.json");
+        ImGui::SameLine();
+        ImGui::TextUnformatted(prof.TraceStatus().c_str());
+    }
+#endif
+
+    // Movement keys held, as InputKeys
+    uint8_t InputKeysDown() const {
+        uint8_t keys = 0;
+        if (app.IsKeyDown(SDL_SCANCODE_W) || app.IsKeyDown(SDL_SCANCODE_UP)) keys |= INPUT_KEY_FORWARD;
+        if (app.IsKeyDown(SDL_SCANCODE_S) || app.IsKeyDown(SDL_SCANCODE_DOWN)) keys |= INPUT_KEY_BACK;
+        if (app.IsKeyDown(SDL_SCANCODE_A)) keys |= INPUT_KEY_LEFT;
+        if (app.IsKeyDown(SDL_SCANCODE_D)) keys |= INPUT_KEY_RIGHT;
+        return keys;
+    }
+
+    void Update(float dt) { Update(dt, InputKeysDown()); }
+
+    void Update(float dt, uint8_t keys) {
         if (autoRotate) { rotX += rotSpeed * dt; rotZ += rotSpeed * 0.5f * dt; }
 
-        vec3d fwd = Vec_Mul(lookDir, 8.0f * dt);
-        if (app.IsKeyDown(SDL_SCANCODE_W) || app.IsKeyDown(SDL_SCANCODE_UP)) camera = Vec_Add(camera, fwd);
-        if (app.IsKeyDown(SDL_SCANCODE_S) || app.IsKeyDown(SDL_SCANCODE_DOWN)) camera = Vec_Sub(camera, fwd);
-        if (app.IsKeyDown(SDL_SCANCODE_A)) camRotY += dt;
-        if (app.IsKeyDown(SDL_SCANCODE_D)) camRotY -= dt;
+        vec3d fwd = Vec_Mul(Aff_MulDir(Aff_RotEuler(camRotX, camRotY, 0), vec3d{0, 0, 1}), 8.0f * dt);
+        if (keys & INPUT_KEY_FORWARD) camera = Vec_Add(camera, fwd);
+        if (keys & INPUT_KEY_BACK) camera = Vec_Sub(camera, fwd);
+        if (keys & INPUT_KEY_LEFT) camRotY += dt;
+        if (keys & INPUT_KEY_RIGHT) camRotY -= dt;
+    }
+
+    // Record every main loop iteration from now on. The mesh, texture and
+    // point cloud paths (nullptr: built-in or none) go into the log, so a
+    // replay loads the same.
+    bool StartRecording(const char* path, const char* meshPath, const char* texturePath, const char* pointsPath) {
+        InputLogHeader header;
+        header.width = app.screenWidth;
+        header.height = app.screenHeight;
+        header.meshPath = meshPath ? meshPath : "";
+        header.texturePath = texturePath ? texturePath : "";
+        header.pointsPath = pointsPath ? pointsPath : "";
+        Settings().Pack(header.settings);
+        std::string error;
+        if (!recorder.Open(path, header, error)) {
+            fprintf(stderr, "Failed to record to %s: %s\n", path, error.c_str());
+            return false;
+        }
+        recordPath = path;
+        return true;
+    }
+
+    void StopRecording() {
+        if (!recorder.Active()) return;
+        int frames = recorder.Frames();
+        size_t bytes = recorder.Bytes();
+        if (recorder.Close()) printf("Recorded %d frames (%.1f KB) to %s\n", frames, bytes / 1024.0, recordPath.c_str());
+        else fprintf(stderr, "Failed to write %s\n", recordPath.c_str());
+    }
+
+    // One main loop iteration's input: keys and dt as given to Update(),
+    // the settings if the control panel changed them (beforeUI: packed
+    // settings after Update()), a window resize waiting to be applied, and
+    // whether the next frame takes the levels of detail
+    void RecordFrame(float dt, uint8_t keys, const std::vector<uint8_t>& beforeUI) {
+        InputFrame f;
+        f.dt = dt;
+        f.keys = keys;
+        Settings().Pack(f.settings);
+        if (f.settings == beforeUI) f.settings.clear();
+        f.width = app.pendingWidth;
+        f.height = app.pendingHeight;
+        f.levels = levelsDue;
+        std::string error;
+        if (!recorder.Write(f, error)) {
+            fprintf(stderr, "%s, recording stopped\n", error.c_str());
+            recorder.Close();
+        }
+    }
+
+    // Replay one recorded iteration in place of input, Update() and the
+    // UI; DrawFrame() next draws what the recorded session drew
+    bool ApplyInput(const InputFrame& f) {
+        Update(f.dt, f.keys);
+        if (!f.settings.empty() && !FrameSettings::Unpack(f.settings)) return false;
+        if (f.width > 0 && f.height > 0) {
+            app.pendingWidth = f.width;
+            app.pendingHeight = f.height;
+        }
+        if (f.levels) levelsDue = true;
+        return true;
     }
 
+    // Draw the current settings into app.framebuffer
     void Render() {
-        vec3d up = {0, 1, 0}, target = {0, 0, 1}, offset = {1, 1, 0};
+        frame = Settings();
+        RenderFrame();
+    }
 
-        // Step 1: Build Camera Matrix (View Matrix)
-        mat4x4 camRot = Mat_Mul(Mat_RotX(camRotX), Mat_RotY(camRotY));
-        lookDir = Mat_MulVec(camRot, target);
-        target = Vec_Add(camera, lookDir);
-        mat4x4 matView = Mat_QuickInv(Mat_PointAt(camera, target, up));
+    // Draw the `frame` snapshot; runs on the render thread when pipelined
+    void RenderFrame() {
+        PROFILE_SCOPE("Render");
+        typedef std::chrono::steady_clock Clock;
+        auto seconds = [](Clock::time_point a, Clock::time_point b) {
+            return std::chrono::duration<double>(b - a).count();
+        };
+        Clock::time_point t0 = Clock::now();
+        vec3d offset = {1, 1, 0};
 
-        // Step 2: Build World Matrix (Model Transform)
-        mat4x4 matWorld = Mat_Mul(Mat_Mul(Mat_RotZ(rotZ), Mat_RotX(rotX)), Mat_Trans(0, 0, objDist));
+        // Step 1: Camera Matrix (View Matrix) and world transforms of whatever
+        // moved since the last frame. The object origin is the scene root.
+        UpdateCamera();
+        if (frame.objDist != placedDist) {
+            scene.SetLocal(sceneRoot, Aff_RotEulerTrans(0, 0, 0, 0, 0, frame.objDist));
+            placedDist = frame.objDist;
+        }
+        {
+            PROFILE_SCOPE("Scene Update");
+            PROFILE_COUNT("Nodes Updated", scene.Update());
+        }
 
-        std::vector<triangle> trisToRaster;
+        {
+            PROFILE_SCOPE("BVH Refit");
+            UpdateInstanceBvh();
+        }
+        if (PointMode()) {
+            RenderPoints();
+            return;
+        }
 
-        for (auto& tri : cubeTris) {
-            triangle triTrans, triView, triProj;
+        // Step 2: Walk the instance BVH: subtrees outside the frustum or
+        // hidden behind last frame's depth are dropped whole. The bounds are
+        // spin-invariant, so this needs no new matrices.
+        // A partial redraw culls to the frustum of its bounding rectangle, and
+        // not against last frame's depth, which would keep whatever the moved
+        // instances uncovered hidden until the next full frame.
+        Framebuffer& fb = app.framebuffer;
+        bool partial = !redraw.full;
+        mat4x4 regionClip = partial ? DirtyRegion_ClipMatrix(redraw.bounds, fb.width, fb.height) : Mat_Identity();
+        Frustum cullFrustum = partial ? Frustum_FromMatrix(Mat_Mul(matViewProj, regionClip)) : frustum;
+        bool occlude = !partial && frame.occlusionCulling && frame.depthTest && frame.showFilled &&
+                       occlusion.Ready(fb.width, fb.height);
+        size_t nInst = std::max<size_t>(instances.Count(), 1);
+        const int* nodes = instances.Count() ? instances.nodes.data() : &objectNode;
+        visibleInstances = frameArena.AllocArray<uint32_t>(nInst);
+        uint8_t* instanceInside = frameArena.AllocArray<uint8_t>(nInst);
+        size_t nVisInst = 0, bvhVisited = 0;
+        {
+            PROFILE_SCOPE("Instance Cull");
+            auto hidden = [&](const Aabb& box) { return occlude && occlusion.BoxHidden(box, matViewProj); };
+            bvhVisited += instanceBvh.Query(cullFrustum, hidden, [&](const uint32_t* prims, uint32_t count, int mask) {
+                for (uint32_t i = 0; i < count; i++) {
+                    int node = nodes[prims[i]];
+                    if (mask && !Frustum_SphereVisible(cullFrustum, scene.WorldCenter(node), scene.WorldRadius(node)))
+                        continue;
+                    instanceInside[nVisInst] = mask == 0;
+                    visibleInstances[nVisInst++] = prims[i];
+                }
+            });
+            SortNearToFar(nodes, visibleInstances, instanceInside, nVisInst);
+        }
 
-            // Step 3: Apply World Transform
-            for (int i = 0; i < 3; i++) triTrans.p[i] = Mat_MulVec(matWorld, tri.p[i]);
+        // Step 2b: World Matrices (Model Transform) of the visible instances,
+        // turn (RotY) and spin (RotZ × RotX) first, then the node's world transform
+        instanceWorld = frameArena.AllocArray<mat4x3>(std::max<size_t>(nVisInst, 1));
+        mat4x4* instanceMVP = frameArena.AllocArray<mat4x4>(std::max<size_t>(nVisInst, 1));
+        mat4x3 spin = ObjectSpin();
+        for (size_t k = 0; k < nVisInst; k++) {
+            instanceWorld[k] = Aff_Mul(spin, scene.World(nodes[visibleInstances[k]]));
+            instanceMVP[k] = Mat_MVP(instanceWorld[k], matView, matProj);
+        }
 
-            // Step 4: Calculate Normal (for lighting and culling)
-            vec3d n = Vec_Norm(Vec_Cross(Vec_Sub(triTrans.p[1], triTrans.p[0]),
-                                          Vec_Sub(triTrans.p[2], triTrans.p[0])));
+        // Step 2c: Level of detail per visible instance. Instance k gets the
+        // vertex slots [vertBase[k], vertBase[k + 1]) of the transform output.
+        instanceLevel = frameArena.AllocArray<uint8_t>(std::max<size_t>(nVisInst, 1));
+        vertBase = frameArena.AllocArray<size_t>(nVisInst + 1);
+        if (instanceLod.size() != nInst) instanceLod.assign(nInst, 0);
+        size_t nTris = LodMesh(0).TriangleCount(), drawnTris = 0, nSlots = 0, chunkSlots = 0;
+        {
+            PROFILE_SCOPE("LOD Select");
+            for (size_t k = 0; k < nVisInst; k++) {
+                int level = SelectLod(visibleInstances[k], nodes[visibleInstances[k]], instanceWorld[k]);
+                instanceLevel[k] = (uint8_t)level;
+                vertBase[k] = nSlots;
+                nSlots += LodMesh(level).VertexCount();
+                drawnTris += LodMesh(level).TriangleCount();
+                chunkSlots += LodChunks(level).chunks.size();
+            }
+            vertBase[nVisInst] = nSlots;
+        }
 
-            // Step 5: Backface Culling
-            if (Vec_Dot(n, Vec_Sub(triTrans.p[0], camera)) < 0) {
-                // Step 6: Calculate Lighting
-                float dp = std::max(0.1f, Vec_Dot(Vec_Norm(light), n));
-                triProj.color = fillColor * dp;
+        // Step 2d: Walk the chunk BVH of each visible instance in object space
+        // (the planes of its MVP matrix), then merge the vertex ranges the
+        // visible chunks and their neighbours own.
+        size_t maxChunks = LodChunks(0).chunks.size();
+        for (const MeshChunks& c : levels->chunks) maxChunks = std::max(maxChunks, c.chunks.size());
+        chunkStart = frameArena.AllocArray<uint32_t>(nVisInst + 1);
+        visibleChunks = frameArena.AllocArray<uint32_t>(std::max<size_t>(chunkSlots, 1));
+        rangeStart = frameArena.AllocArray<uint32_t>(nVisInst + 1);
+        vertexRanges = frameArena.AllocArray<VertexRange>(std::max<size_t>(chunkSlots, 1));
+        uint8_t* chunkNeeded = frameArena.AllocArray<uint8_t>(std::max<size_t>(maxChunks, 1));
+        size_t nVisChunks = 0, nRanges = 0, nOut = 0;
+        {
+            PROFILE_SCOPE("Chunk Cull");
+            for (size_t k = 0; k < nVisInst; k++) {
+                chunkStart[k] = (uint32_t)nVisChunks;
+                rangeStart[k] = (uint32_t)nRanges;
+                const MeshChunks& chunks = LodChunks(instanceLevel[k]);
+                size_t nChunks = chunks.chunks.size();
+                size_t nVerts = LodMesh(instanceLevel[k]).VertexCount();
+                if (nChunks == 1 || (instanceInside[k] && !occlude)) {
+                    for (size_t c = 0; c < nChunks; c++) visibleChunks[nVisChunks++] = (uint32_t)c;
+                    if (nVerts) vertexRanges[nRanges++] = {0, (uint32_t)nVerts};
+                    nOut += nVerts;
+                    continue;
+                }
+                const mat4x4& mvp = instanceMVP[k];
+                memset(chunkNeeded, 0, nChunks);
+                auto hidden = [&](const Aabb& box) { return occlude && occlusion.BoxHidden(box, mvp); };
+                bvhVisited += chunks.bvh.Query(Frustum_FromMatrix(partial ? Mat_Mul(mvp, regionClip) : mvp), hidden,
+                                               [&](const uint32_t* prims, uint32_t count, int) {
+                    for (uint32_t i = 0; i < count; i++) {
+                        const MeshChunk& chunk = chunks.chunks[prims[i]];
+                        visibleChunks[nVisChunks++] = prims[i];
+                        chunkNeeded[prims[i]] = 1;
+                        for (uint32_t d = 0; d < chunk.depCount; d++) chunkNeeded[chunks.deps[chunk.depFirst + d]] = 1;
+                    }
+                });
+                // Chunks own consecutive vertex ranges: merge neighbours
+                for (size_t c = 0; c < nChunks; c++) {
+                    if (!chunkNeeded[c]) continue;
+                    const MeshChunk& chunk = chunks.chunks[c];
+                    VertexRange* last = nRanges > rangeStart[k] ? &vertexRanges[nRanges - 1] : nullptr;
+                    if (last && last->first + last->count == chunk.vertFirst) last->count += chunk.vertEnd - chunk.vertFirst;
+                    else vertexRanges[nRanges++] = {chunk.vertFirst, chunk.vertEnd - chunk.vertFirst};
+                    nOut += chunk.vertEnd - chunk.vertFirst;
+                }
+            }
+            chunkStart[nVisInst] = (uint32_t)nVisChunks;
+            rangeStart[nVisInst] = (uint32_t)nRanges;
+        }
 
-                // Step 7: Apply View Transform (World -> Camera Space)
-                for (int i = 0; i < 3; i++) triView.p[i] = Mat_MulVec(matView, triTrans.p[i]);
-                triView.color = triProj.color;
+        trisToRaster.Init(frameArena, drawnTris);
+        bool texturing = Textured();
+        if (texturing) trisUV.Init(frameArena, drawnTris);
+        if (frame.depthTest) {
+            PROFILE_SCOPE("Depth Clear");
+            if (partial) for (const RasterRect& r : redraw.rects) fb.depth.ClearRect(r.x0, r.y0, r.x1, r.y1);
+            else fb.depth.Clear();
+        }
 
-                // Step 8: Clip against near plane
-                triangle clipped[2];
-                int nClip = ClipTriangle({0,0,0.1f}, {0,0,1}, triView, clipped[0], clipped[1]);
+        // Steps 7+9 run over the needed vertex ranges at once (SoA batches):
+        // object -> clip space in one pass with the fused MVP matrix, plus
+        // one clip outcode per vertex. Culling and lighting work in object
+        // space, so there is no world-space pass. Visible instance k owns
+        // entries [vertBase[k], vertBase[k + 1]), of which only its ranges
+        // are written.
+        clipVerts.Alloc(frameArena, nSlots, true);
+        clipCodes = frameArena.AllocArray<uint8_t>(nSlots);
+        {
+            PROFILE_SCOPE("View+Proj Transform");
+            for (size_t k = 0; k < nVisInst; k++) {
+                const Mesh& lod = LodMesh(instanceLevel[k]);
+                for (uint32_t r = rangeStart[k]; r < rangeStart[k + 1]; r++) {
+                    size_t v = vertexRanges[r].first, o = vertBase[k] + v;
+                    Mat_MulVecBatch(instanceMVP[k], &lod.x[v], &lod.y[v], &lod.z[v],
+                                    clipVerts.x + o, clipVerts.y + o, clipVerts.z + o, clipVerts.w + o,
+                                    vertexRanges[r].count);
+                }
+            }
+        }
+        {
+            PROFILE_SCOPE("Outcodes");
+            for (size_t k = 0; k < nVisInst; k++) {
+                for (uint32_t r = rangeStart[k]; r < rangeStart[k + 1]; r++) {
+                    size_t o = vertBase[k] + vertexRanges[r].first;
+                    for (size_t i = o; i < o + vertexRanges[r].count; i++)
+                        clipCodes[i] = Clip_Outcode(clipVerts.x[i], clipVerts.y[i], clipVerts.z[i], clipVerts.w[i]);
+                }
+            }
+        }
+        Clock::time_point t1 = Clock::now();
+
+        // Steps 4-8: Cull and light the triangles of the visible chunks with
+        // the mesh's face planes, keeping the surviving triangle indices. The
+        // camera and light go to object space once per instance instead.
+        size_t nCull = drawnTris;
+        visibleTris = frameArena.AllocArray<uint32_t>(nCull);
+        visibleSlots = frameArena.AllocArray<uint32_t>(nCull);
+        visibleColors = frameArena.AllocArray<Color>(nCull);
+        visibleCount = 0;
+        size_t tested = 0, outside = 0;
+        vec3d lightDir = Vec_Norm(frame.light);
+        {
+            PROFILE_SCOPE("Cull+Light");
+            for (size_t k = 0; k < nVisInst; k++) {
+                size_t base = vertBase[k];
+                const uint8_t* codes = clipCodes + base;
+                // Textures show their own colors on the single object, tinted on instances
+                Color color = instances.Count() ? instances.colors[visibleInstances[k]]
+                                                : texturing ? Color::White() : frame.fillColor;
+                const Mesh& lod = LodMesh(instanceLevel[k]);
+                const MeshChunks& chunks = LodChunks(instanceLevel[k]);
+                mat4x3 toObject = Aff_Inverse(instanceWorld[k]);
+                vec3d eye = Aff_MulVec(toObject, frame.camera);
+                vec3d lightObj = Vec_Norm(Aff_MulDir(toObject, lightDir));
+                for (uint32_t c = chunkStart[k]; c < chunkStart[k + 1]; c++) {
+                    const MeshChunk& chunk = chunks.chunks[visibleChunks[c]];
+                    tested += chunk.triCount;
+                    for (size_t t = chunk.triFirst; t < chunk.triFirst + chunk.triCount; t++) {
+                        const uint32_t* idx = &lod.indices[t * 3];
+
+                        // Step 8: Trivially reject triangles entirely outside one frustum plane
+                        uint8_t c0 = codes[idx[0]], c1 = codes[idx[1]], c2 = codes[idx[2]];
+                        if (c0 & c1 & c2 & CLIP_REJECT_MASK) { outside++; continue; }
 
-                for (int c = 0; c < nClip; c++) {
-                    // Step 9: Apply Projection Transform (Camera -> NDC)
+                        // Steps 4+5: Backface Culling, the eye behind the face's plane
+                        float nx = lod.nx[t], ny = lod.ny[t], nz = lod.nz[t];
+                        if (nx * eye.x + ny * eye.y + nz * eye.z <= lod.nd[t]) continue;
+
+                        // Step 6: Calculate Lighting
+                        float dp = std::max(0.1f, nx * lightObj.x + ny * lightObj.y + nz * lightObj.z);
+                        visibleTris[visibleCount] = (uint32_t)t;
+                        visibleSlots[visibleCount] = (uint32_t)k;
+                        visibleColors[visibleCount] = color * dp;
+                        visibleCount++;
+                    }
+                }
+            }
+        }
+        outside += nTris * (nInst - nVisInst) + drawnTris - tested;     // Whole instances and chunks culled
+        Clock::time_point t2 = Clock::now();
+
+        // Step 10: Clip space -> screen space
+        auto toScreen = [&](vec3d p) {
+            // Perspective division: divide by w to get normalized coords
+            float w = p.w;
+            p = Vec_Div(p, w);
+            // Invert X and Y (screen coordinate convention)
+            p.x *= -1; p.y *= -1;
+            p = Vec_Add(p, offset);
+            p.x *= 0.5f * fb.width;
+            p.y *= 0.5f * fb.height;
+            p.w = 1.0f / w;  // Kept for depth testing (after Vec_Add, which resets w)
+            return p;
+        };
+
+        size_t clipped = 0;
+        {
+            PROFILE_SCOPE("Clip+Project");
+            for (size_t v = 0; v < visibleCount; v++) {
+                const Mesh& lod = LodMesh(instanceLevel[visibleSlots[v]]);
+                const uint32_t* tri = &lod.indices[visibleTris[v] * 3];
+                size_t base = vertBase[visibleSlots[v]];
+                size_t idx[3] = {base + tri[0], base + tri[1], base + tri[2]};
+                uint8_t c0 = clipCodes[idx[0]], c1 = clipCodes[idx[1]], c2 = clipCodes[idx[2]];
+                triangle triProj;
+                triProj.color = visibleColors[v];
+                RasterUV uv;
+                if (texturing) {
+                    for (int i = 0; i < 3; i++) { uv.u[i] = lod.u[tri[i]]; uv.v[i] = lod.v[tri[i]]; }
+                }
+
+                // Step 9: Inside near/far and the guard band -> no clipping at all,
+                // the rasterizer scissors whatever lies outside the screen
+                if (!((c0 | c1 | c2) & CLIP_NEEDED_MASK)) {
+                    for (int i = 0; i < 3; i++) triProj.p[i] = toScreen(clipVerts.Get(idx[i]));
+                    trisToRaster.push_back(triProj);
+                    if (texturing) trisUV.push_back(uv);
+                    continue;
+                }
+
+                // Step 9b: Clip in homogeneous space, then fan-triangulate the
+                // polygon; texture coordinates are clipped along
+                ClipVertex in[3], poly[CLIP_MAX_VERTS];
+                for (int i = 0; i < 3; i++) {
+                    in[i].p = clipVerts.Get(idx[i]);
+                    if (texturing) { in[i].u = uv.u[i]; in[i].v = uv.v[i]; }
+                }
+                clipped++;
+                int nPoly = Clip_Triangle(in, c0 | c1 | c2, poly);
+                for (int k = 1; k + 1 < nPoly; k++) {
+                    const ClipVertex* fan[3] = {&poly[0], &poly[k], &poly[k + 1]};
                     for (int i = 0; i < 3; i++) {
-                        triProj.p[i] = Mat_MulVec(matProj, clipped[c].p[i]);
-                        // Perspective division: divide by w to get normalized coords
-                        triProj.p[i] = Vec_Div(triProj.p[i], triProj.p[i].w);
-                        // Invert X and Y (screen coordinate convention)
-                        triProj.p[i].x *= -1; triProj.p[i].y *= -1;
-                        // Step 10: Transform to Screen Space
-                        triProj.p[i] = Vec_Add(triProj.p[i], offset);
-                        triProj.p[i].x *= 0.5f * app.screenWidth;
-                        triProj.p[i].y *= 0.5f * app.screenHeight;
+                        triProj.p[i] = toScreen(fan[i]->p);
+                        uv.u[i] = fan[i]->u; uv.v[i] = fan[i]->v;
                     }
-                    triProj.color = clipped[c].color;
                     trisToRaster.push_back(triProj);
+                    if (texturing) trisUV.push_back(uv);
                 }
             }
         }
+        Clock::time_point t3 = Clock::now();
+
+        Rasterize();
+        Clock::time_point t4 = Clock::now();
+
+        // Keep this frame's tile depths as the occluders of the next one
+        if (frame.occlusionCulling && frame.depthTest && frame.showFilled) occlusion.Capture(fb.depth);
+        else occlusion.Invalidate();
+
+        stats.instances = nInst;
+        stats.instancesVisible = nVisInst;
+        stats.chunksVisible = nVisChunks;
+        stats.vertices = nOut;
+        stats.vertexRefs = tested * 3;
+        stats.trisIn = nTris * nInst;
+        stats.trisLod = nTris * nVisInst - drawnTris;
+        stats.trisOutside = outside;
+        stats.trisVisible = visibleCount;
+        stats.trisClipped = clipped;
+        stats.trisRaster = trisToRaster.size;
+        stats.seconds[RenderStats::TRANSFORM] = seconds(t0, t1);
+        stats.seconds[RenderStats::CULL] = seconds(t1, t2);
+        stats.seconds[RenderStats::CLIP] = seconds(t2, t3);
+        stats.seconds[RenderStats::RASTER] = seconds(t3, t4);
+        redraw.SetFull();           // Until DrawFrame() plans the next one
 
-        // Step 11: Clip against screen edges and draw
-        for (auto& tri : trisToRaster) {
-            triangle clipped[2];
-            std::list<triangle> triList; triList.push_back(tri);
-            int nNew = 1;
-
-            for (int p = 0; p < 4; p++) {
-                while (nNew > 0) {
-                    triangle t = triList.front(); triList.pop_front(); nNew--;
-                    int nAdd = 0;
-                    switch (p) {
-                        case 0: nAdd = ClipTriangle({0,0,0}, {0,1,0}, t, clipped[0], clipped[1]); break;
-                        case 1: nAdd = ClipTriangle({0,(float)app.screenHeight-1,0}, {0,-1,0}, t, clipped[0], clipped[1]); break;
-                        case 2: nAdd = ClipTriangle({0,0,0}, {1,0,0}, t, clipped[0], clipped[1]); break;
-                        case 3: nAdd = ClipTriangle({(float)app.screenWidth-1,0,0}, {-1,0,0}, t, clipped[0], clipped[1]); break;
+        PROFILE_COUNT("Instances Culled", nInst - nVisInst);
+        PROFILE_COUNT("Chunks Drawn", nVisChunks);
+        PROFILE_COUNT("Vertices Transformed", nOut);
+        PROFILE_COUNT("Vertex Hit Rate %", (int64_t)(stats.VertexHitRate() * 100));
+        PROFILE_COUNT("BVH Nodes Visited", bvhVisited);
+        PROFILE_COUNT("Tris In", stats.trisIn);
+        PROFILE_COUNT("Tris LOD Skipped", stats.trisLod);
+        PROFILE_COUNT("Tris Culled", outside);
+        PROFILE_COUNT("Tris Backfacing", stats.trisIn - stats.trisLod - outside - visibleCount);
+        PROFILE_COUNT("Tris Clipped", clipped);
+        PROFILE_COUNT("Tris Emitted", trisToRaster.size);
+        PROFILE_COUNT("Pixels Filled", stats.pixels);
+    }
+
+    // Turn (RotY) and spin (RotZ × RotX) of the object in place, applied
+    // before its node's world transform
+    mat4x3 ObjectSpin() const {
+        mat4x3 spin = Aff_RotEuler(frame.rotX, 0, frame.rotZ);
+        if (frame.rotY != 0) spin = Aff_Mul(Aff_RotEuler(0, frame.rotY, 0), spin);
+        return spin;
+    }
+
+    // Point cloud path of RenderFrame(), the cloud being the single object
+    // (instances are not drawn). Chunks are culled in object space against
+    // the planes of the MVP matrix and thinned out with distance, splatted
+    // on the raster threads, then resolved into the framebuffer. Stages:
+    // cull = chunk culling, transform = projection and splatting, raster =
+    // resolve.
+    void RenderPoints() {
+        typedef std::chrono::steady_clock Clock;
+        auto seconds = [](Clock::time_point a, Clock::time_point b) {
+            return std::chrono::duration<double>(b - a).count();
+        };
+        Clock::time_point t0 = Clock::now();
+        Framebuffer& fb = app.framebuffer;
+        const PointCloud& cloud = *points;
+        mat4x3 world = Aff_Mul(ObjectSpin(), scene.World(objectNode));
+        mat4x4 mvp = Mat_MVP(world, matView, matProj);
+
+        // A chunk draws a prefix of its shuffled points: pointDensity per
+        // pixel of the disc its bounding sphere covers at its nearest depth
+        struct ChunkDraw { uint32_t chunk, count; };
+        ChunkDraw* draws = frameArena.AllocArray<ChunkDraw>(std::max<size_t>(cloud.chunks.size(), 1));
+        size_t nDraws = 0, drawn = 0, bvhVisited = 0;
+        {
+            PROFILE_SCOPE("Point Cull");
+            float scale = Aff_MaxScale(world);
+            float pixelsPerUnit = matProj.m[1][1] * 0.5f * fb.height * scale;
+            auto visit = [&](const uint32_t* prims, uint32_t count, int) {
+                for (uint32_t i = 0; i < count; i++) {
+                    const PointChunk& chunk = cloud.chunks[prims[i]];
+                    uint32_t n = chunk.count;
+                    float depth = Mat_MulVec(mvp, chunk.center).w - chunk.radius * scale;
+                    if (frame.pointDensity > 0 && depth > frame.zNear) {
+                        float r = pixelsPerUnit * chunk.radius / depth;
+                        n = (uint32_t)std::min((float)n, 3.14159f * r * r * frame.pointDensity + 1);
                     }
-                    for (int w = 0; w < nAdd; w++) triList.push_back(clipped[w]);
+                    draws[nDraws++] = {prims[i], n};
+                    drawn += n;
                 }
-                nNew = (int)triList.size();
+            };
+            bvhVisited = cloud.bvh.Query(Frustum_FromMatrix(mvp), [](const Aabb&) { return false; }, visit);
+        }
+        Clock::time_point t1 = Clock::now();
+
+        // One task per run of chunks with about POINT_TASK_POINTS points
+        uint32_t* taskStart = frameArena.AllocArray<uint32_t>(nDraws + 1);
+        int nTasks = 0;
+        size_t taskPoints = 0;
+        for (size_t d = 0; d < nDraws; d++) {
+            if (taskPoints == 0) taskStart[nTasks++] = (uint32_t)d;
+            taskPoints += draws[d].count;
+            if (taskPoints >= POINT_TASK_POINTS) taskPoints = 0;
+        }
+        taskStart[nTasks] = (uint32_t)nDraws;
+
+        splats.Resize(fb.width, fb.height);
+        rasterPool.SetThreadCount(frame.rasterThreads);
+        SplatScratch* scratch = frameArena.AllocArray<SplatScratch>(rasterPool.ThreadCount());
+        mat4x4 toScreen = Mat_Mul(mvp, Splat_ViewportMatrix(fb.width, fb.height));
+        const uint32_t* colors = cloud.HasColors() ? cloud.colors.data() : nullptr;
+        uint32_t fill = frame.fillColor.Pack();
+        std::atomic<size_t> onScreen{0};
+        {
+            PROFILE_SCOPE("Splat");
+            rasterPool.ParallelFor(nTasks, [&](int task, int worker) {
+                size_t n = 0;
+                for (uint32_t d = taskStart[task]; d < taskStart[task + 1]; d++) {
+                    size_t first = cloud.chunks[draws[d].chunk].first;
+                    n += Splat_Points(splats, toScreen, &cloud.x[first], &cloud.y[first], &cloud.z[first],
+                                      colors ? colors + first : nullptr, fill, draws[d].count, scratch[worker]);
+                }
+                onScreen.fetch_add(n, std::memory_order_relaxed);
+            });
+        }
+        Clock::time_point t2 = Clock::now();
+
+        std::atomic<size_t> covered{0};
+        {
+            PROFILE_SCOPE("Resolve");
+            int bands = (fb.height + RASTER_TILE - 1) / RASTER_TILE;
+            rasterPool.ParallelFor(bands, [&](int band, int) {
+                int y0 = band * RASTER_TILE;
+                covered.fetch_add(Splat_Resolve(splats, fb, y0, std::min(fb.height, y0 + RASTER_TILE)),
+                                  std::memory_order_relaxed);
+            });
+        }
+        Clock::time_point t3 = Clock::now();
+        occlusion.Invalidate();
+
+        stats = RenderStats();
+        stats.instances = 1;
+        stats.instancesVisible = nDraws ? 1 : 0;
+        stats.chunksVisible = nDraws;
+        stats.vertices = drawn;
+        stats.points = drawn;
+        stats.pixels = covered.load();
+        stats.seconds[RenderStats::CULL] = seconds(t0, t1);
+        stats.seconds[RenderStats::TRANSFORM] = seconds(t1, t2);
+        stats.seconds[RenderStats::RASTER] = seconds(t2, t3);
+        redraw.SetFull();
+
+        (void)bvhVisited;   // Only counted when ENGINE_PROFILER is on
+        PROFILE_COUNT("BVH Nodes Visited", bvhVisited);
+        PROFILE_COUNT("Point Chunks Drawn", nDraws);
+        PROFILE_COUNT("Points Drawn", drawn);
+        PROFILE_COUNT("Points On Screen", onScreen.load());
+        PROFILE_COUNT("Pixels Filled", stats.pixels);
+    }
+
+    // Level of detail of instance `inst` this frame: the coarsest whose
+    // error stays within lodPixelError when projected at the nearest depth
+    // of its bounds. Going coarser needs the error well under the limit,
+    // going finer only that it is over, so nothing flips at the boundary.
+    int SelectLod(uint32_t inst, int node, const mat4x3& world) {
+        const float HYSTERESIS = 0.7f;
+        int level = frame.lodEnabled ? std::min<int>(instanceLod[inst], LodCount() - 1) : 0;
+        float depth = Mat_MulVec(matViewProj, scene.WorldCenter(node)).w - scene.WorldRadius(node);
+        if (depth <= frame.zNear) level = 0;
+        else if (frame.lodEnabled) {
+            // Pixels one mesh unit covers at that depth
+            float pixels = matProj.m[1][1] * 0.5f * app.framebuffer.height / depth * Aff_MaxScale(world);
+            while (level > 0 && LodError(level) * pixels > frame.lodPixelError) level--;
+            while (level + 1 < LodCount() && LodError(level + 1) * pixels < frame.lodPixelError * HYSTERESIS) level++;
+        }
+        instanceLod[inst] = (uint8_t)level;
+        return level;
+    }
+
+    // Order the visible instances by depth so hierarchical Z rejects as much
+    // as possible: a counting sort over coarse depth buckets, stable, so the
+    // BVH order is kept within a bucket
+    void SortNearToFar(const int* nodes, uint32_t* visible, uint8_t* inside, size_t n) {
+        const int BUCKETS = 256;
+        if (n < 2) return;
+        const Plane& front = frustum.planes[0];
+        float* depth = frameArena.AllocArray<float>(n);
+        float lo = FLT_MAX, hi = -FLT_MAX;
+        for (size_t i = 0; i < n; i++) {
+            depth[i] = Plane_Dist(front, scene.WorldCenter(nodes[visible[i]]));
+            lo = std::min(lo, depth[i]);
+            hi = std::max(hi, depth[i]);
+        }
+        float scale = hi > lo ? (BUCKETS - 1) / (hi - lo) : 0.0f;
+        uint32_t start[BUCKETS + 1] = {};
+        uint8_t* bucket = frameArena.AllocArray<uint8_t>(n);
+        for (size_t i = 0; i < n; i++) {
+            bucket[i] = (uint8_t)((depth[i] - lo) * scale);
+            start[bucket[i] + 1]++;
+        }
+        for (int b = 0; b < BUCKETS; b++) start[b + 1] += start[b];
+        uint32_t* sorted = frameArena.AllocArray<uint32_t>(n);
+        uint8_t* sortedInside = frameArena.AllocArray<uint8_t>(n);
+        for (size_t i = 0; i < n; i++) {
+            uint32_t at = start[bucket[i]]++;
+            sorted[at] = visible[i];
+            sortedInside[at] = inside[i];
+        }
+        memcpy(visible, sorted, n * sizeof(uint32_t));
+        memcpy(inside, sortedInside, n);
+    }
+
+    // Step 12: Rasterize trisToRaster. Triangles are binned into screen tiles
+    // and the tiles are drawn in parallel; each tile keeps submission order,
+    // so the image is identical for any thread count. Only the redraw
+    // region is written.
+    void Rasterize() {
+        PROFILE_SCOPE("Raster");
+        Framebuffer& fb = app.framebuffer;
+        Uint32 white = Color::White().Pack();
+        const Texture* tex = Textured() ? texture.get() : nullptr;
+        // Draws trisToRaster[i], returns the filled pixel count
+        auto drawTri = [&](size_t i, const RasterRect& r) {
+            const triangle& t = trisToRaster[i];
+            int pixels = 0;
+            if (frame.showFilled)
+                pixels = Raster_FillTriangle(fb, t.p[0], t.p[1], t.p[2], t.color.Pack(), r, frame.depthTest,
+                                             tex, tex ? &trisUV[i] : nullptr);
+            if (frame.showWireframe) {
+                Raster_DrawLine(fb, t.p[0], t.p[1], white, r, frame.depthTest);
+                Raster_DrawLine(fb, t.p[1], t.p[2], white, r, frame.depthTest);
+                Raster_DrawLine(fb, t.p[2], t.p[0], white, r, frame.depthTest);
             }
+            return pixels;
+        };
+
+        rasterPool.SetThreadCount(frame.rasterThreads);
+        if (rasterPool.ThreadCount() == 1) {
+            size_t pixels = 0;
+            redraw.ForEach(Raster_FullRect(fb), [&](const RasterRect& r) {
+                for (size_t i = 0; i < trisToRaster.size; i++) pixels += drawTri(i, r);
+            });
+            stats.pixels = pixels;
+            return;
+        }
+
+        // Bin in two passes (count, then fill) into one flat index array
+        int tilesX = (fb.width + RASTER_TILE - 1) / RASTER_TILE;
+        int tilesY = (fb.height + RASTER_TILE - 1) / RASTER_TILE;
+        int nTiles = tilesX * tilesY;
+        {
+            PROFILE_SCOPE("Bin");
+            struct TileRange { int16_t x0, y0, x1, y1; };
+            TileRange* ranges = frameArena.AllocArray<TileRange>(trisToRaster.size);
+            tileBinStart = frameArena.AllocArray<uint32_t>(nTiles + 1);
+            memset(tileBinStart, 0, (nTiles + 1) * sizeof(uint32_t));
 
-            for (auto& t : triList) {
-                if (showFilled)
-                    app.FillTriangle((int)t.p[0].x, (int)t.p[0].y, (int)t.p[1].x, (int)t.p[1].y,
-                                     (int)t.p[2].x, (int)t.p[2].y, t.color);
-                if (showWireframe)
-                    app.DrawTriangle((int)t.p[0].x, (int)t.p[0].y, (int)t.p[1].x, (int)t.p[1].y,
-                                     (int)t.p[2].x, (int)t.p[2].y, Color::White());
+            for (size_t i = 0; i < trisToRaster.size; i++) {
+                const triangle& t = trisToRaster[i];
+                float minX = std::min({t.p[0].x, t.p[1].x, t.p[2].x}), maxX = std::max({t.p[0].x, t.p[1].x, t.p[2].x});
+                float minY = std::min({t.p[0].y, t.p[1].y, t.p[2].y}), maxY = std::max({t.p[0].y, t.p[1].y, t.p[2].y});
+                TileRange& r = ranges[i];
+                r.x0 = (int16_t)std::max(0, (int)floorf(minX) / RASTER_TILE);
+                r.x1 = (int16_t)std::min(tilesX - 1, (int)ceilf(maxX) / RASTER_TILE);
+                r.y0 = (int16_t)std::max(0, (int)floorf(minY) / RASTER_TILE);
+                r.y1 = (int16_t)std::min(tilesY - 1, (int)ceilf(maxY) / RASTER_TILE);
+                for (int ty = r.y0; ty <= r.y1; ty++)
+                    for (int tx = r.x0; tx <= r.x1; tx++) tileBinStart[ty * tilesX + tx + 1]++;
             }
+            for (int tile = 0; tile < nTiles; tile++) tileBinStart[tile + 1] += tileBinStart[tile];
+
+            tileBinTris = frameArena.AllocArray<uint32_t>(tileBinStart[nTiles]);
+            uint32_t* cursor = frameArena.AllocArray<uint32_t>(nTiles);
+            memcpy(cursor, tileBinStart, nTiles * sizeof(uint32_t));
+            for (size_t i = 0; i < trisToRaster.size; i++) {
+                const TileRange& r = ranges[i];
+                for (int ty = r.y0; ty <= r.y1; ty++)
+                    for (int tx = r.x0; tx <= r.x1; tx++) tileBinTris[cursor[ty * tilesX + tx]++] = (uint32_t)i;
+            }
+        }
+
+        std::atomic<size_t> pixels{0};
+        rasterPool.ParallelFor(nTiles, [&](int tile, int) {
+            PROFILE_SCOPE("Raster Tile");
+            RasterRect r;
+            r.x0 = (tile % tilesX) * RASTER_TILE; r.x1 = std::min(fb.width, r.x0 + RASTER_TILE);
+            r.y0 = (tile / tilesX) * RASTER_TILE; r.y1 = std::min(fb.height, r.y0 + RASTER_TILE);
+            size_t tilePixels = 0;
+            redraw.ForEach(r, [&](const RasterRect& part) {
+                for (uint32_t k = tileBinStart[tile]; k < tileBinStart[tile + 1]; k++)
+                    tilePixels += drawTri(tileBinTris[k], part);
+            });
+            pixels.fetch_add(tilePixels, std::memory_order_relaxed);
+        });
+        stats.pixels = pixels.load();
+    }
+
+    // Start a frame: drop last frame's transient data, clear the framebuffer.
+    // A partial redraw starts from the frame on screen instead and clears
+    // only its rectangles.
+    void BeginFrame() {
+        frameArena.Reset();
+        PROFILE_SCOPE("Clear");
+        Framebuffer& fb = app.framebuffer;
+        if (redraw.full) { fb.Clear(); return; }
+        fb.CopyFrom(presented);
+        for (const RasterRect& r : redraw.rects) fb.ClearRect(r.x0, r.y0, r.x1, r.y1);
+    }
+
+    // Present the finished frame and close it in the profiler. A frame
+    // that is already on screen is not uploaded again, only the UI is redrawn.
+    void EndFrame() {
+        {
+            PROFILE_SCOPE("Present");
+            app.Present(presented, presentedChanged);
+            presentedChanged = false;
         }
+        PROFILE_FRAME_END();
     }
 
+    // Hand the main thread's settings to the renderer: apply a window
+    // resize, the render scale or a new instance count, take the levels of
+    // detail when due, and take the snapshot the next frame is drawn with.
+    // Only called while no frame is being rendered. Returns false if the
+    // next frame would look like the last one.
+    bool SyncFrame() {
+        // Replays wait for the build here, so they switch on the same frame
+        if (levelsDue && TakeLevels(true)) {
+            printf("Built %zu levels of detail in %.3f s\n", levels->lods.size(), levels->seconds);
+            if ((meshBuildSeconds + levels->seconds) * 1e3 > MESH_BUILD_HINT_MS)
+                printf("Convert the mesh once with 3D_Matrix_meshconv to a .mcache file to skip this at startup\n");
+        }
+        levelsDue = false;
+        bool resized = app.ApplyResize();
+        int w = Resolution_Scaled(app.screenWidth, renderScale), h = Resolution_Scaled(app.screenHeight, renderScale);
+        if (resized) {
+            presented.Resize(w, h);
+            sceneChanged = presentedChanged = true;
+        }
+        // The frame on screen keeps its size until the next one replaces
+        // it; only a partial redraw, which starts from it, needs them equal
+        if (app.framebuffer.width != w || app.framebuffer.height != h) app.framebuffer.Resize(w, h);
+        if (presented.width != w || presented.height != h) sceneChanged = true;
+        if ((size_t)instanceCount != instances.Count()) CreateInstanceGrid(instanceCount);
+        frame = Settings();
+        arenaUsed = frameArena.LastFrameUsed();
+        arenaCapacity = frameArena.Capacity();
+        arenaPeak = frameArena.HighWater();
+        arenaHeapAllocs = frameArena.LastFrameHeapAllocs();
+        return PlanRedraw();
+    }
+
+    // Decide what the next frame draws into redraw: everything if the
+    // settings or the scene changed, nothing if nothing did, and if only
+    // instances moved, their screen bounds before and after the move.
+    // Moved nodes are brought up to date here for that, so RenderFrame()
+    // finds nothing left to update. Returns false if nothing needs drawing.
+    bool PlanRedraw() {
+        redraw.SetFull();
+        bool same = incrementalRedraw && !sceneChanged && !instanceBvhStale && frame.SameImage(drawnSettings);
+        sceneChanged = false;
+        drawnSettings = frame;
+        if (!same) return true;
+        if (!scene.Dirty()) {
+            redraw.SetEmpty();
+            return false;
+        }
+        // Without the depth test the draw order decides, and a subset of the
+        // instances may sort differently than all of them. Wire lines pass
+        // the depth test with a bias, so whether one shows through depends on
+        // which triangles were drawn before it. A point cloud does not draw
+        // the instances at all.
+        if (!frame.depthTest || frame.showWireframe || PointMode()) return true;
+
+        int w = app.framebuffer.width, h = app.framebuffer.height;
+        bool bounded = true;
+        auto addBounds = [&](const Aabb& box) {
+            int mask = FRUSTUM_ALL_PLANES;
+            if (!Frustum_BoxVisible(frustum, box.min, box.max, mask)) return;   // Never on screen
+            RasterRect r;
+            if (DirtyRegion_ScreenRect(box, matViewProj, w, h, r)) redraw.Add(r, w, h);
+            else bounded = false;
+        };
+        redraw.SetEmpty();
+        scene.Update();
+        CollectMovedInstances();
+        for (uint32_t i : movedInstances) addBounds(instanceBoxes[i]);
+        UpdateInstanceBvh();
+        for (uint32_t i : movedInstances) addBounds(instanceBoxes[i]);
+        // Past half the screen, copying and clipping cost more than they save
+        if (!bounded || redraw.full || redraw.Area() * 2 > (size_t)w * h) redraw.SetFull();
+        return !redraw.Empty();
+    }
+
+    // Bring `presented` up to date with the settings: pipelined, collect
+    // the frame in flight and start the next one on the render thread
+    // (so what is presented lags one call behind); otherwise draw inline.
+    void DrawFrame() {
+        {
+            PROFILE_SCOPE("Wait Render");
+            renderThread.Wait();
+        }
+        if (frameInFlight) {
+            CollectFrame();
+            frameInFlight = false;
+        }
+        if (!SyncFrame()) {
+            idleFrames++;
+            framesSkipped++;
+            return;
+        }
+        idleFrames = 0;
+        (redraw.full ? framesFull : framesPartial)++;
+        if (pipelined) {
+            renderThread.Submit([this] { BeginFrame(); RenderFrame(); });
+            frameInFlight = true;
+        } else {
+            BeginFrame();
+            RenderFrame();
+            CollectFrame();
+        }
+    }
+
+    // The frame just rendered goes on screen. Frames drawn whole tell the
+    // resolution controller what the current scene costs.
+    void CollectFrame() {
+        std::swap(app.framebuffer, presented);
+        presentedStats = stats;
+        presentedChanged = true;
+        if (redraw.full) resolution.AddFrame(frame.renderScale, stats.seconds[RenderStats::RASTER], stats.TotalSeconds());
+    }
+
+    // With a frame budget, pick the render scale of the next frames. Runs
+    // with the UI, so an input log records the scale as a settings change.
+    void UpdateRenderScale() {
+        if (frameBudgetMs > 0) renderScale = resolution.Choose(renderScale, frameBudgetMs * 1e-3);
+    }
+
+    // Main loop. Pipelined, frame N+1 renders while the main thread does
+    // input and UI and presents frame N. Once nothing has been drawn for a
+    // while, the loop sleeps until input arrives.
     void Run() {
         while (app.running) {
+            if (idleFrames >= IDLE_FRAMES_BEFORE_WAIT && !ImGui::IsAnyItemActive()) app.WaitEvent(IDLE_WAIT_MS);
             app.ProcessEvents();
-            app.BeginFrame();
-            Update(app.deltaTime);
-            Render();
-            RenderUI();
-            app.EndFrame();
+            app.BeginUI();
+            uint8_t keys = InputKeysDown();
+            Update(app.deltaTime, keys);
+            std::vector<uint8_t> beforeUI;
+            if (recorder.Active()) Settings().Pack(beforeUI);
+            {
+                PROFILE_SCOPE("UI");
+                RenderUI();
+            }
+            UpdateRenderScale();
+            if (levelBuilder.Ready()) levelsDue = true;
+            if (recorder.Active()) RecordFrame(app.deltaTime, keys, beforeUI);
+            DrawFrame();
+            EndFrame();
         }
+        StopRecording();
+        renderThread.Stop();
         app.Cleanup();
     }
 };
-
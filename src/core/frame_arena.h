@@ -0,0 +1,131 @@
+/*
+    frame_arena.h - Per-frame Linear Allocator
+    Bump allocator for data that only lives for one frame. Reset() drops
+    everything at once. If a frame needs more than the current capacity the
+    extra requests go to the heap, and the next Reset() regrows the arena
+    to the high-water mark, so after warm-up frames allocate nothing.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// ============== Frame Arena ==============
+class FrameArena {
+public:
+    explicit FrameArena(size_t initialBytes = 1 << 20) {
+        overflow.reserve(64);
+        Grow(initialBytes);
+    }
+    ~FrameArena() {
+        ReleaseOverflow();
+        free(block);
+    }
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Start a new frame; everything allocated before is invalid afterwards
+    void Reset() {
+        lastFrameHeapAllocs = frameHeapAllocs;
+        lastFrameUsed = used + overflowBytes;
+        if (!overflow.empty()) {
+            ReleaseOverflow();
+            Grow(highWater + highWater / 2);
+        }
+        used = 0;
+        frameHeapAllocs = 0;
+    }
+
+    void* Alloc(size_t bytes, size_t align = 16) {
+        size_t p = (used + align - 1) & ~(align - 1);
+        if (p + bytes <= capacity) {
+            used = p + bytes;
+            highWater = std::max(highWater, used + overflowBytes);
+            return base + p;
+        }
+        // Out of space this frame: fall back to the heap, regrow on Reset()
+        void* raw = malloc(bytes + align);
+        overflow.push_back(raw);
+        overflowBytes += bytes + align;
+        frameHeapAllocs++;
+        highWater = std::max(highWater, used + overflowBytes);
+        return (void*)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+    }
+
+    template <class T>
+    T* AllocArray(size_t n) {
+        static_assert(std::is_trivially_copyable<T>::value, "arena memory is never destructed");
+        return (T*)Alloc(n * sizeof(T), alignof(T) > 16 ? alignof(T) : 16);
+    }
+
+    size_t Capacity() const { return capacity; }
+    size_t HighWater() const { return highWater; }
+    size_t LastFrameUsed() const { return lastFrameUsed; }
+    int LastFrameHeapAllocs() const { return lastFrameHeapAllocs; }
+
+private:
+    void* block = nullptr;
+    unsigned char* base = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t highWater = 0;
+    size_t lastFrameUsed = 0;
+
+    std::vector<void*> overflow;
+    size_t overflowBytes = 0;
+    int frameHeapAllocs = 0;
+    int lastFrameHeapAllocs = 0;
+
+    void Grow(size_t bytes) {
+        bytes = (bytes + 4095) & ~(size_t)4095;
+        if (bytes <= capacity) return;
+        free(block);
+        block = malloc(bytes + 64);
+        base = (unsigned char*)(((uintptr_t)block + 63) & ~(uintptr_t)63);
+        capacity = bytes;
+    }
+
+    void ReleaseOverflow() {
+        for (void* p : overflow) free(p);
+        overflow.clear();
+        overflowBytes = 0;
+    }
+};
+
+// ============== Arena Array ==============
+// Growable array of trivially copyable values living in a FrameArena.
+// Growing copies into a new arena block; the old one is reclaimed on Reset().
+template <class T>
+struct ArenaArray {
+    T* data = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+    FrameArena* arena = nullptr;
+
+    void Init(FrameArena& a, size_t reserve) {
+        arena = &a;
+        size = 0;
+        capacity = std::max<size_t>(reserve, 16);
+        data = a.AllocArray<T>(capacity);
+    }
+
+    void push_back(const T& v) {
+        if (size == capacity) {
+            T* grown = arena->AllocArray<T>(capacity * 2);
+            memcpy((void*)grown, (const void*)data, size * sizeof(T));
+            data = grown;
+            capacity *= 2;
+        }
+        data[size++] = v;
+    }
+
+    T& operator[](size_t i) { return data[i]; }
+    const T& operator[](size_t i) const { return data[i]; }
+    T* begin() { return data; }
+    T* end() { return data + size; }
+};
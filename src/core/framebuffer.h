@@ -0,0 +1,54 @@
+/*
+    framebuffer.h - CPU-side Color Buffer
+    32-bit ARGB pixel buffer that all drawing functions write into.
+    Has no SDL dependency, so it works with or without a window.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "depth_buffer.h"
+
+// ============== Framebuffer ==============
+struct Framebuffer {
+    std::vector<uint32_t> pixels;   // Row-major, width * height, 0xAARRGGBB
+    int width = 0;
+    int height = 0;
+    DepthBuffer depth;              // Same size as the color buffer
+
+    void Resize(int w, int h) {
+        width = w > 0 ? w : 1;
+        height = h > 0 ? h : 1;
+        pixels.assign((size_t)width * height, 0xFF000000u);
+        depth.Resize(width, height);
+    }
+
+    // Fill the whole buffer with one packed color
+    void Clear(uint32_t argb = 0xFF000000u) {
+        if (argb == 0) { memset(pixels.data(), 0, pixels.size() * sizeof(uint32_t)); return; }
+        std::fill(pixels.begin(), pixels.end(), argb);
+    }
+
+    // Fill [x0, x1) × [y0, y1) with one packed color
+    void ClearRect(int x0, int y0, int x1, int y1, uint32_t argb = 0xFF000000u) {
+        for (int y = y0; y < y1; y++) std::fill(Row(y) + x0, Row(y) + x1, argb);
+    }
+
+    // Colors and depth of a framebuffer of the same size
+    void CopyFrom(const Framebuffer& other) {
+        memcpy(pixels.data(), other.pixels.data(), pixels.size() * sizeof(uint32_t));
+        depth.CopyFrom(other.depth);
+    }
+
+    int Pitch() const { return width * (int)sizeof(uint32_t); }
+    uint32_t* Row(int y) { return pixels.data() + (size_t)y * width; }
+    const uint32_t* Row(int y) const { return pixels.data() + (size_t)y * width; }
+
+    bool Contains(int x, int y) const {
+        return (unsigned)x < (unsigned)width && (unsigned)y < (unsigned)height;
+    }
+};
@@ -0,0 +1,74 @@
+/*
+    frustum.h - View Frustum Culling
+    The six planes of a world -> clip matrix (view × projection), in world
+    space, for rejecting whole objects by their bounding volume before any
+    of their vertices are transformed.
+
+    Same volume as the clipper: 0 <= z <= w, |x| <= w, |y| <= w. The guard
+    band does not matter here, only what can end up on screen.
+*/
+
+#pragma once
+
+#include "../math3d/math3d.h"
+
+// ============== Frustum ==============
+struct Plane {
+    float x, y, z, d;   // Inside when x*p.x + y*p.y + z*p.z + d >= 0, (x, y, z) unit length
+};
+
+struct Frustum {
+    Plane planes[6];    // near, far, left, right, bottom, top
+};
+
+// Row-vector convention (clip = p × m): each clip coordinate is the dot
+// product of p with one column, and every plane is a sum of columns
+inline Frustum Frustum_FromMatrix(const mat4x4& m) {
+    auto column = [&](int c) { return Plane{m.m[0][c], m.m[1][c], m.m[2][c], m.m[3][c]}; };
+    auto add = [](const Plane& a, const Plane& b, float sign) {
+        return Plane{a.x + sign * b.x, a.y + sign * b.y, a.z + sign * b.z, a.d + sign * b.d};
+    };
+    Plane x = column(0), y = column(1), z = column(2), w = column(3);
+    Frustum f;
+    f.planes[0] = z;                // z >= 0
+    f.planes[1] = add(w, z, -1);    // z <= w
+    f.planes[2] = add(w, x, 1);     // x >= -w
+    f.planes[3] = add(w, x, -1);    // x <= w
+    f.planes[4] = add(w, y, 1);     // y >= -w
+    f.planes[5] = add(w, y, -1);    // y <= w
+    for (Plane& p : f.planes) {
+        float len = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+        float inv = len > 0 ? 1.0f / len : 0.0f;
+        p.x *= inv; p.y *= inv; p.z *= inv; p.d *= inv;
+    }
+    return f;
+}
+
+inline float Plane_Dist(const Plane& p, const vec3d& v) {
+    return p.x * v.x + p.y * v.y + p.z * v.z + p.d;
+}
+
+// False only if the sphere lies entirely outside one plane
+inline bool Frustum_SphereVisible(const Frustum& f, const vec3d& center, float radius) {
+    for (const Plane& p : f.planes)
+        if (Plane_Dist(p, center) < -radius) return false;
+    return true;
+}
+
+const int FRUSTUM_ALL_PLANES = 63;     // Plane mask bits, 1 << plane index
+
+// Box test against the planes set in `mask`. False if the box lies entirely
+// outside one of them; planes it lies entirely inside are cleared from
+// `mask`, so the children of a BVH node only test the planes left over.
+inline bool Frustum_BoxVisible(const Frustum& f, const vec3d& bmin, const vec3d& bmax, int& mask) {
+    for (int i = 0; i < 6; i++) {
+        if (!(mask & (1 << i))) continue;
+        const Plane& p = f.planes[i];
+        // Corner farthest along the plane normal, then the nearest one
+        vec3d front = {p.x >= 0 ? bmax.x : bmin.x, p.y >= 0 ? bmax.y : bmin.y, p.z >= 0 ? bmax.z : bmin.z};
+        if (Plane_Dist(p, front) < 0) return false;
+        vec3d back = {p.x >= 0 ? bmin.x : bmax.x, p.y >= 0 ? bmin.y : bmax.y, p.z >= 0 ? bmin.z : bmax.z};
+        if (Plane_Dist(p, back) >= 0) mask &= ~(1 << i);
+    }
+    return true;
+}
@@ -0,0 +1,154 @@
+/*
+    image_writer.h - PPM and PNG Output
+    Writes 0xAARRGGBB pixel buffers (Framebuffer layout) as 8-bit RGB
+    images. PPM is the raw binary P6 format. PNG uses stored (uncompressed)
+    deflate blocks: every viewer reads it, and encoding is little more than
+    a copy plus the CRC and Adler checksums, so writing a frame costs far
+    less than rendering it. Files are assembled in memory and written with
+    one fwrite.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ============== Checksums ==============
+namespace imageio {
+
+// Slicing-by-8: eight table lookups per 8 input bytes
+inline uint32_t Crc32(const uint8_t* data, size_t n, uint32_t crc = 0) {
+    struct Tables {
+        uint32_t v[8][256];
+        Tables() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                v[0][i] = c;
+            }
+            for (int t = 1; t < 8; t++)
+                for (int i = 0; i < 256; i++) v[t][i] = v[0][v[t - 1][i] & 255] ^ (v[t - 1][i] >> 8);
+        }
+    };
+    static const Tables tables;
+    const uint32_t (*v)[256] = tables.v;
+    crc = ~crc;
+    for (; n >= 8; n -= 8, data += 8) {
+        uint32_t lo = crc ^ ((uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+        crc = v[7][lo & 255] ^ v[6][lo >> 8 & 255] ^ v[5][lo >> 16 & 255] ^ v[4][lo >> 24] ^
+              v[3][data[4]] ^ v[2][data[5]] ^ v[1][data[6]] ^ v[0][data[7]];
+    }
+    for (; n; n--) crc = v[0][(crc ^ *data++) & 255] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline uint32_t Adler32(const uint8_t* data, size_t n, uint32_t adler = 1) {
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (n) {
+        size_t block = n < 5552 ? n : 5552;     // Largest run without overflowing b
+        n -= block;
+        for (size_t i = 0; i < block; i++) { a += data[i]; b += a; }
+        data += block;
+        a %= 65521; b %= 65521;
+    }
+    return b << 16 | a;
+}
+
+inline void PutBE32(std::vector<uint8_t>& out, uint32_t v) {
+    uint8_t b[4] = {(uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+    out.insert(out.end(), b, b + 4);
+}
+
+// Length, type, data and CRC of one PNG chunk
+inline void PngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t n) {
+    PutBE32(out, (uint32_t)n);
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (n) out.insert(out.end(), data, data + n);
+    PutBE32(out, Crc32(&out[start], n + 4));
+}
+
+inline bool WriteFile(const char* path, const std::vector<uint8_t>& data, std::string& error) {
+    FILE* f = fopen(path, "wb");
+    if (!f) { error = std::string("Cannot create ") + path; return false; }
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok) error = std::string("Write failed: ") + path;
+    return ok;
+}
+
+} // namespace imageio
+
+// ============== Encoding ==============
+inline void Image_EncodePpm(const uint32_t* pixels, int width, int height, std::vector<uint8_t>& out) {
+    char header[32];
+    int n = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    out.assign(header, header + n);
+    out.resize(n + (size_t)width * height * 3);
+    uint8_t* p = &out[n];
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        uint32_t c = pixels[i];
+        *p++ = (uint8_t)(c >> 16); *p++ = (uint8_t)(c >> 8); *p++ = (uint8_t)c;
+    }
+}
+
+inline void Image_EncodePng(const uint32_t* pixels, int width, int height, std::vector<uint8_t>& out) {
+    using namespace imageio;
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.assign(signature, signature + 8);
+
+    uint8_t ihdr[13] = {};
+    for (int i = 0; i < 4; i++) {
+        ihdr[i] = (uint8_t)(width >> (24 - 8 * i));
+        ihdr[4 + i] = (uint8_t)(height >> (24 - 8 * i));
+    }
+    ihdr[8] = 8;        // Bits per channel
+    ihdr[9] = 2;        // RGB
+    PngChunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+    // Scanlines (filter byte 0 + RGB), then split into stored blocks of <= 65535 bytes
+    size_t rowBytes = 1 + (size_t)width * 3, rawBytes = rowBytes * height;
+    std::vector<uint8_t> raw(rawBytes);
+    for (int y = 0; y < height; y++) {
+        uint8_t* p = &raw[y * rowBytes];
+        *p++ = 0;
+        const uint32_t* row = pixels + (size_t)y * width;
+        for (int x = 0; x < width; x++) {
+            *p++ = (uint8_t)(row[x] >> 16); *p++ = (uint8_t)(row[x] >> 8); *p++ = (uint8_t)row[x];
+        }
+    }
+    // One IDAT chunk holding the zlib stream, written in place
+    size_t blocks = (rawBytes + 65534) / 65535;
+    size_t zlibBytes = 2 + rawBytes + blocks * 5 + 4;
+    out.reserve(out.size() + zlibBytes + 12 + 12);
+    PutBE32(out, (uint32_t)zlibBytes);
+    size_t start = out.size();
+    out.insert(out.end(), {'I', 'D', 'A', 'T'});
+    out.push_back(0x78);        // Deflate, 32K window
+    out.push_back(0x01);        // No dictionary, fastest (header check bits)
+    for (size_t at = 0; at < rawBytes; ) {
+        size_t n = std::min<size_t>(rawBytes - at, 65535);
+        bool last = at + n == rawBytes;
+        uint8_t head[5] = {(uint8_t)(last ? 1 : 0), (uint8_t)n, (uint8_t)(n >> 8), (uint8_t)~n, (uint8_t)(~n >> 8)};
+        out.insert(out.end(), head, head + 5);
+        out.insert(out.end(), raw.begin() + at, raw.begin() + at + n);
+        at += n;
+    }
+    PutBE32(out, Adler32(raw.data(), rawBytes));
+    PutBE32(out, Crc32(&out[start], out.size() - start));
+    PngChunk(out, "IEND", nullptr, 0);
+}
+
+// ============== Writing ==============
+// Format by extension: ".png", anything else is written as PPM
+inline bool Image_Write(const char* path, const uint32_t* pixels, int width, int height, std::string& error) {
+    std::vector<uint8_t> data;
+    size_t len = strlen(path);
+    if (len >= 4 && !strcmp(path + len - 4, ".png")) Image_EncodePng(pixels, width, height, data);
+    else Image_EncodePpm(pixels, width, height, data);
+    return imageio::WriteFile(path, data, error);
+}
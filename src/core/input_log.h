@@ -0,0 +1,249 @@
+/*
+    input_log.h - Recorded Input for Deterministic Replay
+    Everything that steers a session from outside, frame by frame: the
+    frame time, the movement keys held, the settings whenever the control
+    panel changed them, window resizes, and the frame that first drew with
+    levels of detail built in the background. Fed back to a headless engine,
+    a log reproduces the session's frames exactly; how fast they render
+    is then the only thing that differs between builds.
+
+    Layout (little-endian, no padding):
+        uint32 magic, version
+        uint32 width, height                Window size at the start
+        string meshPath, texturePath        uint16 length + bytes, empty = built-in
+        string pointsPath                   Point cloud, empty = none
+        blob   settings                     uint16 length + packed FrameSettings
+        then per frame:
+            uint8  flags                    InputFrameFlags
+            uint8  keys                     InputKeys held
+            float  dt                       Seconds since the previous frame
+            blob   settings                 with INPUT_FRAME_SETTINGS
+            uint32 width, height            with INPUT_FRAME_RESIZE
+
+    A frame without settings costs 6 bytes, about 20 KB per minute at 60 Hz.
+*/
+
+#pragma once
+
+#include "mapped_file.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ============== Format ==============
+const uint32_t INPUT_LOG_MAGIC = 0x4944334D;       // "M3DI"
+const uint32_t INPUT_LOG_VERSION = 3;
+
+enum InputFrameFlags : uint8_t {
+    INPUT_FRAME_SETTINGS = 1 << 0,      // The control panel changed the settings
+    INPUT_FRAME_RESIZE = 1 << 1,        // The window was resized
+    INPUT_FRAME_LEVELS = 1 << 2,        // Levels of detail finished building, drawn from this frame on
+};
+
+// Movement keys, as Engine3D::Update() reads them
+enum InputKeys : uint8_t {
+    INPUT_KEY_FORWARD = 1 << 0,         // W or Up
+    INPUT_KEY_BACK = 1 << 1,            // S or Down
+    INPUT_KEY_LEFT = 1 << 2,            // A
+    INPUT_KEY_RIGHT = 1 << 3,           // D
+};
+
+struct InputLogHeader {
+    int width = 0, height = 0;
+    std::string meshPath, texturePath, pointsPath;
+    std::vector<uint8_t> settings;      // Packed FrameSettings at the start
+};
+
+struct InputFrame {
+    float dt = 0;
+    uint8_t keys = 0;                   // InputKeys
+    std::vector<uint8_t> settings;      // Packed FrameSettings after the UI, empty if unchanged
+    int width = 0, height = 0;          // New window size, 0 if not resized
+    bool levels = false;                // Levels of detail taken before this frame
+};
+
+// ============== Byte Packing ==============
+namespace inputlog {
+
+inline void Put(std::vector<uint8_t>& out, uint8_t v) { out.push_back(v); }
+inline void Put(std::vector<uint8_t>& out, bool v) { out.push_back(v ? 1 : 0); }
+
+inline void Put(std::vector<uint8_t>& out, uint32_t v) {
+    for (int k = 0; k < 32; k += 8) out.push_back((uint8_t)(v >> k));
+}
+
+inline void Put(std::vector<uint8_t>& out, int v) { Put(out, (uint32_t)v); }
+
+inline void Put(std::vector<uint8_t>& out, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, 4);
+    Put(out, bits);
+}
+
+// uint16 length, then the bytes
+inline void PutBlob(std::vector<uint8_t>& out, const void* data, size_t n) {
+    out.push_back((uint8_t)n);
+    out.push_back((uint8_t)(n >> 8));
+    out.insert(out.end(), (const uint8_t*)data, (const uint8_t*)data + n);
+}
+
+// Reads values in the order they were put; ok turns false (and stays
+// false) once the data runs out
+struct Cursor {
+    const uint8_t* p = nullptr;
+    const uint8_t* end = nullptr;
+    bool ok = true;
+
+    bool Take(size_t n) {
+        ok = ok && (size_t)(end - p) >= n;
+        return ok;
+    }
+    void Get(uint8_t& v) { if (Take(1)) v = *p++; }
+    void Get(bool& v) { if (Take(1)) v = *p++ != 0; }
+    void Get(uint32_t& v) {
+        if (!Take(4)) return;
+        v = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        p += 4;
+    }
+    void Get(int& v) { uint32_t u = 0; Get(u); v = (int)u; }
+    void Get(float& v) { uint32_t u = 0; Get(u); memcpy(&v, &u, 4); }
+    void GetBlob(std::vector<uint8_t>& v) {
+        if (!Take(2)) return;
+        size_t n = p[0] | (size_t)p[1] << 8;
+        p += 2;
+        if (!Take(n)) return;
+        v.assign(p, p + n);
+        p += n;
+    }
+};
+
+} // namespace inputlog
+
+// ============== Writing ==============
+class InputLogWriter {
+public:
+    InputLogWriter() = default;
+    ~InputLogWriter() { Close(); }
+    InputLogWriter(const InputLogWriter&) = delete;
+    InputLogWriter& operator=(const InputLogWriter&) = delete;
+
+    bool Active() const { return file != nullptr; }
+    int Frames() const { return frames; }
+    size_t Bytes() const { return bytes; }
+
+    bool Open(const char* path, const InputLogHeader& header, std::string& error) {
+        using namespace inputlog;
+        Close();
+        file = fopen(path, "wb");
+        if (!file) { error = std::string("cannot create ") + path; return false; }
+        frames = 0;
+        bytes = 0;
+        buffer.clear();
+        Put(buffer, INPUT_LOG_MAGIC);
+        Put(buffer, INPUT_LOG_VERSION);
+        Put(buffer, header.width);
+        Put(buffer, header.height);
+        PutBlob(buffer, header.meshPath.data(), header.meshPath.size());
+        PutBlob(buffer, header.texturePath.data(), header.texturePath.size());
+        PutBlob(buffer, header.pointsPath.data(), header.pointsPath.size());
+        PutBlob(buffer, header.settings.data(), header.settings.size());
+        return Flush(error);
+    }
+
+    bool Write(const InputFrame& frame, std::string& error) {
+        using namespace inputlog;
+        if (!file) { error = "input log not open"; return false; }
+        buffer.clear();
+        uint8_t flags = 0;
+        if (!frame.settings.empty()) flags |= INPUT_FRAME_SETTINGS;
+        if (frame.width) flags |= INPUT_FRAME_RESIZE;
+        if (frame.levels) flags |= INPUT_FRAME_LEVELS;
+        Put(buffer, flags);
+        Put(buffer, frame.keys);
+        Put(buffer, frame.dt);
+        if (flags & INPUT_FRAME_SETTINGS) PutBlob(buffer, frame.settings.data(), frame.settings.size());
+        if (flags & INPUT_FRAME_RESIZE) { Put(buffer, frame.width); Put(buffer, frame.height); }
+        frames++;
+        return Flush(error);
+    }
+
+    // False if anything written since Open() failed to reach the disk
+    bool Close() {
+        if (!file) return true;
+        bool ok = fclose(file) == 0 && !failed;
+        file = nullptr;
+        failed = false;
+        return ok;
+    }
+
+private:
+    FILE* file = nullptr;
+    std::vector<uint8_t> buffer;
+    int frames = 0;
+    size_t bytes = 0;
+    bool failed = false;
+
+    bool Flush(std::string& error) {
+        if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+            failed = true;
+            error = "input log: write failed";
+            return false;
+        }
+        bytes += buffer.size();
+        return true;
+    }
+};
+
+// ============== Reading ==============
+class InputLogReader {
+public:
+    bool Open(const char* path, InputLogHeader& header, std::string& error) {
+        if (!file.Open(path)) { error = std::string("cannot open ") + path; return false; }
+        at.p = (const uint8_t*)file.Data();
+        at.end = at.p + file.Size();
+        at.ok = true;
+        uint32_t magic = 0, version = 0;
+        at.Get(magic);
+        at.Get(version);
+        if (!at.ok || magic != INPUT_LOG_MAGIC) { error = "not an input log"; return false; }
+        if (version != INPUT_LOG_VERSION) { error = "input log: unsupported version"; return false; }
+        std::vector<uint8_t> mesh, texture, points;
+        at.Get(header.width);
+        at.Get(header.height);
+        at.GetBlob(mesh);
+        at.GetBlob(texture);
+        at.GetBlob(points);
+        at.GetBlob(header.settings);
+        if (!at.ok || header.width <= 0 || header.height <= 0) { error = "input log: bad header"; return false; }
+        header.meshPath.assign(mesh.begin(), mesh.end());
+        header.texturePath.assign(texture.begin(), texture.end());
+        header.pointsPath.assign(points.begin(), points.end());
+        return true;
+    }
+
+    // Next frame; false at the end of the log, or with error set if the
+    // log is cut off or damaged
+    bool Next(InputFrame& frame, std::string& error) {
+        if (at.p == at.end) return false;
+        uint8_t flags = 0;
+        at.Get(flags);
+        at.Get(frame.keys);
+        at.Get(frame.dt);
+        frame.settings.clear();
+        frame.width = frame.height = 0;
+        frame.levels = (flags & INPUT_FRAME_LEVELS) != 0;
+        if (flags & INPUT_FRAME_SETTINGS) at.GetBlob(frame.settings);
+        if (flags & INPUT_FRAME_RESIZE) { at.Get(frame.width); at.Get(frame.height); }
+        if (!at.ok || flags & ~(INPUT_FRAME_SETTINGS | INPUT_FRAME_RESIZE | INPUT_FRAME_LEVELS)) {
+            error = "input log: truncated or damaged frame";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    MappedFile file;
+    inputlog::Cursor at;
+};
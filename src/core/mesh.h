@@ -0,0 +1,169 @@
+/*
+    mesh.h - Indexed Triangle Mesh
+    Contiguous vertex and index storage shared by the loaders and the engine.
+    Positions are kept as separate x/y/z streams so whole meshes can be
+    transformed in batches. Face planes are derived data: the engine fills
+    them once per mesh (Mesh_ComputeFacePlanes) for culling and lighting.
+    Texture coordinates are optional: either one (u, v) per vertex or none.
+*/
+
+#pragma once
+
+#include "../math3d/math3d.h"
+#include <cstdint>
+#include <vector>
+
+// ============== Mesh ==============
+struct Mesh {
+    std::vector<float> x, y, z;         // Vertex positions (structure of arrays)
+    std::vector<uint32_t> indices;      // 3 per triangle, clockwise seen from the front
+    std::vector<float> nx, ny, nz, nd;  // Per triangle: unit front normal and n·p of its plane
+    std::vector<float> u, v;            // Texture coordinates per vertex, (0, 0) = top left of the image
+
+    size_t VertexCount() const { return x.size(); }
+    size_t TriangleCount() const { return indices.size() / 3; }
+
+    vec3d Vertex(uint32_t i) const { return {x[i], y[i], z[i], 1}; }
+    vec3d FaceNormal(size_t t) const { return {nx[t], ny[t], nz[t], 0}; }
+    bool HasFacePlanes() const { return nx.size() == TriangleCount(); }
+    bool HasUVs() const { return !x.empty() && u.size() == x.size(); }
+
+    void Clear() {
+        x.clear(); y.clear(); z.clear(); indices.clear();
+        nx.clear(); ny.clear(); nz.clear(); nd.clear();
+        u.clear(); v.clear();
+    }
+
+    void Reserve(size_t vertices, size_t triangles) {
+        x.reserve(vertices); y.reserve(vertices); z.reserve(vertices);
+        indices.reserve(triangles * 3);
+    }
+
+    uint32_t AddVertex(float vx, float vy, float vz) {
+        x.push_back(vx); y.push_back(vy); z.push_back(vz);
+        return (uint32_t)x.size() - 1;
+    }
+
+    uint32_t AddVertex(float vx, float vy, float vz, float tu, float tv) {
+        u.push_back(tu); v.push_back(tv);
+        return AddVertex(vx, vy, vz);
+    }
+
+    void AddTriangle(uint32_t a, uint32_t b, uint32_t c) {
+        indices.push_back(a); indices.push_back(b); indices.push_back(c);
+    }
+
+    // Bytes held by the vertex, index and face stores (capacity, not just size)
+    size_t MemoryBytes() const {
+        return (x.capacity() + y.capacity() + z.capacity()) * sizeof(float) +
+               indices.capacity() * sizeof(uint32_t) +
+               (nx.capacity() + ny.capacity() + nz.capacity() + nd.capacity()) * sizeof(float) +
+               (u.capacity() + v.capacity()) * sizeof(float);
+    }
+};
+
+// ============== Mesh Utilities ==============
+
+// Axis-aligned bounds of all vertices
+inline void Mesh_Bounds(const Mesh& mesh, vec3d& bmin, vec3d& bmax) {
+    bmin = {1e30f, 1e30f, 1e30f};
+    bmax = {-1e30f, -1e30f, -1e30f};
+    for (size_t i = 0; i < mesh.VertexCount(); i++) {
+        bmin.x = std::fmin(bmin.x, mesh.x[i]); bmax.x = std::fmax(bmax.x, mesh.x[i]);
+        bmin.y = std::fmin(bmin.y, mesh.y[i]); bmax.y = std::fmax(bmax.y, mesh.y[i]);
+        bmin.z = std::fmin(bmin.z, mesh.z[i]); bmax.z = std::fmax(bmax.z, mesh.z[i]);
+    }
+}
+
+// Sphere around the bounds' center that contains every vertex
+inline void Mesh_BoundingSphere(const Mesh& mesh, vec3d& center, float& radius) {
+    center = {0, 0, 0};
+    radius = 0;
+    if (mesh.VertexCount() == 0) return;
+    vec3d bmin, bmax;
+    Mesh_Bounds(mesh, bmin, bmax);
+    center = Vec_Mul(Vec_Add(bmin, bmax), 0.5f);
+    float r2 = 0;
+    for (size_t i = 0; i < mesh.VertexCount(); i++) {
+        float dx = mesh.x[i] - center.x, dy = mesh.y[i] - center.y, dz = mesh.z[i] - center.z;
+        r2 = std::fmax(r2, dx * dx + dy * dy + dz * dz);
+    }
+    center.w = 1;
+    radius = sqrtf(r2);
+}
+
+// Plane of every triangle, from its current vertices and winding. The
+// utilities that move vertices or reorder triangles keep existing planes
+// up to date.
+inline void Mesh_ComputeFacePlanes(Mesh& mesh) {
+    size_t n = mesh.TriangleCount();
+    mesh.nx.resize(n); mesh.ny.resize(n); mesh.nz.resize(n); mesh.nd.resize(n);
+    for (size_t t = 0; t < n; t++) {
+        const uint32_t* v = &mesh.indices[t * 3];
+        vec3d p0 = mesh.Vertex(v[0]), p1 = mesh.Vertex(v[1]), p2 = mesh.Vertex(v[2]);
+        vec3d normal = Vec_Norm(Vec_Cross(Vec_Sub(p1, p0), Vec_Sub(p2, p0)));
+        mesh.nx[t] = normal.x; mesh.ny[t] = normal.y; mesh.nz[t] = normal.z;
+        mesh.nd[t] = Vec_Dot(normal, p0);
+    }
+}
+
+// Center on the origin and scale so the largest extent equals `size`
+inline void Mesh_Fit(Mesh& mesh, float size) {
+    if (mesh.VertexCount() == 0) return;
+    vec3d bmin, bmax;
+    Mesh_Bounds(mesh, bmin, bmax);
+    vec3d c = Vec_Mul(Vec_Add(bmin, bmax), 0.5f);
+    float extent = std::fmax(bmax.x - bmin.x, std::fmax(bmax.y - bmin.y, bmax.z - bmin.z));
+    float s = extent > 0 ? size / extent : 1.0f;
+    for (size_t i = 0; i < mesh.VertexCount(); i++) {
+        mesh.x[i] = (mesh.x[i] - c.x) * s;
+        mesh.y[i] = (mesh.y[i] - c.y) * s;
+        mesh.z[i] = (mesh.z[i] - c.z) * s;
+    }
+    if (!mesh.nx.empty()) Mesh_ComputeFacePlanes(mesh);
+}
+
+// Unit cube from (0,0,0) to (1,1,1): 4 corners per face so every face
+// maps the whole texture, 12 triangles
+inline void Mesh_CreateCube(Mesh& mesh) {
+    mesh.Clear();
+    // Corner index = x + 2*y + 4*z; each face lists its corners top left,
+    // top right, bottom right, bottom left as seen from outside
+    static const uint8_t faces[6][4] = {
+        {2, 3, 1, 0},   // SOUTH
+        {3, 7, 5, 1},   // EAST
+        {7, 6, 4, 5},   // NORTH
+        {6, 2, 0, 4},   // WEST
+        {6, 7, 3, 2},   // TOP
+        {4, 0, 1, 5},   // BOTTOM
+    };
+    static const float uv[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+    for (const auto& face : faces) {
+        uint32_t base = (uint32_t)mesh.VertexCount();
+        for (int k = 0; k < 4; k++) {
+            int i = face[k];
+            mesh.AddVertex((float)(i & 1), (float)((i >> 1) & 1), (float)((i >> 2) & 1), uv[k][0], uv[k][1]);
+        }
+        mesh.AddTriangle(base + 3, base, base + 1);
+        mesh.AddTriangle(base + 3, base + 1, base + 2);
+    }
+}
+
+// n unit cubes on a k x k x k grid (k = smallest cube root >= n), one unit
+// apart. Scales the triangle count for benchmarks; use Mesh_Fit to frame it.
+inline void Mesh_CreateCubeGrid(Mesh& mesh, int n) {
+    Mesh cube;
+    Mesh_CreateCube(cube);
+    int k = 1;
+    while (k * k * k < n) k++;
+    mesh.Clear();
+    mesh.Reserve(cube.VertexCount() * n, cube.TriangleCount() * n);
+    for (int c = 0; c < n; c++) {
+        float ox = (float)(c % k) * 2, oy = (float)(c / k % k) * 2, oz = (float)(c / (k * k)) * 2;
+        uint32_t base = (uint32_t)mesh.VertexCount();
+        for (size_t v = 0; v < cube.VertexCount(); v++)
+            mesh.AddVertex(cube.x[v] + ox, cube.y[v] + oy, cube.z[v] + oz, cube.u[v], cube.v[v]);
+        for (size_t t = 0; t < cube.TriangleCount(); t++)
+            mesh.AddTriangle(base + cube.indices[t * 3], base + cube.indices[t * 3 + 1], base + cube.indices[t * 3 + 2]);
+    }
+}
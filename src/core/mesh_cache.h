@@ -0,0 +1,408 @@
+/*
+    mesh_cache.h - Binary Mesh Cache
+    A mesh together with everything the engine derives from it at load
+    time (chunks, chunk BVH, levels of detail), written once by the
+    converter (main_meshconv.cpp) and read back with no parsing and no
+    rebuilding: the file is memory-mapped, checked, and its streams are
+    copied or dequantized straight into the engine's arrays.
+
+    Layout (little-endian, every stream starts 8-byte aligned):
+        MeshCacheHeader
+        MeshCacheLevel[levelCount]          level 0 = full mesh, then the LODs
+        per level, at its offset:
+            x, y, z     uint16[vertices]    p = origin + q * step
+            u, v        float[vertices]     only with MESH_CACHE_UVS
+            indices     uint32[3 * triangles]
+            normals     int16[2 * triangles] face normals, octahedral
+            chunks      uint32[6 * chunks]  MeshChunk fields in order
+            deps        uint32[deps]
+            nodes       8 x 4 bytes each    box min xyz, max xyz, first, count
+            prims       uint32[prims]
+            parents     uint32[nodes]
+            primLeaves  uint32[prims]
+
+    Meshes are stored as the engine uses them: fitted into the 2-unit box,
+    chunk-ordered, in engine handedness. The converter snaps positions to
+    the 16-bit grid before chunking, so the chunk bounds hold exactly.
+*/
+
+#pragma once
+
+#include "bvh.h"
+#include "mapped_file.h"
+#include "mesh.h"
+#include "mesh_loader.h"
+#include "mesh_simplify.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ============== File Structures ==============
+const uint32_t MESH_CACHE_MAGIC = 0x4344334D;      // "M3DC"
+const uint32_t MESH_CACHE_VERSION = 2;
+const uint32_t MESH_CACHE_MAX_LEVELS = 64;
+
+struct MeshCacheHeader {
+    uint32_t magic, version;
+    uint32_t levelCount, reserved;
+    uint64_t fileBytes;         // Catches truncated files
+};
+
+struct MeshCacheLevel {
+    uint32_t vertexCount, triangleCount;
+    uint32_t chunkCount, depCount;
+    uint32_t nodeCount, primCount;
+    float error;                // MeshLod::error, 0 for level 0
+    float origin[3], step[3];   // Dequantization of the positions
+    uint32_t flags;             // MeshCacheFlags
+    uint64_t offset;            // First stream, from the start of the file
+};
+
+enum MeshCacheFlags : uint32_t {
+    MESH_CACHE_UVS = 1 << 0,    // Texture coordinate streams follow the positions
+};
+
+static_assert(sizeof(MeshCacheHeader) == 24, "MeshCacheHeader layout");
+static_assert(sizeof(MeshCacheLevel) == 64, "MeshCacheLevel layout");
+
+// ============== Quantization ==============
+// Positions are 16-bit steps across the mesh bounds, per axis
+struct MeshQuantization {
+    float origin[3] = {0, 0, 0};
+    float step[3] = {1, 1, 1};
+};
+
+inline MeshQuantization Mesh_Quantization(const Mesh& mesh) {
+    MeshQuantization q;
+    if (mesh.VertexCount() == 0) return q;
+    vec3d bmin, bmax;
+    Mesh_Bounds(mesh, bmin, bmax);
+    float lo[3] = {bmin.x, bmin.y, bmin.z}, hi[3] = {bmax.x, bmax.y, bmax.z};
+    for (int a = 0; a < 3; a++) {
+        q.origin[a] = lo[a];
+        q.step[a] = hi[a] > lo[a] ? (hi[a] - lo[a]) / 65535.0f : 1.0f;
+    }
+    return q;
+}
+
+namespace meshio {
+
+inline uint16_t Quantize(float v, float origin, float step) {
+    float q = std::round((v - origin) / step);
+    return (uint16_t)std::fmin(std::fmax(q, 0.0f), 65535.0f);
+}
+
+} // namespace meshio
+
+// Move every vertex onto the grid it will be stored on
+inline void Mesh_Quantize(Mesh& mesh) {
+    MeshQuantization q = Mesh_Quantization(mesh);
+    float* axes[3] = {mesh.x.data(), mesh.y.data(), mesh.z.data()};
+    for (int a = 0; a < 3; a++)
+        for (size_t i = 0; i < mesh.VertexCount(); i++)
+            axes[a][i] = q.origin[a] + meshio::Quantize(axes[a][i], q.origin[a], q.step[a]) * q.step[a];
+    if (!mesh.nx.empty()) Mesh_ComputeFacePlanes(mesh);
+}
+
+// ============== Octahedral Normals ==============
+// Unit vector folded onto the octahedron and unrolled into a square,
+// two snorm16 values; about 0.005 degrees worst-case error
+inline void Oct_Encode(const vec3d& n, int16_t& u, int16_t& v) {
+    float s = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    float x = s > 0 ? n.x / s : 0, y = s > 0 ? n.y / s : 0;
+    if (n.z < 0) {
+        float fx = (1 - std::fabs(y)) * (x >= 0 ? 1 : -1);
+        float fy = (1 - std::fabs(x)) * (y >= 0 ? 1 : -1);
+        x = fx; y = fy;
+    }
+    u = (int16_t)std::round(x * 32767);
+    v = (int16_t)std::round(y * 32767);
+}
+
+inline vec3d Oct_Decode(int16_t u, int16_t v) {
+    float x = std::fmax(u / 32767.0f, -1.0f), y = std::fmax(v / 32767.0f, -1.0f);
+    float z = 1 - std::fabs(x) - std::fabs(y);
+    if (z < 0) {
+        float fx = (1 - std::fabs(y)) * (x >= 0 ? 1 : -1);
+        float fy = (1 - std::fabs(x)) * (y >= 0 ? 1 : -1);
+        x = fx; y = fy;
+    }
+    return Vec_Norm({x, y, z});
+}
+
+// ============== Writing ==============
+namespace meshio {
+
+inline uint64_t Align8(uint64_t n) { return (n + 7) & ~(uint64_t)7; }
+
+// Bytes of one level's streams, each padded to 8
+inline uint64_t CacheLevelBytes(const MeshCacheLevel& l) {
+    uint64_t uvs = l.flags & MESH_CACHE_UVS ? Align8(4ull * l.vertexCount) * 2 : 0;
+    return Align8(2ull * l.vertexCount) * 3 + uvs + Align8(12ull * l.triangleCount) + Align8(4ull * l.triangleCount) +
+           Align8(24ull * l.chunkCount) + Align8(4ull * l.depCount) + 32ull * l.nodeCount +
+           Align8(4ull * l.primCount) * 2 + Align8(4ull * l.nodeCount);
+}
+
+} // namespace meshio
+
+// Write `mesh` (level 0) and its levels of detail with their chunks. All
+// levels need their face planes.
+inline bool MeshCache_Write(const char* path, const Mesh& mesh, const MeshChunks& chunks,
+                            const std::vector<MeshLod>& lods, const std::vector<MeshChunks>& lodChunks,
+                            std::string& error) {
+    using namespace meshio;
+    if (!IsLittleEndianHost()) { error = "mesh cache: big-endian hosts are not supported"; return false; }
+    size_t nLevels = 1 + lods.size();
+    auto levelMesh = [&](size_t l) -> const Mesh& { return l ? lods[l - 1].mesh : mesh; };
+    auto levelChunks = [&](size_t l) -> const MeshChunks& { return l ? lodChunks[l - 1] : chunks; };
+    for (size_t l = 0; l < nLevels; l++)
+        if (!levelMesh(l).HasFacePlanes()) { error = "mesh cache: face planes missing"; return false; }
+
+    std::vector<MeshCacheLevel> table(nLevels);
+    uint64_t offset = sizeof(MeshCacheHeader) + nLevels * sizeof(MeshCacheLevel);
+    for (size_t l = 0; l < nLevels; l++) {
+        const Mesh& m = levelMesh(l);
+        const MeshChunks& c = levelChunks(l);
+        MeshCacheLevel& t = table[l];
+        t.vertexCount = (uint32_t)m.VertexCount();
+        t.triangleCount = (uint32_t)m.TriangleCount();
+        t.chunkCount = (uint32_t)c.chunks.size();
+        t.depCount = (uint32_t)c.deps.size();
+        t.nodeCount = (uint32_t)c.bvh.nodes.size();
+        t.primCount = (uint32_t)c.bvh.prims.size();
+        t.error = l ? lods[l - 1].error : 0.0f;
+        t.flags = m.HasUVs() ? (uint32_t)MESH_CACHE_UVS : 0u;
+        MeshQuantization q = Mesh_Quantization(m);
+        memcpy(t.origin, q.origin, sizeof(t.origin));
+        memcpy(t.step, q.step, sizeof(t.step));
+        t.offset = offset;
+        offset += CacheLevelBytes(t);
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (!f) { error = std::string("cannot create ") + path; return false; }
+    bool ok = true;
+    uint64_t written = 0;
+    auto put = [&](const void* data, size_t bytes) {
+        if (bytes && fwrite(data, 1, bytes, f) != bytes) ok = false;
+        written += bytes;
+    };
+    auto pad = [&]() {
+        static const char zeros[8] = {};
+        put(zeros, (size_t)(Align8(written) - written));
+    };
+
+    MeshCacheHeader header = {MESH_CACHE_MAGIC, MESH_CACHE_VERSION, (uint32_t)nLevels, 0, offset};
+    put(&header, sizeof(header));
+    put(table.data(), table.size() * sizeof(MeshCacheLevel));
+
+    std::vector<uint16_t> q16;
+    std::vector<int16_t> oct;
+    std::vector<uint32_t> words;
+    for (size_t l = 0; l < nLevels && ok; l++) {
+        const Mesh& m = levelMesh(l);
+        const MeshChunks& c = levelChunks(l);
+        const MeshCacheLevel& t = table[l];
+
+        const std::vector<float>* axes[3] = {&m.x, &m.y, &m.z};
+        for (int a = 0; a < 3; a++) {
+            q16.resize(t.vertexCount);
+            for (size_t i = 0; i < t.vertexCount; i++) q16[i] = Quantize((*axes[a])[i], t.origin[a], t.step[a]);
+            put(q16.data(), q16.size() * 2);
+            pad();
+        }
+        if (t.flags & MESH_CACHE_UVS) {
+            put(m.u.data(), m.u.size() * 4);
+            pad();
+            put(m.v.data(), m.v.size() * 4);
+            pad();
+        }
+        put(m.indices.data(), m.indices.size() * 4);
+        pad();
+
+        oct.resize(2 * (size_t)t.triangleCount);
+        for (size_t i = 0; i < t.triangleCount; i++) Oct_Encode(m.FaceNormal(i), oct[i * 2], oct[i * 2 + 1]);
+        put(oct.data(), oct.size() * 2);
+        pad();
+
+        words.clear();
+        for (const MeshChunk& ch : c.chunks) {
+            uint32_t fields[6] = {ch.triFirst, ch.triCount, ch.vertFirst, ch.vertEnd, ch.depFirst, ch.depCount};
+            words.insert(words.end(), fields, fields + 6);
+        }
+        put(words.data(), words.size() * 4);
+        pad();
+        put(c.deps.data(), c.deps.size() * 4);
+        pad();
+
+        for (const BvhNode& n : c.bvh.nodes) {
+            float box[6] = {n.box.min.x, n.box.min.y, n.box.min.z, n.box.max.x, n.box.max.y, n.box.max.z};
+            uint32_t range[2] = {n.first, n.count};
+            put(box, sizeof(box));
+            put(range, sizeof(range));
+        }
+        put(c.bvh.prims.data(), c.bvh.prims.size() * 4);
+        pad();
+        put(c.bvh.parent.data(), c.bvh.parent.size() * 4);
+        pad();
+        put(c.bvh.primLeaf.data(), c.bvh.primLeaf.size() * 4);
+        pad();
+    }
+    if (fclose(f) != 0) ok = false;
+    if (!ok) error = std::string("write failed: ") + path;
+    return ok;
+}
+
+// ============== Reading ==============
+// True for paths with the cache extension (.mcache)
+inline bool MeshCache_IsCachePath(const char* path) {
+    const char* ext = strrchr(path, '.');
+    return ext && strcmp(ext, ".mcache") == 0;
+}
+
+// Map a cache file and fill the mesh, its chunks and levels of detail.
+// Every count and reference is checked against the file before use.
+inline bool MeshCache_Load(const char* path, Mesh& mesh, MeshChunks& chunks,
+                           std::vector<MeshLod>& lods, std::vector<MeshChunks>& lodChunks, MeshLoadStats& stats) {
+    using namespace meshio;
+    auto t0 = std::chrono::steady_clock::now();
+    stats = MeshLoadStats();
+    stats.format = "cache";
+
+    MappedFile file;
+    if (!file.Open(path)) { stats.error = std::string("cannot open ") + path; return false; }
+    stats.fileBytes = file.Size();
+    const char* data = file.Data();
+    uint64_t size = file.Size();
+
+    auto fail = [&](const char* why) { stats.error = std::string("mesh cache: ") + why; return false; };
+    if (!IsLittleEndianHost()) return fail("big-endian hosts are not supported");
+    MeshCacheHeader header;
+    if (size < sizeof(header)) return fail("truncated file");
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != MESH_CACHE_MAGIC) return fail("not a mesh cache");
+    if (header.version != MESH_CACHE_VERSION) return fail("unsupported version, convert the mesh again");
+    if (header.fileBytes != size) return fail("truncated file");
+    if (header.levelCount == 0 || header.levelCount > MESH_CACHE_MAX_LEVELS) return fail("bad level count");
+    if (size < sizeof(header) + header.levelCount * sizeof(MeshCacheLevel)) return fail("truncated file");
+    std::vector<MeshCacheLevel> table(header.levelCount);
+    memcpy(table.data(), data + sizeof(header), table.size() * sizeof(MeshCacheLevel));
+
+    lods.resize(header.levelCount - 1);
+    lodChunks.resize(header.levelCount - 1);
+    for (size_t l = 0; l < table.size(); l++) {
+        const MeshCacheLevel& t = table[l];
+        Mesh& m = l ? lods[l - 1].mesh : mesh;
+        MeshChunks& c = l ? lodChunks[l - 1] : chunks;
+        if (l) lods[l - 1].error = t.error;
+        if (t.offset % 8 || t.offset > size || CacheLevelBytes(t) > size - t.offset) return fail("truncated file");
+        const char* p = data + t.offset;
+
+        // Positions: one dequantizing pass per axis
+        std::vector<float>* axes[3] = {&m.x, &m.y, &m.z};
+        for (int a = 0; a < 3; a++) {
+            std::vector<float>& out = *axes[a];
+            out.resize(t.vertexCount);
+            float origin = t.origin[a], step = t.step[a];
+            for (size_t i = 0; i < t.vertexCount; i++) {
+                uint16_t q;
+                memcpy(&q, p + i * 2, 2);
+                out[i] = origin + q * step;
+            }
+            p += Align8(2ull * t.vertexCount);
+        }
+        m.u.clear(); m.v.clear();
+        if (t.flags & MESH_CACHE_UVS) {
+            for (std::vector<float>* uv : {&m.u, &m.v}) {
+                uv->resize(t.vertexCount);
+                memcpy(uv->data(), p, uv->size() * 4);
+                p += Align8(4ull * t.vertexCount);
+            }
+        }
+
+        m.indices.resize(3 * (size_t)t.triangleCount);
+        memcpy(m.indices.data(), p, m.indices.size() * 4);
+        p += Align8(12ull * t.triangleCount);
+        for (uint32_t i : m.indices)
+            if (i >= t.vertexCount) return fail("vertex index out of range");
+
+        // Face planes: decoded normal through the first corner
+        m.nx.resize(t.triangleCount); m.ny.resize(t.triangleCount);
+        m.nz.resize(t.triangleCount); m.nd.resize(t.triangleCount);
+        for (size_t i = 0; i < t.triangleCount; i++) {
+            int16_t uv[2];
+            memcpy(uv, p + i * 4, 4);
+            vec3d n = Oct_Decode(uv[0], uv[1]);
+            m.nx[i] = n.x; m.ny[i] = n.y; m.nz[i] = n.z;
+            m.nd[i] = Vec_Dot(n, m.Vertex(m.indices[i * 3]));
+        }
+        p += Align8(4ull * t.triangleCount);
+
+        c.chunks.resize(t.chunkCount);
+        for (size_t i = 0; i < t.chunkCount; i++, p += 24) {
+            uint32_t f[6];
+            memcpy(f, p, sizeof(f));
+            c.chunks[i] = {f[0], f[1], f[2], f[3], f[4], f[5]};
+        }
+        c.deps.resize(t.depCount);
+        memcpy(c.deps.data(), p, c.deps.size() * 4);
+        p += Align8(4ull * t.depCount);
+
+        Bvh& bvh = c.bvh;
+        bvh.nodes.resize(t.nodeCount);
+        for (size_t i = 0; i < t.nodeCount; i++, p += 32) {
+            float box[6];
+            uint32_t range[2];
+            memcpy(box, p, sizeof(box));
+            memcpy(range, p + 24, sizeof(range));
+            BvhNode& n = bvh.nodes[i];
+            n.box.min = {box[0], box[1], box[2]};
+            n.box.max = {box[3], box[4], box[5]};
+            n.first = range[0];
+            n.count = range[1];
+        }
+        bvh.prims.resize(t.primCount);
+        memcpy(bvh.prims.data(), p, bvh.prims.size() * 4);
+        p += Align8(4ull * t.primCount);
+        bvh.parent.resize(t.nodeCount);
+        memcpy(bvh.parent.data(), p, bvh.parent.size() * 4);
+        p += Align8(4ull * t.nodeCount);
+        bvh.primLeaf.resize(t.primCount);
+        memcpy(bvh.primLeaf.data(), p, bvh.primLeaf.size() * 4);
+
+        // References the renderer follows without checks
+        for (const MeshChunk& ch : c.chunks) {
+            if ((uint64_t)ch.triFirst + ch.triCount > t.triangleCount || ch.vertFirst > ch.vertEnd ||
+                ch.vertEnd > t.vertexCount || (uint64_t)ch.depFirst + ch.depCount > t.depCount)
+                return fail("bad chunk");
+        }
+        for (uint32_t d : c.deps)
+            if (d >= t.chunkCount) return fail("bad chunk");
+        // Children come after their parent (no cycles) and no deeper than
+        // the traversal stack allows
+        std::vector<uint32_t> depth(t.nodeCount, 0);
+        for (size_t i = 0; i < t.nodeCount; i++) {
+            const BvhNode& n = bvh.nodes[i];
+            if (n.count) {
+                if ((uint64_t)n.first + n.count > t.primCount) return fail("bad BVH node");
+                continue;
+            }
+            if (n.first <= i || (uint64_t)n.first + 1 >= t.nodeCount || depth[i] + 1 >= BVH_MAX_DEPTH)
+                return fail("bad BVH node");
+            depth[n.first] = depth[n.first + 1] = depth[i] + 1;
+        }
+        for (uint32_t prim : bvh.prims)
+            if (prim >= t.chunkCount) return fail("bad BVH node");
+        if (t.chunkCount && t.nodeCount == 0) return fail("bad BVH node");
+    }
+
+    stats.vertexCount = mesh.VertexCount();
+    stats.triangleCount = mesh.TriangleCount();
+    stats.memoryBytes = mesh.MemoryBytes();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return true;
+}
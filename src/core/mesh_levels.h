@@ -0,0 +1,110 @@
+/*
+    mesh_levels.h - Shared Mesh Geometry and Background LOD Builds
+    Once built, the geometry an engine draws is read-only: the full mesh cut
+    into chunks (level 0) and, apart from it, the coarser levels of detail.
+    Both are held through shared_ptr<const ...> so they are shared rather
+    than copied.
+
+    Simplifying a large mesh takes far longer than loading it (tens of
+    seconds for millions of triangles), so MeshLevelBuilder does it on a
+    thread of its own while the full mesh is drawn. Starting another build
+    or destroying the builder cancels one still running.
+*/
+
+#pragma once
+
+#include "bvh.h"
+#include "mesh.h"
+#include "mesh_simplify.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct MeshGeometry {
+    Mesh mesh;                      // In chunk order, face planes computed
+    MeshChunks chunks;
+};
+
+struct MeshLevels {
+    std::vector<MeshLod> lods;      // lods[l - 1] is level l, face planes computed
+    std::vector<MeshChunks> chunks; // Chunks of each of lods
+    double seconds = 0;             // Time it took to build them (0 if loaded)
+};
+
+// Cut `mesh` into chunks and compute its face planes
+inline std::shared_ptr<const MeshGeometry> MeshGeometry_Build(Mesh mesh) {
+    auto geometry = std::make_shared<MeshGeometry>();
+    geometry->mesh = std::move(mesh);
+    Mesh_BuildChunks(geometry->mesh, geometry->chunks);
+    Mesh_ComputeFacePlanes(geometry->mesh);
+    return geometry;
+}
+
+// Build the levels of detail of `mesh` and their chunks. Returns false,
+// with `out` incomplete, if *cancel was set meanwhile.
+inline bool MeshLevels_Build(const Mesh& mesh, MeshLevels& out, const std::atomic<bool>* cancel = nullptr) {
+    auto start = std::chrono::steady_clock::now();
+    if (!Mesh_BuildLods(mesh, out.lods, cancel)) return false;
+    out.chunks.assign(out.lods.size(), MeshChunks());
+    for (size_t l = 0; l < out.lods.size(); l++) {
+        if (cancel && cancel->load()) return false;
+        Mesh_BuildChunks(out.lods[l].mesh, out.chunks[l]);
+        Mesh_ComputeFacePlanes(out.lods[l].mesh);
+    }
+    out.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+// Builds the levels of detail of one geometry at a time in the background
+class MeshLevelBuilder {
+public:
+    MeshLevelBuilder() = default;
+    MeshLevelBuilder(const MeshLevelBuilder&) = delete;
+    MeshLevelBuilder& operator=(const MeshLevelBuilder&) = delete;
+    ~MeshLevelBuilder() { Cancel(); }
+
+    // Start building the levels of `geometry`, cancelling any other build
+    void Start(std::shared_ptr<const MeshGeometry> geometry) {
+        Cancel();
+        cancel = false;
+        done = false;
+        worker = std::thread([this, geometry] {
+            auto levels = std::make_shared<MeshLevels>();
+            if (!MeshLevels_Build(geometry->mesh, *levels, &cancel)) return;
+            result = std::move(levels);
+            done.store(true, std::memory_order_release);
+        });
+    }
+
+    // A build was started and its levels were not taken yet
+    bool Running() const { return worker.joinable(); }
+
+    // The levels can be taken without waiting
+    bool Ready() const { return done.load(std::memory_order_acquire); }
+
+    // The built levels, waiting for them if `wait`; nullptr if no build is
+    // running, or it has not finished and !wait
+    std::shared_ptr<const MeshLevels> Take(bool wait) {
+        if (!worker.joinable() || (!wait && !Ready())) return nullptr;
+        worker.join();
+        done = false;
+        return std::move(result);
+    }
+
+    // Stop the running build and drop its levels
+    void Cancel() {
+        if (!worker.joinable()) return;
+        cancel = true;
+        worker.join();
+        done = false;
+        result.reset();
+    }
+
+private:
+    std::thread worker;
+    std::atomic<bool> cancel{false}, done{false};
+    std::shared_ptr<const MeshLevels> result;   // Set by worker, read after joining it
+};
@@ -0,0 +1,448 @@
+/*
+    mesh_loader.h - Streaming OBJ / binary PLY Loader
+    Parses straight out of a memory-mapped file into a Mesh. No per-line
+    std::string, no iostreams: a counting pre-pass sizes the vertex and
+    index stores once, then a single pass fills them.
+
+    Both formats are right-handed with counter-clockwise front faces. The
+    engine is left-handed (z into the screen) with clockwise front faces,
+    so z is negated and the winding is swapped on load.
+*/
+
+#pragma once
+
+#include "mapped_file.h"
+#include "mesh.h"
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ============== Load Statistics ==============
+struct MeshLoadStats {
+    const char* format = "";
+    size_t fileBytes = 0;
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    size_t memoryBytes = 0;     // Mesh vertex + index storage
+    double seconds = 0;
+    std::string error;
+};
+
+// ============== Text Scanning Helpers ==============
+namespace meshio {
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char* SkipSpace(const char* p, const char* end) {
+    while (p < end && IsSpace(*p)) p++;
+    return p;
+}
+
+inline const char* SkipLine(const char* p, const char* end) {
+    const char* nl = (const char*)memchr(p, '\n', end - p);
+    return nl ? nl + 1 : end;
+}
+
+// Decimal float parser for [sign] digits [. digits] [e [sign] digits]
+inline const char* ParseFloat(const char* p, const char* end, float& out) {
+    static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                   1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+    uint64_t mant = 0;
+    int digits = 0, exp10 = 0;
+    for (; p < end && (unsigned)(*p - '0') < 10; p++) {
+        if (digits < 18) { mant = mant * 10 + (*p - '0'); digits++; }
+        else exp10++;
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && (unsigned)(*p - '0') < 10; p++)
+            if (digits < 18) { mant = mant * 10 + (*p - '0'); digits++; exp10--; }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool eneg = false;
+        if (p < end && (*p == '-' || *p == '+')) eneg = (*p++ == '-');
+        int e = 0;
+        for (; p < end && (unsigned)(*p - '0') < 10; p++) e = e * 10 + (*p - '0');
+        exp10 += eneg ? -e : e;
+    }
+    double v = (double)mant;
+    if (exp10 < 0) v = exp10 >= -18 ? v / pow10[-exp10] : v * std::pow(10.0, exp10);
+    else if (exp10 > 0) v = exp10 <= 18 ? v * pow10[exp10] : v * std::pow(10.0, exp10);
+    out = (float)(neg ? -v : v);
+    return p;
+}
+
+inline const char* ParseInt(const char* p, const char* end, long long& out) {
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+    long long v = 0;
+    for (; p < end && (unsigned)(*p - '0') < 10; p++) v = v * 10 + (*p - '0');
+    out = neg ? -v : v;
+    return p;
+}
+
+} // namespace meshio
+
+// ============== Wavefront OBJ ==============
+// Reads "v" positions, "vt" texture coordinates and "f" faces (v, v/vt,
+// v//vn, v/vt/vn, negative indices). Polygons are fan-triangulated;
+// everything else is skipped. With texture coordinates, every distinct
+// position/coordinate pair the faces use becomes one mesh vertex.
+inline bool Mesh_ParseOBJ(const char* data, size_t size, Mesh& mesh, std::string& error) {
+    using namespace meshio;
+    const char* end = data + size;
+
+    // Pre-pass: count vertex and face lines so storage is allocated once
+    size_t nVerts = 0, nFaces = 0, nCoords = 0;
+    for (const char* p = data; p < end; p = SkipLine(p, end)) {
+        p = SkipSpace(p, end);
+        if (end - p > 1 && p[0] == 'v' && IsSpace(p[1])) nVerts++;
+        else if (end - p > 2 && p[0] == 'v' && p[1] == 't' && IsSpace(p[2])) nCoords++;
+        else if (end - p > 1 && p[0] == 'f' && IsSpace(p[1])) nFaces++;
+    }
+    mesh.Clear();
+    mesh.Reserve(nVerts, nFaces);
+
+    // Positions and coordinates as listed, when corners pair them up
+    bool textured = nCoords > 0;
+    std::vector<float> px, py, pz, tu, tv;
+    std::unordered_map<uint64_t, uint32_t> corners;     // position << 32 | coordinate + 1 -> vertex
+    if (textured) {
+        px.reserve(nVerts); py.reserve(nVerts); pz.reserve(nVerts);
+        tu.reserve(nCoords); tv.reserve(nCoords);
+        corners.reserve(nVerts * 2);
+    }
+
+    size_t lineNo = 0;
+    for (const char* p = data; p < end; ) {
+        lineNo++;
+        p = SkipSpace(p, end);
+        if (end - p > 1 && p[0] == 'v' && IsSpace(p[1])) {
+            float v[3];
+            p += 2;
+            for (int i = 0; i < 3; i++) p = ParseFloat(SkipSpace(p, end), end, v[i]);
+            if (textured) { px.push_back(v[0]); py.push_back(v[1]); pz.push_back(-v[2]); }
+            else mesh.AddVertex(v[0], v[1], -v[2]);
+        } else if (end - p > 2 && p[0] == 'v' && p[1] == 't' && IsSpace(p[2])) {
+            float t[2];
+            p += 3;
+            for (int i = 0; i < 2; i++) p = ParseFloat(SkipSpace(p, end), end, t[i]);
+            tu.push_back(t[0]);
+            tv.push_back(1.0f - t[1]);      // OBJ images start at the bottom
+        } else if (end - p > 1 && p[0] == 'f' && IsSpace(p[1])) {
+            p += 2;
+            uint32_t first = 0, prev = 0;
+            int corner = 0;
+            size_t nPos = textured ? px.size() : mesh.VertexCount();
+            while (true) {
+                p = SkipSpace(p, end);
+                if (p >= end || *p == '\n' || *p == '#') break;
+                long long idx, tex = 0;
+                const char* q = ParseInt(p, end, idx);
+                if (q == p) { error = "OBJ: bad face on line " + std::to_string(lineNo); return false; }
+                p = q;
+                if (p < end && *p == '/') p = ParseInt(p + 1, end, tex);
+                while (p < end && !IsSpace(*p) && *p != '\n') p++;   // Skip /vn
+                long long resolved = idx < 0 ? (long long)nPos + idx : idx - 1;
+                if (resolved < 0 || resolved >= (long long)nPos) {
+                    error = "OBJ: vertex index out of range on line " + std::to_string(lineNo);
+                    return false;
+                }
+                uint32_t vi = (uint32_t)resolved;
+                if (textured) {
+                    long long ti = tex < 0 ? (long long)tu.size() + tex : tex - 1;     // -1: none
+                    if (tex && (ti < 0 || ti >= (long long)tu.size())) {
+                        error = "OBJ: texture coordinate index out of range on line " + std::to_string(lineNo);
+                        return false;
+                    }
+                    uint64_t key = (uint64_t)vi << 32 | (uint32_t)(ti + 1);
+                    auto found = corners.emplace(key, (uint32_t)mesh.VertexCount());
+                    if (found.second)
+                        mesh.AddVertex(px[vi], py[vi], pz[vi], ti >= 0 ? tu[ti] : 0.0f, ti >= 0 ? tv[ti] : 0.0f);
+                    vi = found.first->second;
+                }
+                if (corner == 0) first = vi;
+                else if (corner >= 2) mesh.AddTriangle(first, vi, prev);
+                prev = vi;
+                corner++;
+            }
+        }
+        p = SkipLine(p, end);
+    }
+    return true;
+}
+
+// ============== Binary PLY ==============
+namespace meshio {
+
+enum PlyType { PLY_NONE, PLY_I8, PLY_U8, PLY_I16, PLY_U16, PLY_I32, PLY_U32, PLY_F32, PLY_F64 };
+
+inline PlyType PlyTypeFromName(const char* s, size_t n) {
+    auto is = [&](const char* name) { return strlen(name) == n && memcmp(s, name, n) == 0; };
+    if (is("char") || is("int8")) return PLY_I8;
+    if (is("uchar") || is("uint8")) return PLY_U8;
+    if (is("short") || is("int16")) return PLY_I16;
+    if (is("ushort") || is("uint16")) return PLY_U16;
+    if (is("int") || is("int32")) return PLY_I32;
+    if (is("uint") || is("uint32")) return PLY_U32;
+    if (is("float") || is("float32")) return PLY_F32;
+    if (is("double") || is("float64")) return PLY_F64;
+    return PLY_NONE;
+}
+
+inline int PlyTypeSize(PlyType t) {
+    static const int sizes[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+    return sizes[t];
+}
+
+inline double PlyRead(const unsigned char* p, PlyType t, bool swap) {
+    unsigned char b[8];
+    int n = PlyTypeSize(t);
+    for (int i = 0; i < n; i++) b[i] = swap ? p[n - 1 - i] : p[i];
+    switch (t) {
+        case PLY_I8:  return (double)(int8_t)b[0];
+        case PLY_U8:  return (double)b[0];
+        case PLY_I16: { int16_t v; memcpy(&v, b, 2); return v; }
+        case PLY_U16: { uint16_t v; memcpy(&v, b, 2); return v; }
+        case PLY_I32: { int32_t v; memcpy(&v, b, 4); return v; }
+        case PLY_U32: { uint32_t v; memcpy(&v, b, 4); return v; }
+        case PLY_F32: { float v; memcpy(&v, b, 4); return v; }
+        case PLY_F64: { double v; memcpy(&v, b, 8); return v; }
+        default: return 0;
+    }
+}
+
+struct PlyProperty {
+    PlyType type = PLY_NONE;        // Scalar type, or list item type
+    PlyType countType = PLY_NONE;   // != PLY_NONE for list properties
+    char name[32] = {};
+};
+
+struct PlyElement {
+    char name[32] = {};
+    size_t count = 0;
+    PlyProperty props[16];
+    int nProps = 0;
+};
+
+inline bool IsLittleEndianHost() {
+    uint16_t v = 1;
+    unsigned char b;
+    memcpy(&b, &v, 1);
+    return b == 1;
+}
+
+// Header: plain text lines up to "end_header". body points past it.
+struct PlyHeader {
+    PlyElement elems[8];
+    int nElems = 0;
+    bool little = true;
+    const char* body = nullptr;
+};
+
+inline bool ParsePlyHeader(const char* data, size_t size, PlyHeader& h, std::string& error) {
+    const char* end = data + size;
+    const char* p = data;
+    bool formatSeen = false;
+    auto word = [&](const char*& s, const char* lineEnd, size_t& n) {
+        s = SkipSpace(s, lineEnd);
+        const char* w = s;
+        while (s < lineEnd && !IsSpace(*s)) s++;
+        n = (size_t)(s - w);
+        return w;
+    };
+    auto copyName = [](char* dst, const char* src, size_t n) {
+        n = n < 31 ? n : 31;
+        memcpy(dst, src, n); dst[n] = 0;
+    };
+
+    while (true) {
+        if (p >= end) { error = "PLY: missing end_header"; return false; }
+        const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+        if (!lineEnd) lineEnd = end;
+        const char* s = p;
+        size_t n;
+        const char* kw = word(s, lineEnd, n);
+        // The last line may lack its newline: the next one starts at end, not past it
+        const char* next = lineEnd < end ? lineEnd + 1 : end;
+        if (n == 10 && memcmp(kw, "end_header", 10) == 0) { p = next; break; }
+        if (n == 6 && memcmp(kw, "format", 6) == 0) {
+            const char* f = word(s, lineEnd, n);
+            if (n == 20 && memcmp(f, "binary_little_endian", 20) == 0) h.little = true;
+            else if (n == 17 && memcmp(f, "binary_big_endian", 17) == 0) h.little = false;
+            else { error = "PLY: only binary PLY is supported"; return false; }
+            formatSeen = true;
+        } else if (n == 7 && memcmp(kw, "element", 7) == 0) {
+            if (h.nElems == 8) { error = "PLY: too many elements"; return false; }
+            PlyElement& e = h.elems[h.nElems++];
+            const char* nm = word(s, lineEnd, n);
+            copyName(e.name, nm, n);
+            long long count;
+            ParseInt(SkipSpace(s, lineEnd), lineEnd, count);
+            e.count = (size_t)count;
+        } else if (n == 8 && memcmp(kw, "property", 8) == 0) {
+            if (h.nElems == 0 || h.elems[h.nElems - 1].nProps == 16) { error = "PLY: bad property"; return false; }
+            PlyProperty& prop = h.elems[h.nElems - 1].props[h.elems[h.nElems - 1].nProps++];
+            const char* t = word(s, lineEnd, n);
+            if (n == 4 && memcmp(t, "list", 4) == 0) {
+                t = word(s, lineEnd, n); prop.countType = PlyTypeFromName(t, n);
+                t = word(s, lineEnd, n); prop.type = PlyTypeFromName(t, n);
+                if (prop.countType == PLY_NONE) { error = "PLY: bad list type"; return false; }
+            } else {
+                prop.type = PlyTypeFromName(t, n);
+            }
+            if (prop.type == PLY_NONE) { error = "PLY: unknown property type"; return false; }
+            const char* nm = word(s, lineEnd, n);
+            copyName(prop.name, nm, n);
+        }
+        p = next;
+    }
+    if (!formatSeen) { error = "PLY: missing format line"; return false; }
+    if (p > end) { error = "PLY: truncated file"; return false; }
+    h.body = p;
+    return true;
+}
+
+} // namespace meshio
+
+inline bool Mesh_ParsePLY(const char* data, size_t size, Mesh& mesh, std::string& error) {
+    using namespace meshio;
+    const char* end = data + size;
+    PlyHeader header;
+    if (!ParsePlyHeader(data, size, header, error)) return false;
+    PlyElement* elems = header.elems;
+    int nElems = header.nElems;
+
+    bool swap = header.little != IsLittleEndianHost();
+    const unsigned char* b = (const unsigned char*)header.body;
+    const unsigned char* bend = (const unsigned char*)end;
+
+    size_t nVerts = 0, nFaces = 0;
+    for (int e = 0; e < nElems; e++) {
+        if (strcmp(elems[e].name, "vertex") == 0) nVerts = elems[e].count;
+        if (strcmp(elems[e].name, "face") == 0) nFaces = elems[e].count;
+    }
+    mesh.Clear();
+    mesh.Reserve(nVerts, nFaces);
+
+    for (int e = 0; e < nElems; e++) {
+        PlyElement& el = elems[e];
+        bool isVertex = strcmp(el.name, "vertex") == 0;
+        bool isFace = strcmp(el.name, "face") == 0;
+
+        // Fixed-size records: byte offsets of x/y/z (and u/v) and the record stride
+        bool fixed = true;
+        int stride = 0, offs[5] = {-1, -1, -1, -1, -1};
+        PlyType types[5] = {PLY_NONE, PLY_NONE, PLY_NONE, PLY_NONE, PLY_NONE};
+        static const char* const names[5][4] = {
+            {"x", "x", "x", "x"}, {"y", "y", "y", "y"}, {"z", "z", "z", "z"},
+            {"u", "s", "texture_u", "texture_s"}, {"v", "t", "texture_v", "texture_t"}};
+        for (int i = 0; i < el.nProps; i++) {
+            const PlyProperty& pr = el.props[i];
+            if (pr.countType != PLY_NONE) { fixed = false; break; }
+            for (int k = 0; k < 5; k++)
+                for (const char* name : names[k])
+                    if (offs[k] < 0 && strcmp(pr.name, name) == 0) { offs[k] = stride; types[k] = pr.type; }
+            stride += PlyTypeSize(pr.type);
+        }
+        if (isVertex && (!fixed || offs[0] < 0 || offs[1] < 0 || offs[2] < 0)) {
+            error = "PLY: vertex element needs fixed-size x, y, z";
+            return false;
+        }
+
+        if (fixed) {
+            if ((size_t)(bend - b) < el.count * (size_t)stride) { error = "PLY: truncated file"; return false; }
+            if (isVertex) {
+                bool fastF32 = !swap && types[0] == PLY_F32 && types[1] == PLY_F32 && types[2] == PLY_F32;
+                bool hasUVs = offs[3] >= 0 && offs[4] >= 0;
+                for (size_t i = 0; i < el.count; i++, b += stride) {
+                    float v[3];
+                    if (fastF32) for (int k = 0; k < 3; k++) memcpy(&v[k], b + offs[k], 4);
+                    else for (int k = 0; k < 3; k++) v[k] = (float)PlyRead(b + offs[k], types[k], swap);
+                    if (hasUVs)     // Images start at the bottom, as in OBJ
+                        mesh.AddVertex(v[0], v[1], -v[2], (float)PlyRead(b + offs[3], types[3], swap),
+                                       1.0f - (float)PlyRead(b + offs[4], types[4], swap));
+                    else mesh.AddVertex(v[0], v[1], -v[2]);
+                }
+            } else {
+                b += el.count * (size_t)stride;
+            }
+            continue;
+        }
+
+        // Records containing lists: walk property by property
+        for (size_t i = 0; i < el.count; i++) {
+            for (int k = 0; k < el.nProps; k++) {
+                const PlyProperty& pr = el.props[k];
+                if (pr.countType == PLY_NONE) {
+                    b += PlyTypeSize(pr.type);
+                    continue;
+                }
+                int cs = PlyTypeSize(pr.countType), is = PlyTypeSize(pr.type);
+                if (bend - b < cs) { error = "PLY: truncated file"; return false; }
+                size_t cnt = (size_t)PlyRead(b, pr.countType, swap);
+                b += cs;
+                if ((size_t)(bend - b) < cnt * is) { error = "PLY: truncated file"; return false; }
+                bool isIndexList = isFace && (strcmp(pr.name, "vertex_indices") == 0 ||
+                                              strcmp(pr.name, "vertex_index") == 0);
+                if (isIndexList) {
+                    uint32_t first = 0, prev = 0;
+                    for (size_t c = 0; c < cnt; c++) {
+                        double d = PlyRead(b + c * is, pr.type, swap);
+                        if (d < 0 || d >= (double)mesh.VertexCount()) {
+                            error = "PLY: vertex index out of range";
+                            return false;
+                        }
+                        uint32_t vi = (uint32_t)d;
+                        if (c == 0) first = vi;
+                        else if (c >= 2) mesh.AddTriangle(first, vi, prev);
+                        prev = vi;
+                    }
+                }
+                b += cnt * is;
+            }
+            if (b > bend) { error = "PLY: truncated file"; return false; }
+        }
+    }
+    return true;
+}
+
+// ============== Entry Point ==============
+// Picks the parser from the file extension (.obj / .ply)
+inline bool Mesh_Load(const char* path, Mesh& mesh, MeshLoadStats& stats) {
+    auto t0 = std::chrono::steady_clock::now();
+    stats = MeshLoadStats();
+
+    MappedFile file;
+    if (!file.Open(path)) { stats.error = std::string("cannot open ") + path; return false; }
+    stats.fileBytes = file.Size();
+
+    const char* ext = strrchr(path, '.');
+    auto extIs = [&](const char* e) {
+        if (!ext) return false;
+        for (size_t i = 0; ; i++) {
+            char a = (char)tolower((unsigned char)ext[i]);
+            if (a != e[i]) return false;
+            if (!a) return true;
+        }
+    };
+
+    bool ok;
+    if (extIs(".obj")) { stats.format = "OBJ"; ok = Mesh_ParseOBJ(file.Data(), file.Size(), mesh, stats.error); }
+    else if (extIs(".ply")) { stats.format = "PLY"; ok = Mesh_ParsePLY(file.Data(), file.Size(), mesh, stats.error); }
+    else { stats.error = "unsupported file type (expected .obj or .ply)"; return false; }
+    if (!ok) return false;
+
+    stats.vertexCount = mesh.VertexCount();
+    stats.triangleCount = mesh.TriangleCount();
+    stats.memoryBytes = mesh.MemoryBytes();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return true;
+}
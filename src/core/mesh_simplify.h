@@ -0,0 +1,282 @@
+/*
+    mesh_simplify.h - Quadric Error Mesh Simplification
+    Edge collapses in order of the quadric error metric (Garland-Heckbert):
+    every vertex sums the planes of its triangles, and collapsing an edge
+    costs the squared distance of the merged vertex to all those planes.
+    The merged vertex goes to whichever of the two ends or the midpoint
+    costs least, so it never leaves the original surface's hull. Border
+    edges add a plane perpendicular to their triangle so open meshes keep
+    their outline, and collapses that would flip a triangle are skipped.
+    Texture coordinates move with the merged vertex; UV seams are borders
+    (their vertices are split), so they keep their outline too.
+
+    Collapses are taken cheapest first by the mean squared distance per
+    plane, so areas with many triangles are not held back. The error a
+    level reports is the summed distance instead, which no single plane
+    exceeds, so it bounds the deviation rather than averaging it away.
+
+    Mesh_BuildLods() chains simplifications into levels of detail with
+    about half the triangles each, and the error each level may show. Both
+    take an optional flag that cancels them from another thread.
+*/
+
+#pragma once
+
+#include "mesh.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+// ============== Quadrics ==============
+// Symmetric 4x4 matrix of summed planes: xx xy xz xw yy yz yw zz zw ww
+struct Quadric {
+    double q[10] = {};
+    double planes = 0;      // Planes summed, for the mean error collapses are ordered by
+
+    void AddPlane(double a, double b, double c, double d) {
+        q[0] += a * a; q[1] += a * b; q[2] += a * c; q[3] += a * d;
+        q[4] += b * b; q[5] += b * c; q[6] += b * d;
+        q[7] += c * c; q[8] += c * d; q[9] += d * d;
+        planes += 1;
+    }
+
+    void Add(const Quadric& o) {
+        for (int i = 0; i < 10; i++) q[i] += o.q[i];
+        planes += o.planes;
+    }
+
+    // Summed squared distance of (x, y, z) to the planes
+    double Error(double x, double y, double z) const {
+        return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x +
+               q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y +
+               q[7] * z * z + 2 * q[8] * z + q[9];
+    }
+};
+
+// ============== Simplification ==============
+struct SimplifyResult {
+    size_t triangles = 0;
+    float error = 0;        // Largest distance of a merged vertex to any of its planes, mesh units (bound)
+};
+
+// Collapse edges of `in` until at most targetTris triangles remain (or no
+// edge can go without flipping a triangle) and write the result to `out`.
+// Once *cancel is set it returns 0 triangles and leaves `out` alone.
+inline SimplifyResult Mesh_Simplify(const Mesh& in, Mesh& out, size_t targetTris,
+                                    const std::atomic<bool>* cancel = nullptr) {
+    struct Collapse {
+        double cost;                // Mean squared plane distance, orders the collapses
+        double sum;                 // Summed squared plane distance, bounds every single one
+        uint32_t a, b;              // Vertices
+        uint32_t versionA, versionB;
+        float x, y, z;              // Merged position
+        float u, v;                 // and texture coordinates
+        bool operator<(const Collapse& o) const { return cost > o.cost; }   // Min-heap
+    };
+
+    size_t nVerts = in.VertexCount(), nTris = in.TriangleCount();
+    std::vector<float> px(in.x), py(in.y), pz(in.z);
+    bool hasUVs = in.HasUVs();
+    std::vector<float> pu(hasUVs ? in.u : std::vector<float>(nVerts, 0.0f));
+    std::vector<float> pv(hasUVs ? in.v : std::vector<float>(nVerts, 0.0f));
+    std::vector<uint32_t> idx(in.indices);
+    std::vector<uint8_t> triDead(nTris, 0);
+    std::vector<Quadric> quadric(nVerts);
+    std::vector<uint32_t> version(nVerts, 0);
+    std::vector<std::vector<uint32_t>> vertTris(nVerts);
+    auto cancelled = [&] { return cancel && cancel->load(std::memory_order_relaxed); };
+
+    auto normal = [&](uint32_t t, double& nx, double& ny, double& nz) {
+        const uint32_t* v = &idx[t * 3];
+        double ux = px[v[1]] - px[v[0]], uy = py[v[1]] - py[v[0]], uz = pz[v[1]] - pz[v[0]];
+        double wx = px[v[2]] - px[v[0]], wy = py[v[2]] - py[v[0]], wz = pz[v[2]] - pz[v[0]];
+        nx = uy * wz - uz * wy; ny = uz * wx - ux * wz; nz = ux * wy - uy * wx;
+        return sqrt(nx * nx + ny * ny + nz * nz);
+    };
+
+    // Triangle planes, and the border edges (used by one triangle only)
+    std::vector<uint64_t> edges;
+    edges.reserve(nTris * 3);
+    for (size_t t = 0; t < nTris; t++) {
+        double nx, ny, nz;
+        double len = normal((uint32_t)t, nx, ny, nz);
+        const uint32_t* v = &idx[t * 3];
+        for (int i = 0; i < 3; i++) vertTris[v[i]].push_back((uint32_t)t);
+        if (len <= 0) continue;
+        nx /= len; ny /= len; nz /= len;
+        double d = -(nx * px[v[0]] + ny * py[v[0]] + nz * pz[v[0]]);
+        for (int i = 0; i < 3; i++) quadric[v[i]].AddPlane(nx, ny, nz, d);
+        for (int i = 0; i < 3; i++) {
+            uint32_t a = v[i], b = v[(i + 1) % 3];
+            edges.push_back((uint64_t)std::min(a, b) << 32 | std::max(a, b));
+        }
+    }
+    if (cancelled()) return SimplifyResult();
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i;
+        while (j < edges.size() && edges[j] == edges[i]) j++;
+        if (j - i == 1) {
+            uint32_t a = (uint32_t)(edges[i] >> 32), b = (uint32_t)edges[i];
+            // The triangle this border edge belongs to
+            for (uint32_t t : vertTris[a]) {
+                const uint32_t* v = &idx[t * 3];
+                if (v[0] != b && v[1] != b && v[2] != b) continue;
+                double nx, ny, nz;
+                if (normal(t, nx, ny, nz) <= 0) break;
+                double ex = px[b] - px[a], ey = py[b] - py[a], ez = pz[b] - pz[a];
+                double cx = ey * nz - ez * ny, cy = ez * nx - ex * nz, cz = ex * ny - ey * nx;
+                double len = sqrt(cx * cx + cy * cy + cz * cz);
+                if (len <= 0) break;
+                cx /= len; cy /= len; cz /= len;
+                double d = -(cx * px[a] + cy * py[a] + cz * pz[a]);
+                quadric[a].AddPlane(cx, cy, cz, d);
+                quadric[b].AddPlane(cx, cy, cz, d);
+                break;
+            }
+        }
+        i = j;
+    }
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    // Cheapest of the two ends and the midpoint
+    auto evaluate = [&](uint32_t a, uint32_t b) {
+        Quadric q = quadric[a];
+        q.Add(quadric[b]);
+        Collapse c;
+        c.a = a; c.b = b;
+        c.versionA = version[a]; c.versionB = version[b];
+        float cand[3][5] = {{px[a], py[a], pz[a], pu[a], pv[a]}, {px[b], py[b], pz[b], pu[b], pv[b]},
+                            {(px[a] + px[b]) * 0.5f, (py[a] + py[b]) * 0.5f, (pz[a] + pz[b]) * 0.5f,
+                             (pu[a] + pu[b]) * 0.5f, (pv[a] + pv[b]) * 0.5f}};
+        c.cost = 1e300;
+        for (auto& p : cand) {
+            double e = q.Error(p[0], p[1], p[2]);
+            if (e < c.cost) { c.cost = e; c.x = p[0]; c.y = p[1]; c.z = p[2]; c.u = p[3]; c.v = p[4]; }
+        }
+        c.sum = std::max(c.cost, 0.0);
+        c.cost = c.sum / std::max(q.planes, 1.0);
+        return c;
+    };
+
+    if (cancelled()) return SimplifyResult();
+    std::priority_queue<Collapse> heap;
+    for (uint64_t e : edges) heap.push(evaluate((uint32_t)(e >> 32), (uint32_t)e));
+
+    // Would moving a and b to p flip or collapse a surviving triangle?
+    auto flips = [&](const Collapse& c) {
+        for (uint32_t v : {c.a, c.b}) {
+            for (uint32_t t : vertTris[v]) {
+                if (triDead[t]) continue;
+                uint32_t* tri = &idx[t * 3];
+                bool hasA = tri[0] == c.a || tri[1] == c.a || tri[2] == c.a;
+                bool hasB = tri[0] == c.b || tri[1] == c.b || tri[2] == c.b;
+                if (hasA && hasB) continue;     // Removed by the collapse
+                double ox, oy, oz;
+                if (normal(t, ox, oy, oz) <= 0) continue;
+                float sx = px[v], sy = py[v], sz = pz[v];
+                px[v] = c.x; py[v] = c.y; pz[v] = c.z;
+                double nx, ny, nz;
+                double len = normal(t, nx, ny, nz);
+                px[v] = sx; py[v] = sy; pz[v] = sz;
+                if (len <= 0 || ox * nx + oy * ny + oz * nz <= 0) return true;
+            }
+        }
+        return false;
+    };
+
+    size_t liveTris = nTris;
+    double worst = 0;
+    std::vector<uint32_t> neighbours;
+    for (size_t step = 0; liveTris > targetTris && !heap.empty(); step++) {
+        if ((step & 4095) == 0 && cancelled()) return SimplifyResult();
+        Collapse c = heap.top();
+        heap.pop();
+        if (c.versionA != version[c.a] || c.versionB != version[c.b]) continue;    // Stale
+        if (flips(c)) continue;
+
+        // Merge b into a
+        uint32_t a = c.a, b = c.b;
+        px[a] = c.x; py[a] = c.y; pz[a] = c.z;
+        pu[a] = c.u; pv[a] = c.v;
+        quadric[a].Add(quadric[b]);
+        version[a]++;
+        version[b]++;
+        worst = std::max(worst, c.sum);
+        for (uint32_t t : vertTris[b]) {
+            if (triDead[t]) continue;
+            uint32_t* tri = &idx[t * 3];
+            if (tri[0] == a || tri[1] == a || tri[2] == a) {
+                triDead[t] = 1;
+                liveTris--;
+                continue;
+            }
+            for (int i = 0; i < 3; i++) if (tri[i] == b) tri[i] = a;
+            vertTris[a].push_back(t);
+        }
+        std::vector<uint32_t>().swap(vertTris[b]);
+
+        // Drop dead triangles from a's list, then re-cost a's edges
+        auto& list = vertTris[a];
+        list.erase(std::remove_if(list.begin(), list.end(), [&](uint32_t t) { return triDead[t] != 0; }), list.end());
+        neighbours.clear();
+        for (uint32_t t : list)
+            for (int i = 0; i < 3; i++)
+                if (idx[t * 3 + i] != a) neighbours.push_back(idx[t * 3 + i]);
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        for (uint32_t n : neighbours) heap.push(evaluate(a, n));
+    }
+
+    // Compact: surviving triangles and the vertices they use
+    std::vector<uint32_t> remap(nVerts, UINT32_MAX);
+    out.Clear();
+    out.Reserve(nVerts, liveTris);
+    for (size_t t = 0; t < nTris; t++) {
+        if (triDead[t]) continue;
+        uint32_t v[3];
+        for (int i = 0; i < 3; i++) {
+            uint32_t s = idx[t * 3 + i];
+            if (remap[s] == UINT32_MAX)
+                remap[s] = hasUVs ? out.AddVertex(px[s], py[s], pz[s], pu[s], pv[s]) : out.AddVertex(px[s], py[s], pz[s]);
+            v[i] = remap[s];
+        }
+        out.AddTriangle(v[0], v[1], v[2]);
+    }
+    SimplifyResult result;
+    result.triangles = out.TriangleCount();
+    result.error = (float)sqrt(worst);
+    return result;
+}
+
+// ============== Levels of Detail ==============
+const int MESH_LOD_MAX = 6;             // Levels after the full mesh
+const size_t MESH_LOD_MIN_TRIS = 64;    // Meshes this small are not reduced
+
+struct MeshLod {
+    Mesh mesh;
+    float error = 0;        // Deviation from the full mesh, mesh units (upper estimate)
+};
+
+// Halve the triangle count level by level, each from the previous one.
+// Errors add up along the chain. Stops when a level no longer shrinks.
+// Returns false, with lods incomplete, if *cancel was set meanwhile.
+inline bool Mesh_BuildLods(const Mesh& mesh, std::vector<MeshLod>& lods, const std::atomic<bool>* cancel = nullptr) {
+    lods.clear();
+    const Mesh* src = &mesh;
+    float error = 0;
+    for (int level = 0; level < MESH_LOD_MAX && src->TriangleCount() >= MESH_LOD_MIN_TRIS; level++) {
+        MeshLod lod;
+        SimplifyResult r = Mesh_Simplify(*src, lod.mesh, src->TriangleCount() / 2, cancel);
+        if (cancel && cancel->load()) return false;
+        if (r.triangles == 0 || r.triangles * 4 > src->TriangleCount() * 3) break;   // Less than 25% gone
+        error += r.error;
+        lod.error = error;
+        lods.push_back(std::move(lod));
+        src = &lods.back().mesh;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+/*
+    occlusion.h - Occlusion Culling against the Previous Frame
+    Keeps the farthest depth of every 8x8 tile of the last frame (the
+    depth buffer's tileMin) and tests bounding boxes against it: a box
+    whose nearest point is behind everything drawn in all the tiles it
+    covers was hidden.
+
+    The test uses the current transforms against last frame's depth, so
+    something uncovered by a moving occluder can appear one frame late.
+*/
+
+#pragma once
+
+#include "../math3d/math3d.h"
+#include "bvh.h"
+#include "depth_buffer.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// ============== Occlusion Buffer ==============
+struct OcclusionBuffer {
+    int width = 0, height = 0;      // Screen size the tiles cover
+    int tilesX = 0, tilesY = 0;
+    std::vector<float> tileMin;     // Farthest 1/w per tile, 0 = nothing drawn
+    bool valid = false;
+
+    // Take the tile depths of a finished frame
+    void Capture(const DepthBuffer& db) {
+        width = db.width; height = db.height;
+        tilesX = db.tilesX; tilesY = db.tilesY;
+        tileMin.assign(db.tileMin, db.tileMin + (size_t)tilesX * tilesY);
+        valid = true;
+    }
+
+    void Invalidate() { valid = false; }
+
+    // Usable for a frame of this size
+    bool Ready(int w, int h) const { return valid && w == width && h == height; }
+
+    // True if the box (transformed to clip space by toClip) lies behind the
+    // captured depth everywhere it covers. Boxes reaching the near plane
+    // are never hidden.
+    bool BoxHidden(const Aabb& box, const mat4x4& toClip) const {
+        float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, nearest = 0;
+        for (int i = 0; i < 8; i++) {
+            vec3d p = {i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z};
+            vec3d c = Mat_MulVec(toClip, p);
+            if (c.z < 0 || c.w <= 0) return false;
+            float invW = 1.0f / c.w;
+            // Same mapping as the engine's toScreen
+            float sx = (1.0f - c.x * invW) * 0.5f * width, sy = (1.0f - c.y * invW) * 0.5f * height;
+            minX = std::min(minX, sx); maxX = std::max(maxX, sx);
+            minY = std::min(minY, sy); maxY = std::max(maxY, sy);
+            nearest = std::max(nearest, invW);
+        }
+        minX = std::max(minX, 0.0f); maxX = std::min(maxX, width - 1.0f);
+        minY = std::max(minY, 0.0f); maxY = std::min(maxY, height - 1.0f);
+        if (minX > maxX || minY > maxY) return false;   // Off screen, the frustum decides
+        int tx0 = (int)minX >> DepthBuffer::TILE_SHIFT, tx1 = (int)maxX >> DepthBuffer::TILE_SHIFT;
+        int ty0 = (int)minY >> DepthBuffer::TILE_SHIFT, ty1 = (int)maxY >> DepthBuffer::TILE_SHIFT;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            const float* row = &tileMin[(size_t)ty * tilesX];
+            for (int tx = tx0; tx <= tx1; tx++)
+                if (row[tx] <= nearest) return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,349 @@
+/*
+    point_cloud.h - Point Clouds in Spatial Chunks
+    Raw scanner points (a position and a color each, no connectivity) for
+    the engine's point path. Positions are x/y/z streams like a Mesh's, so
+    whole runs of points go through the math3d batch transforms.
+
+    PointCloud_BuildChunks() sorts the points along a Morton curve and cuts
+    the curve into chunks of POINT_CHUNK_SIZE neighbours, with a BVH over
+    the chunk bounds for frustum culling. Inside a chunk the points are
+    shuffled, so any prefix of a chunk is an even sample of all of it: a
+    distant chunk only draws as many points as its pixels can show.
+
+    Loaders: binary PLY (vertex x, y, z and optional red, green, blue) and
+    text .xyz / .pts (x y z [intensity] [r g b] per line). Like meshes,
+    z is negated on load to match the engine's left-handed space.
+*/
+
+#pragma once
+
+#include "bvh.h"
+#include "mapped_file.h"
+#include "mesh_loader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ============== Point Cloud ==============
+const uint32_t POINT_CHUNK_SIZE = 4096;     // Points per chunk (the last one may hold fewer)
+
+struct PointChunk {
+    uint32_t first, count;      // Point range
+    vec3d center;               // Bounding sphere, object space
+    float radius;
+};
+
+struct PointCloud {
+    std::vector<float> x, y, z;         // Positions (structure of arrays)
+    std::vector<uint32_t> colors;       // 0xAARRGGBB per point, or none: drawn in the fill color
+    std::vector<PointChunk> chunks;     // Filled by PointCloud_BuildChunks()
+    Bvh bvh;                            // Over the chunk bounds, one chunk per leaf
+
+    size_t Count() const { return x.size(); }
+    bool Empty() const { return x.empty(); }
+    bool HasColors() const { return !x.empty() && colors.size() == x.size(); }
+
+    void Clear() {
+        x.clear(); y.clear(); z.clear(); colors.clear();
+        chunks.clear(); bvh.Clear();
+    }
+
+    void Reserve(size_t n, bool withColors) {
+        x.reserve(n); y.reserve(n); z.reserve(n);
+        if (withColors) colors.reserve(n);
+    }
+
+    void Add(float px, float py, float pz) {
+        x.push_back(px); y.push_back(py); z.push_back(pz);
+    }
+
+    void Add(float px, float py, float pz, uint32_t argb) {
+        colors.push_back(argb);
+        Add(px, py, pz);
+    }
+
+    // Bytes held by the point and chunk stores (capacity, not just size)
+    size_t MemoryBytes() const {
+        return (x.capacity() + y.capacity() + z.capacity()) * sizeof(float) +
+               colors.capacity() * sizeof(uint32_t) + chunks.capacity() * sizeof(PointChunk) +
+               bvh.nodes.capacity() * sizeof(BvhNode);
+    }
+};
+
+// ============== Point Cloud Utilities ==============
+
+inline void PointCloud_Bounds(const PointCloud& cloud, vec3d& bmin, vec3d& bmax) {
+    bmin = {1e30f, 1e30f, 1e30f};
+    bmax = {-1e30f, -1e30f, -1e30f};
+    for (size_t i = 0; i < cloud.Count(); i++) {
+        bmin.x = std::fmin(bmin.x, cloud.x[i]); bmax.x = std::fmax(bmax.x, cloud.x[i]);
+        bmin.y = std::fmin(bmin.y, cloud.y[i]); bmax.y = std::fmax(bmax.y, cloud.y[i]);
+        bmin.z = std::fmin(bmin.z, cloud.z[i]); bmax.z = std::fmax(bmax.z, cloud.z[i]);
+    }
+}
+
+// Center on the origin and scale so the largest extent equals `size`.
+// Call before PointCloud_BuildChunks(), which bounds the positions.
+inline void PointCloud_Fit(PointCloud& cloud, float size) {
+    if (cloud.Empty()) return;
+    vec3d bmin, bmax;
+    PointCloud_Bounds(cloud, bmin, bmax);
+    vec3d c = Vec_Mul(Vec_Add(bmin, bmax), 0.5f);
+    float extent = std::fmax(bmax.x - bmin.x, std::fmax(bmax.y - bmin.y, bmax.z - bmin.z));
+    float s = extent > 0 ? size / extent : 1.0f;
+    for (size_t i = 0; i < cloud.Count(); i++) {
+        cloud.x[i] = (cloud.x[i] - c.x) * s;
+        cloud.y[i] = (cloud.y[i] - c.y) * s;
+        cloud.z[i] = (cloud.z[i] - c.z) * s;
+    }
+}
+
+// Low 10 bits of v moved to every third bit
+inline uint32_t Morton_Spread10(uint32_t v) {
+    v &= 0x3FF;
+    v = (v | v << 16) & 0x030000FF;
+    v = (v | v << 8) & 0x0300F00F;
+    v = (v | v << 4) & 0x030C30C3;
+    v = (v | v << 2) & 0x09249249;
+    return v;
+}
+
+// Reorder the points into chunks and build the chunk BVH. Points are
+// sorted by their 30-bit Morton code in the cloud's bounds (a counting
+// sort on the top 15 bits, then each of those cells on its own), so
+// consecutive points are close in space; then every chunk is shuffled.
+inline void PointCloud_BuildChunks(PointCloud& cloud) {
+    cloud.chunks.clear();
+    cloud.bvh.Clear();
+    size_t n = cloud.Count();
+    if (n == 0) return;
+
+    vec3d bmin, bmax;
+    PointCloud_Bounds(cloud, bmin, bmax);
+    float extent = std::fmax(bmax.x - bmin.x, std::fmax(bmax.y - bmin.y, bmax.z - bmin.z));
+    float scale = extent > 0 ? 1023.0f / extent : 0.0f;
+    std::vector<uint32_t> codes(n);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t qx = (uint32_t)((cloud.x[i] - bmin.x) * scale);
+        uint32_t qy = (uint32_t)((cloud.y[i] - bmin.y) * scale);
+        uint32_t qz = (uint32_t)((cloud.z[i] - bmin.z) * scale);
+        codes[i] = Morton_Spread10(qx) | Morton_Spread10(qy) << 1 | Morton_Spread10(qz) << 2;
+    }
+
+    const int CELL_SHIFT = 15;
+    std::vector<uint32_t> start(((size_t)1 << CELL_SHIFT) + 1, 0), order(n);
+    for (size_t i = 0; i < n; i++) start[(codes[i] >> CELL_SHIFT) + 1]++;
+    for (size_t c = 1; c < start.size(); c++) start[c] += start[c - 1];
+    std::vector<uint32_t> cursor(start.begin(), start.end() - 1);
+    for (size_t i = 0; i < n; i++) order[cursor[codes[i] >> CELL_SHIFT]++] = (uint32_t)i;
+    for (size_t c = 0; c + 1 < start.size(); c++) {
+        if (start[c + 1] - start[c] < 2) continue;
+        std::sort(order.begin() + start[c], order.begin() + start[c + 1], [&](uint32_t a, uint32_t b) {
+            return codes[a] != codes[b] ? codes[a] < codes[b] : a < b;
+        });
+    }
+    std::vector<uint32_t>().swap(codes);
+    std::vector<uint32_t>().swap(cursor);
+
+    // Shuffle each chunk (Fisher-Yates, seeded by the chunk for a repeatable layout)
+    size_t nChunks = (n + POINT_CHUNK_SIZE - 1) / POINT_CHUNK_SIZE;
+    for (size_t c = 0; c < nChunks; c++) {
+        size_t first = c * POINT_CHUNK_SIZE, count = std::min<size_t>(POINT_CHUNK_SIZE, n - first);
+        uint32_t state = (uint32_t)c * 2654435761u + 1;
+        for (size_t i = count - 1; i > 0; i--) {
+            state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+            std::swap(order[first + i], order[first + state % (i + 1)]);
+        }
+    }
+
+    auto gather = [&](auto& stream) {
+        if (stream.size() != n) return;
+        auto sorted = stream;
+        for (size_t i = 0; i < n; i++) sorted[i] = stream[order[i]];
+        stream.swap(sorted);
+    };
+    gather(cloud.x);
+    gather(cloud.y);
+    gather(cloud.z);
+    gather(cloud.colors);
+
+    std::vector<Aabb> boxes(nChunks);
+    cloud.chunks.resize(nChunks);
+    for (size_t c = 0; c < nChunks; c++) {
+        PointChunk& chunk = cloud.chunks[c];
+        chunk.first = (uint32_t)(c * POINT_CHUNK_SIZE);
+        chunk.count = (uint32_t)std::min<size_t>(POINT_CHUNK_SIZE, n - chunk.first);
+        for (uint32_t i = chunk.first; i < chunk.first + chunk.count; i++)
+            Aabb_Grow(boxes[c], vec3d{cloud.x[i], cloud.y[i], cloud.z[i]});
+        chunk.center = Aabb_Center(boxes[c]);
+        vec3d half = Vec_Sub(boxes[c].max, chunk.center);
+        chunk.radius = sqrtf(Vec_Dot(half, half));
+    }
+    cloud.bvh.Build(boxes, 1);
+}
+
+// n points sampled from a rolling terrain patch, 4 x 4 units, with a
+// little range noise and colored by height, roughly what an aerial scan
+// returns. Stands in for a scan in benchmarks.
+inline void PointCloud_CreateScan(PointCloud& cloud, size_t n) {
+    cloud.Clear();
+    cloud.Reserve(n, true);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    auto next = [&] {       // splitmix64, as a float in [0, 1)
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return (float)((z ^ (z >> 31)) >> 40) / (float)(1 << 24);
+    };
+    for (size_t i = 0; i < n; i++) {
+        float u = next() * 4.0f - 2.0f, v = next() * 4.0f - 2.0f;
+        float h = 0.25f * sinf(2.5f * u) * cosf(1.7f * v) + 0.08f * sinf(7.0f * u + 4.0f * v);
+        h += (next() - 0.5f) * 0.004f;
+        float t = std::min(1.0f, std::max(0.0f, (h + 0.33f) / 0.66f));     // 0 = lowest, 1 = highest
+        uint32_t r = (uint32_t)(60 + 160 * t), g = (uint32_t)(140 - 40 * t + 100 * t * t), b = (uint32_t)(60 + 150 * t * t);
+        cloud.Add(u, h, v, 0xFF000000u | r << 16 | g << 8 | b);
+    }
+}
+
+// ============== Point Cloud Loading ==============
+
+// Binary PLY: the vertex element's x, y, z and, if present, red, green,
+// blue (8-bit, 16-bit or float 0..1). Elements after it are ignored.
+inline bool PointCloud_ParsePLY(const char* data, size_t size, PointCloud& cloud, std::string& error) {
+    using namespace meshio;
+    PlyHeader header;
+    if (!ParsePlyHeader(data, size, header, error)) return false;
+    bool swap = header.little != IsLittleEndianHost();
+    const unsigned char* b = (const unsigned char*)header.body;
+    const unsigned char* bend = (const unsigned char*)data + size;
+
+    for (int e = 0; e < header.nElems; e++) {
+        const PlyElement& el = header.elems[e];
+        int stride = 0, offs[6] = {-1, -1, -1, -1, -1, -1};
+        PlyType types[6] = {PLY_NONE, PLY_NONE, PLY_NONE, PLY_NONE, PLY_NONE, PLY_NONE};
+        static const char* const names[6][3] = {
+            {"x", "x", "x"}, {"y", "y", "y"}, {"z", "z", "z"},
+            {"red", "r", "diffuse_red"}, {"green", "g", "diffuse_green"}, {"blue", "b", "diffuse_blue"}};
+        bool fixed = true;
+        for (int i = 0; i < el.nProps; i++) {
+            const PlyProperty& pr = el.props[i];
+            if (pr.countType != PLY_NONE) { fixed = false; break; }
+            for (int k = 0; k < 6; k++)
+                for (const char* name : names[k])
+                    if (offs[k] < 0 && strcmp(pr.name, name) == 0) { offs[k] = stride; types[k] = pr.type; }
+            stride += PlyTypeSize(pr.type);
+        }
+        if (strcmp(el.name, "vertex") != 0) {
+            if (!fixed) { error = "PLY: elements with lists must come after the vertices"; return false; }
+            if ((size_t)(bend - b) < el.count * (size_t)stride) { error = "PLY: truncated file"; return false; }
+            b += el.count * (size_t)stride;
+            continue;
+        }
+        if (!fixed || offs[0] < 0 || offs[1] < 0 || offs[2] < 0) {
+            error = "PLY: vertex element needs fixed-size x, y, z";
+            return false;
+        }
+        if ((size_t)(bend - b) < el.count * (size_t)stride) { error = "PLY: truncated file"; return false; }
+
+        bool fastF32 = !swap && types[0] == PLY_F32 && types[1] == PLY_F32 && types[2] == PLY_F32;
+        bool hasColors = offs[3] >= 0 && offs[4] >= 0 && offs[5] >= 0;
+        auto channel = [&](const unsigned char* rec, int k) {
+            if (types[k] == PLY_U8) return (uint32_t)rec[offs[k]];
+            double v = PlyRead(rec + offs[k], types[k], swap);
+            if (types[k] == PLY_F32 || types[k] == PLY_F64) v *= 255.0;
+            else if (types[k] == PLY_U16 || types[k] == PLY_I16) v /= 257.0;
+            return (uint32_t)std::min(255.0, std::max(0.0, v));
+        };
+        cloud.Clear();
+        cloud.Reserve(el.count, hasColors);
+        for (size_t i = 0; i < el.count; i++, b += stride) {
+            float v[3];
+            if (fastF32) for (int k = 0; k < 3; k++) memcpy(&v[k], b + offs[k], 4);
+            else for (int k = 0; k < 3; k++) v[k] = (float)PlyRead(b + offs[k], types[k], swap);
+            if (hasColors) cloud.Add(v[0], v[1], -v[2], 0xFF000000u | channel(b, 3) << 16 | channel(b, 4) << 8 | channel(b, 5));
+            else cloud.Add(v[0], v[1], -v[2]);
+        }
+        return true;
+    }
+    error = "PLY: no vertex element";
+    return false;
+}
+
+// Text, one point per line: "x y z", "x y z r g b" or "x y z intensity r g b"
+// (.pts), separated by spaces or commas. Lines with fewer than three
+// numbers (the count line of .pts, comments) are skipped. Whether points
+// have colors is decided by the first point; later ones without get white.
+inline bool PointCloud_ParseXYZ(const char* data, size_t size, PointCloud& cloud, std::string& error) {
+    using namespace meshio;
+    const char* end = data + size;
+    size_t lines = 0;
+    for (const char* p = data; p < end; p = SkipLine(p, end)) lines++;
+    cloud.Clear();
+
+    int colorFirst = -1;        // Column of red, -1: no colors; decided by the first point
+    bool first = true;
+    for (const char* p = data; p < end; p = SkipLine(p, end)) {
+        float v[7];
+        int k = 0;
+        while (k < 7) {
+            while (p < end && (IsSpace(*p) || *p == ',')) p++;
+            const char* q = ParseFloat(p, end, v[k]);
+            if (q == p || (q == p + 1 && (*p == '-' || *p == '+'))) break;
+            p = q;
+            k++;
+        }
+        if (k < 3) continue;
+        if (first) {
+            colorFirst = k >= 7 ? 4 : k >= 6 ? 3 : -1;
+            cloud.Reserve(lines, colorFirst >= 0);
+            first = false;
+        }
+        if (colorFirst < 0) {
+            cloud.Add(v[0], v[1], -v[2]);
+            continue;
+        }
+        uint32_t argb = 0xFFFFFFFFu;
+        if (k >= colorFirst + 3) {
+            auto channel = [&](int i) { return (uint32_t)std::min(255.0f, std::max(0.0f, v[colorFirst + i])); };
+            argb = 0xFF000000u | channel(0) << 16 | channel(1) << 8 | channel(2);
+        }
+        cloud.Add(v[0], v[1], -v[2], argb);
+    }
+    if (cloud.Empty()) { error = "no points found"; return false; }
+    return true;
+}
+
+// Picks the parser from the file extension (.ply / .xyz / .pts). The
+// points come back in file order; fit them and build the chunks next.
+inline bool PointCloud_Load(const char* path, PointCloud& cloud, MeshLoadStats& stats) {
+    auto t0 = std::chrono::steady_clock::now();
+    stats = MeshLoadStats();
+
+    MappedFile file;
+    if (!file.Open(path)) { stats.error = std::string("cannot open ") + path; return false; }
+    stats.fileBytes = file.Size();
+
+    const char* ext = strrchr(path, '.');
+    auto extIs = [&](const char* e) {
+        if (!ext) return false;
+        for (size_t i = 0; ; i++) {
+            char a = (char)tolower((unsigned char)ext[i]);
+            if (a != e[i]) return false;
+            if (!a) return true;
+        }
+    };
+
+    bool ok;
+    if (extIs(".ply")) { stats.format = "PLY"; ok = PointCloud_ParsePLY(file.Data(), file.Size(), cloud, stats.error); }
+    else if (extIs(".xyz") || extIs(".pts")) { stats.format = "XYZ"; ok = PointCloud_ParseXYZ(file.Data(), file.Size(), cloud, stats.error); }
+    else { stats.error = "unsupported file type (expected .ply, .xyz or .pts)"; return false; }
+    if (!ok) return false;
+
+    stats.vertexCount = cloud.Count();
+    stats.memoryBytes = cloud.MemoryBytes();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return true;
+}
@@ -0,0 +1,196 @@
+/*
+    point_splat.h - Point Splatting with Atomic Depth+Color
+    Points are drawn one pixel each, from any number of threads at once,
+    into a buffer of 64-bit cells holding the depth in the high half and
+    the color in the low half. A point takes its pixel with an atomic
+    minimum on the whole cell, so the depth test and the color write are
+    one operation and threads never lock or wait for each other.
+    Splat_Resolve() copies the winners into a Framebuffer.
+
+    The depth is the view distance w. Positive floats order like their bit
+    patterns, so comparing cells compares depths first; among points at
+    the same depth the smaller color wins. The image therefore does not
+    depend on the thread count or the order points arrive in.
+
+    Projection runs in batches: Mat_MulVecBatch() takes the points to clip
+    space times the viewport, then Splat_ProjectBatch() divides by w and
+    turns each point into a pixel index, both on the active SIMD level.
+*/
+
+#pragma once
+
+#include "../math3d/math3d.h"
+#include "framebuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// ============== Splat Buffer ==============
+const uint64_t SPLAT_EMPTY = ~0ull;         // Farther than any point
+
+inline uint64_t Splat_Pack(uint32_t depthBits, uint32_t argb) {
+    return (uint64_t)depthBits << 32 | argb;
+}
+
+struct SplatBuffer {
+    int width = 0, height = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> cells;     // Row-major, SPLAT_EMPTY where nothing was drawn
+
+    // Empty buffer of the given size; keeps the cells if the size is unchanged
+    void Resize(int w, int h) {
+        if (w == width && h == height) return;
+        width = w; height = h;
+        size_t n = (size_t)w * h;
+        cells.reset(new std::atomic<uint64_t>[n]);
+        for (size_t i = 0; i < n; i++) cells[i].store(SPLAT_EMPTY, std::memory_order_relaxed);
+    }
+
+    // Keep the nearer of the cell and `key`; safe from any thread
+    void Splat(uint32_t pixel, uint64_t key) {
+        std::atomic<uint64_t>& cell = cells[pixel];
+        uint64_t old = cell.load(std::memory_order_relaxed);
+        while (key < old && !cell.compare_exchange_weak(old, key, std::memory_order_relaxed)) {}
+    }
+};
+
+// Rows [y0, y1) into fb's colors, leaving those cells empty for the next
+// frame. Pixels nothing was drawn to keep their color. Call once all
+// splatting finished; returns the pixels covered.
+inline size_t Splat_Resolve(SplatBuffer& buffer, Framebuffer& fb, int y0, int y1) {
+    size_t covered = 0;
+    for (int y = y0; y < y1; y++) {
+        std::atomic<uint64_t>* cells = &buffer.cells[(size_t)y * buffer.width];
+        uint32_t* row = fb.Row(y);
+        for (int x = 0; x < buffer.width; x++) {
+            uint64_t v = cells[x].load(std::memory_order_relaxed);
+            if (v == SPLAT_EMPTY) continue;
+            row[x] = (uint32_t)v;
+            cells[x].store(SPLAT_EMPTY, std::memory_order_relaxed);
+            covered++;
+        }
+    }
+    return covered;
+}
+
+// ============== Projection ==============
+
+// Clip space -> pixels as the triangle path maps it (x and y flipped, w
+// kept): (x, y, z, w) becomes (sx * w, sy * w, z, w)
+inline mat4x4 Splat_ViewportMatrix(int width, int height) {
+    mat4x4 m;
+    m.m[0][0] = -0.5f * width;  m.m[3][0] = 0.5f * width;
+    m.m[1][1] = -0.5f * height; m.m[3][1] = 0.5f * height;
+    m.m[2][2] = 1;
+    m.m[3][3] = 1;
+    return m;
+}
+
+// From the output of Mat_MulVecBatch(clip × viewport): the pixel of every
+// point, or -1 if it lies off screen or outside near/far (0 <= z <= w),
+// and the bits of its depth w. All levels give identical results.
+inline void Splat_ProjectBatch_Scalar(const float* X, const float* Y, const float* Z, const float* W,
+                                      int width, int height, int32_t* pixel, uint32_t* depth, size_t n) {
+    float fw = (float)width, fh = (float)height;
+    for (size_t i = 0; i < n; i++) {
+        float w = W[i], inv = 1.0f / w;
+        float fx = X[i] * inv, fy = Y[i] * inv;
+        bool inside = Z[i] >= 0 && Z[i] <= w && fx >= 0 && fx < fw && fy >= 0 && fy < fh;
+        pixel[i] = inside ? (int32_t)fy * width + (int32_t)fx : -1;
+        memcpy(&depth[i], &w, 4);
+    }
+}
+
+#if defined(MATH3D_SSE2)
+inline void Splat_ProjectBatch_SSE2(const float* X, const float* Y, const float* Z, const float* W,
+                                    int width, int height, int32_t* pixel, uint32_t* depth, size_t n) {
+    __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    __m128 fw = _mm_set1_ps((float)width), fh = _mm_set1_ps((float)height);
+    __m128i stride = _mm_set1_epi32(width), none = _mm_set1_epi32(-1);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 w = _mm_loadu_ps(W + i), z = _mm_loadu_ps(Z + i), inv = _mm_div_ps(one, w);
+        __m128 fx = _mm_mul_ps(_mm_loadu_ps(X + i), inv), fy = _mm_mul_ps(_mm_loadu_ps(Y + i), inv);
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(z, zero), _mm_cmple_ps(z, w)),
+                                   _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(fx, zero), _mm_cmplt_ps(fx, fw)),
+                                              _mm_and_ps(_mm_cmpge_ps(fy, zero), _mm_cmplt_ps(fy, fh))));
+        // 32-bit row * width without SSE4.1: even and odd lanes through 64-bit products
+        __m128i iy = _mm_cvttps_epi32(fy);
+        __m128i even = _mm_mul_epu32(iy, stride);
+        __m128i odd = _mm_mul_epu32(_mm_srli_si128(iy, 4), stride);
+        __m128i row = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                         _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+        __m128i index = _mm_add_epi32(row, _mm_cvttps_epi32(fx));
+        __m128i mask = _mm_castps_si128(inside);
+        _mm_storeu_si128((__m128i*)(pixel + i), _mm_or_si128(_mm_and_si128(mask, index), _mm_andnot_si128(mask, none)));
+        _mm_storeu_si128((__m128i*)(depth + i), _mm_castps_si128(w));
+    }
+    Splat_ProjectBatch_Scalar(X + i, Y + i, Z + i, W + i, width, height, pixel + i, depth + i, n - i);
+}
+#endif
+
+#if defined(MATH3D_X86)
+MATH3D_TARGET_AVX2
+inline void Splat_ProjectBatch_AVX2(const float* X, const float* Y, const float* Z, const float* W,
+                                    int width, int height, int32_t* pixel, uint32_t* depth, size_t n) {
+    __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    __m256 fw = _mm256_set1_ps((float)width), fh = _mm256_set1_ps((float)height);
+    __m256i stride = _mm256_set1_epi32(width), none = _mm256_set1_epi32(-1);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 w = _mm256_loadu_ps(W + i), z = _mm256_loadu_ps(Z + i), inv = _mm256_div_ps(one, w);
+        __m256 fx = _mm256_mul_ps(_mm256_loadu_ps(X + i), inv), fy = _mm256_mul_ps(_mm256_loadu_ps(Y + i), inv);
+        __m256 inside = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(z, zero, _CMP_GE_OQ), _mm256_cmp_ps(z, w, _CMP_LE_OQ)),
+            _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(fx, zero, _CMP_GE_OQ), _mm256_cmp_ps(fx, fw, _CMP_LT_OQ)),
+                          _mm256_and_ps(_mm256_cmp_ps(fy, zero, _CMP_GE_OQ), _mm256_cmp_ps(fy, fh, _CMP_LT_OQ))));
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(fy), stride), _mm256_cvttps_epi32(fx));
+        _mm256_storeu_si256((__m256i*)(pixel + i), _mm256_blendv_epi8(none, index, _mm256_castps_si256(inside)));
+        _mm256_storeu_si256((__m256i*)(depth + i), _mm256_castps_si256(w));
+    }
+    Splat_ProjectBatch_Scalar(X + i, Y + i, Z + i, W + i, width, height, pixel + i, depth + i, n - i);
+}
+#endif
+
+inline void Splat_ProjectBatch(const float* X, const float* Y, const float* Z, const float* W,
+                               int width, int height, int32_t* pixel, uint32_t* depth, size_t n) {
+    switch (Math_SimdLevel()) {
+#if defined(MATH3D_X86)
+        case SIMD_AVX2: Splat_ProjectBatch_AVX2(X, Y, Z, W, width, height, pixel, depth, n); return;
+#endif
+#if defined(MATH3D_SSE2)
+        case SIMD_SSE2: Splat_ProjectBatch_SSE2(X, Y, Z, W, width, height, pixel, depth, n); return;
+#endif
+        default: Splat_ProjectBatch_Scalar(X, Y, Z, W, width, height, pixel, depth, n); return;
+    }
+}
+
+// ============== Splatting ==============
+const int SPLAT_BATCH = 1024;       // Points projected per batch
+
+// Per-thread scratch for one batch
+struct SplatScratch {
+    float x[SPLAT_BATCH], y[SPLAT_BATCH], z[SPLAT_BATCH], w[SPLAT_BATCH];
+    int32_t pixel[SPLAT_BATCH];
+    uint32_t depth[SPLAT_BATCH];
+};
+
+// Splat n points (colors may be null: all drawn in `fill`) through
+// `toScreen` = model-view-projection × Splat_ViewportMatrix(). Returns the
+// points that landed on screen.
+inline size_t Splat_Points(SplatBuffer& buffer, const mat4x4& toScreen, const float* x, const float* y,
+                           const float* z, const uint32_t* colors, uint32_t fill, size_t n, SplatScratch& s) {
+    size_t onScreen = 0;
+    for (size_t first = 0; first < n; first += SPLAT_BATCH) {
+        size_t count = std::min<size_t>(SPLAT_BATCH, n - first);
+        Mat_MulVecBatch(toScreen, x + first, y + first, z + first, s.x, s.y, s.z, s.w, count);
+        Splat_ProjectBatch(s.x, s.y, s.z, s.w, buffer.width, buffer.height, s.pixel, s.depth, count);
+        for (size_t i = 0; i < count; i++) {
+            if (s.pixel[i] < 0) continue;
+            buffer.Splat((uint32_t)s.pixel[i], Splat_Pack(s.depth[i], colors ? colors[first + i] : fill));
+            onScreen++;
+        }
+    }
+    return onScreen;
+}
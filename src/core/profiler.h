@@ -0,0 +1,220 @@
+/*
+    profiler.h - Scoped Frame Profiler
+    Named zones (scoped timers) and counters, summed per frame into a
+    rolling history for the control panel, plus capture of a number of
+    frames as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+
+    Instrument only through the macros:
+        PROFILE_SCOPE("Raster");        // times the enclosing scope
+        PROFILE_COUNT("Tris In", n);    // adds n to a counter for this frame
+        PROFILE_FRAME_END();            // once per frame
+    Building with ENGINE_PROFILER=0 turns all of them into nothing.
+
+    Zones may run on several threads at once; their frame time is the sum
+    over threads (CPU time), the trace shows each thread separately.
+*/
+
+#pragma once
+
+#ifndef ENGINE_PROFILER
+#define ENGINE_PROFILER 1
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+const int PROFILE_MAX_SERIES = 32;      // Per kind (zones, counters)
+const int PROFILE_HISTORY = 240;        // Frames kept for the graphs
+
+// ============== Profiler ==============
+class Profiler {
+public:
+    enum Kind { ZONE, COUNTER };
+
+    // One zone or counter: this frame's running sum and the finished frames
+    struct Series {
+        const char* name = nullptr;
+        std::atomic<int64_t> frameValue{0};     // Nanoseconds for zones
+        float history[PROFILE_HISTORY] = {};    // Milliseconds for zones
+    };
+
+    static int64_t Now() {
+        static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Small stable id for the calling thread (trace "tid")
+    static int ThreadIndex() {
+        static std::atomic<int> next{0};
+        thread_local int index = next++;
+        return index;
+    }
+
+    // Returns the id for a name, registering it on first use (-1 when full)
+    int Register(Kind kind, const char* name) {
+        std::lock_guard<std::mutex> lock(registerMutex);
+        Series* table = kind == ZONE ? zones : counters;
+        std::atomic<int>& count = kind == ZONE ? zoneCount : counterCount;
+        int n = count.load(std::memory_order_relaxed);
+        for (int i = 0; i < n; i++)
+            if (!strcmp(table[i].name, name)) return i;
+        if (n == PROFILE_MAX_SERIES) return -1;
+        table[n].name = name;
+        count.store(n + 1, std::memory_order_release);     // Publishes the name
+        return n;
+    }
+
+    void AddZone(int id, int64_t start, int64_t duration) {
+        if (id < 0) return;
+        zones[id].frameValue.fetch_add(duration, std::memory_order_relaxed);
+        if (capturing.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(traceMutex);
+            trace.push_back({id, ThreadIndex(), start, duration});
+        }
+    }
+
+    void AddCounter(int id, int64_t value) {
+        if (id >= 0) counters[id].frameValue.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Close the frame: move the sums into the history, feed a running capture
+    void EndFrame() {
+        int64_t now = Now();
+        if (lastFrameEnd) frameMs[cursor] = (now - lastFrameEnd) * 1e-6f;
+        lastFrameEnd = now;
+
+        // Series registered by another thread after this point wait for the next frame
+        int nZones = ZoneCount(), nCounters = CounterCount();
+        for (int i = 0; i < nZones; i++)
+            zones[i].history[cursor] = zones[i].frameValue.exchange(0) * 1e-6f;
+        for (int i = 0; i < nCounters; i++)
+            counters[i].history[cursor] = (float)counters[i].frameValue.exchange(0);
+
+        if (capturing) {
+            std::lock_guard<std::mutex> lock(traceMutex);
+            for (int i = 0; i < nCounters; i++)
+                traceCounters.push_back({i, now, counters[i].history[cursor]});
+            if (--traceFramesLeft == 0) FinishTrace();
+        }
+
+        cursor = (cursor + 1) % PROFILE_HISTORY;
+        if (filled < PROFILE_HISTORY) filled++;
+    }
+
+    // Record the next `frames` frames and write them to `path` when done
+    void StartTrace(int frames, const std::string& path) {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        trace.clear();
+        traceCounters.clear();
+        tracePath = path;
+        traceFramesLeft = std::max(frames, 1);
+        traceStatus = "Capturing...";
+        capturing = true;
+    }
+
+    bool Capturing() const { return capturing; }
+    const std::string& TraceStatus() const { return traceStatus; }
+
+    int ZoneCount() const { return zoneCount.load(std::memory_order_acquire); }
+    int CounterCount() const { return counterCount.load(std::memory_order_acquire); }
+    const Series& Zone(int i) const { return zones[i]; }
+    const Series& Counter(int i) const { return counters[i]; }
+    const float* FrameHistory() const { return frameMs; }
+
+    // History is a ring: Offset() is the oldest entry, for ImGui::PlotLines
+    int HistorySize() const { return PROFILE_HISTORY; }
+    int Offset() const { return cursor; }
+    int Filled() const { return filled; }
+
+    // Mean over the recorded frames
+    float Average(const float* history) const {
+        if (!filled) return 0;
+        float sum = 0;
+        for (int i = 0; i < filled; i++) sum += history[(cursor - 1 - i + PROFILE_HISTORY) % PROFILE_HISTORY];
+        return sum / filled;
+    }
+
+private:
+    struct TraceEvent { int zone, thread; int64_t start, duration; };
+    struct TraceCounter { int counter; int64_t time; float value; };
+
+    std::mutex registerMutex;
+    Series zones[PROFILE_MAX_SERIES];
+    Series counters[PROFILE_MAX_SERIES];
+    std::atomic<int> zoneCount{0}, counterCount{0};     // Written under registerMutex
+    float frameMs[PROFILE_HISTORY] = {};
+    int64_t lastFrameEnd = 0;
+    int cursor = 0, filled = 0;
+
+    std::atomic<bool> capturing{false};
+    std::mutex traceMutex;
+    std::vector<TraceEvent> trace;
+    std::vector<TraceCounter> traceCounters;
+    std::string tracePath, traceStatus;
+    int traceFramesLeft = 0;
+
+    // Chrome trace event format, timestamps in microseconds
+    void FinishTrace() {
+        capturing = false;
+        FILE* f = fopen(tracePath.c_str(), "w");
+        if (!f) {
+            traceStatus = "Cannot write " + tracePath;
+            return;
+        }
+        int threads = 0;
+        fprintf(f, "{\"traceEvents\":[\n");
+        for (const TraceEvent& e : trace) {
+            fprintf(f, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f},\n",
+                    zones[e.zone].name, e.thread, e.start * 1e-3, e.duration * 1e-3);
+            threads = std::max(threads, e.thread + 1);
+        }
+        for (const TraceCounter& c : traceCounters)
+            fprintf(f, "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%.0f}},\n",
+                    counters[c.counter].name, c.time * 1e-3, c.value);
+        for (int t = 0; t < threads; t++)
+            fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}},\n", t, t);
+        fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"3D_Matrix\"}}\n]}\n");
+        fclose(f);
+        traceStatus = "Wrote " + std::to_string(trace.size()) + " events to " + tracePath;
+        trace.clear();
+        traceCounters.clear();
+    }
+};
+
+inline Profiler& Profiler_Get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+// ============== Instrumentation ==============
+struct ProfileScope {
+    int id;
+    int64_t start;
+    explicit ProfileScope(int zone) : id(zone), start(Profiler::Now()) {}
+    ~ProfileScope() { Profiler_Get().AddZone(id, start, Profiler::Now() - start); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if ENGINE_PROFILER
+#define PROFILE_SCOPE(name) \
+    static const int PROFILE_CONCAT(profileZone_, __LINE__) = Profiler_Get().Register(Profiler::ZONE, name); \
+    ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(PROFILE_CONCAT(profileZone_, __LINE__))
+#define PROFILE_COUNT(name, value) do { \
+        static const int profileCounter_ = Profiler_Get().Register(Profiler::COUNTER, name); \
+        Profiler_Get().AddCounter(profileCounter_, (int64_t)(value)); \
+    } while (0)
+#define PROFILE_FRAME_END() Profiler_Get().EndFrame()
+#else
+#define PROFILE_SCOPE(name) do {} while (0)
+#define PROFILE_COUNT(name, value) do {} while (0)
+#define PROFILE_FRAME_END() do {} while (0)
+#endif
@@ -0,0 +1,492 @@
+/*
+    rasterizer.h - Edge-function Triangle and Line Rasterization
+    Writes color and 1/w depth into a Framebuffer.
+
+    Vertices are screen-space vec3d with w holding 1/w of the clip-space
+    vertex. 1/w is affine in screen space, so interpolating it linearly
+    across the triangle is perspective-correct. Textured triangles
+    interpolate u/w and v/w the same way and divide by 1/w per pixel.
+
+    Every function takes a scissor rectangle and produces exactly the same
+    pixels inside it no matter how the screen is split, so tiles can be
+    rasterized independently and in parallel.
+*/
+
+#pragma once
+
+#include "framebuffer.h"
+#include "texture.h"
+#include "../math3d/math3d.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// ============== Scissor Rectangle ==============
+struct RasterRect {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;    // [x0, x1) × [y0, y1)
+};
+
+inline RasterRect Raster_FullRect(const Framebuffer& fb) {
+    RasterRect r; r.x1 = fb.width; r.y1 = fb.height;
+    return r;
+}
+
+// ============== Triangle ==============
+//
+// Half-space (edge function) rasterizer. Vertices are snapped to a
+// 1/16-pixel fixed-point grid and pixel centers are tested exactly with
+// integer edge functions under the top-left fill rule, so triangles that
+// share an edge never both draw a pixel on it and never leave a gap.
+//
+// The bounding box is walked in 8x8 blocks that line up with the depth
+// buffer's hierarchical-Z tiles. Per block, the corners decide whether each
+// edge rejects, fully accepts or partially covers it; the tile's min/max
+// depth decides whether the block is hidden or entirely in front. Only
+// partially covered edges are evaluated per pixel, 4 pixels at a time.
+
+const int RASTER_SUBPIXEL_BITS = 4;
+const int RASTER_SUBPIXEL = 1 << RASTER_SUBPIXEL_BITS;
+const int RASTER_BLOCK = DepthBuffer::TILE_SIZE;
+
+// Texture coordinates of a triangle's corners, in vertex order
+struct RasterUV {
+    float u[3], v[3];
+};
+
+// Triangle setup shared by the block loops
+struct RasterSetup {
+    int64_t e0[3];      // Edge value at the center of pixel (0, 0), fill-rule bias applied
+    int64_t a[3], b[3]; // Edge step per pixel in x and in y
+    float zx, zy0, zdy; // 1/w at pixel (x, y) = (zy0 + zdy * (y + 0.5)) + zx * x
+    float triNear, triFar;
+    uint32_t argb;      // Fill color, or the color textures are modulated with
+    bool depthTest;
+
+    // Textured: u/w and v/w in level-0 texels, planes like 1/w
+    const Texture* texture;     // nullptr: flat fill with argb
+    float ux, uy0, udy, vx, vy0, vdy;
+    int level;                  // Mip level of the block being drawn
+};
+
+inline float Raster_RowDepth(const RasterSetup& s, int y) {
+    return s.zy0 + s.zdy * (y + 0.5f);
+}
+
+// ============== Texturing ==============
+// Texels are point-sampled from one mip level per 8x8 block, chosen from
+// the UV derivatives at the block center (nearest level), and multiplied
+// channel by channel with the triangle's lit color. The SIMD paths set the
+// level up once per block and, with AVX2, sample a whole block row with
+// one divide and one gather; all paths give the same texels.
+
+// Channel-wise product of two 0xAARRGGBB colors, 255 * c = c
+inline uint32_t Raster_Modulate(uint32_t texel, uint32_t tint) {
+    uint32_t c = 0;
+    for (int k = 0; k < 32; k += 8) {
+        uint32_t m = tint >> k & 255;
+        c |= ((texel >> k & 255) * (m + (m >> 7)) >> 8) << k;
+    }
+    return c;
+}
+
+// Modulated texel of pixel (x, y), whose 1/w is z
+inline uint32_t Raster_Texel(const RasterSetup& s, int x, int y, float z) {
+    const TextureLevel& l = s.texture->levels[s.level];
+    float k = l.scale / z;
+    float u = (s.uy0 + s.udy * (y + 0.5f) + s.ux * (float)x) * k;
+    float v = (s.vy0 + s.vdy * (y + 0.5f) + s.vx * (float)x) * k;
+    return Raster_Modulate(s.texture->Fetch(s.level, (int)floorf(u), (int)floorf(v)), s.argb);
+}
+
+// Nearest mip level for the block at (bx, by): the longer of the pixel's
+// x and y footprints in level-0 texels, rho, gives level round(log2(rho))
+inline int Raster_BlockLevel(const RasterSetup& s, int bx, int by) {
+    float x = (float)(bx + RASTER_BLOCK / 2);
+    int y = by + RASTER_BLOCK / 2;
+    // The center may lie outside the triangle: keep 1/w within its range
+    float z = std::min(std::max(Raster_RowDepth(s, y) + s.zx * x, s.triFar), s.triNear);
+    float rz = 1.0f / z;
+    float u = (s.uy0 + s.udy * (y + 0.5f) + s.ux * x) * rz;
+    float v = (s.vy0 + s.vdy * (y + 0.5f) + s.vx * x) * rz;
+    float dudx = (s.ux - u * s.zx) * rz, dvdx = (s.vx - v * s.zx) * rz;
+    float dudy = (s.udy - u * s.zdy) * rz, dvdy = (s.vdy - v * s.zdy) * rz;
+    float rho2 = std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+    if (!(rho2 > 0.5f)) return 0;
+    // floor(log2(rho) + 0.5) = floor(log2(2 * rho^2) / 2), the exponent
+    // read from the bits (2 * rho^2 >= 1 is normal; infinity gives 128)
+    float r = 2.0f * rho2;
+    uint32_t bits;
+    memcpy(&bits, &r, 4);
+    return std::min((int)((bits >> 23) - 127) >> 1, s.texture->levelCount - 1);
+}
+
+// Any block: pixel by pixel, limited to the scissor rectangle. Returns pixels written.
+inline int Raster_BlockScalar(Framebuffer& fb, const RasterSetup& s, int bx, int by,
+                               const RasterRect& clip, bool depthAccept) {
+    DepthBuffer& db = fb.depth;
+    int x0 = std::max(bx, clip.x0), x1 = std::min(bx + RASTER_BLOCK, clip.x1);
+    int y0 = std::max(by, clip.y0), y1 = std::min(by + RASTER_BLOCK, clip.y1);
+    float written = 0;
+    int pixels = 0;
+    for (int y = y0; y < y1; y++) {
+        uint32_t* cRow = fb.Row(y);
+        float* zRow = db.Row(y);
+        float zy = Raster_RowDepth(s, y);
+        for (int x = x0; x < x1; x++) {
+            bool inside = true;
+            for (int k = 0; k < 3; k++)
+                if (s.e0[k] + s.a[k] * x + s.b[k] * y < 0) { inside = false; break; }
+            if (!inside) continue;
+            float z = zy + s.zx * (float)x;
+            if (!s.depthTest) { cRow[x] = s.texture ? Raster_Texel(s, x, y, z) : s.argb; pixels++; continue; }
+            if (depthAccept || z > zRow[x]) {
+                cRow[x] = s.texture ? Raster_Texel(s, x, y, z) : s.argb; zRow[x] = z;
+                written = std::max(written, z);
+                pixels++;
+            }
+        }
+    }
+    if (s.depthTest && written > 0) {
+        int tile = db.TileIndex(bx >> DepthBuffer::TILE_SHIFT, by >> DepthBuffer::TILE_SHIFT);
+        db.tileMax[tile] = std::max(db.tileMax[tile], written);
+        db.RefreshTileMin(bx >> DepthBuffer::TILE_SHIFT, by >> DepthBuffer::TILE_SHIFT);
+    }
+    return pixels;
+}
+
+#if defined(MATH3D_SSE2)
+inline __m128i Raster_FloorSSE2(__m128 f) {
+    __m128i i = _mm_cvttps_epi32(f);
+    return _mm_add_epi32(i, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i), f)));   // -1 where truncation rounded up
+}
+
+// One block's mip level, set up once so the pixel loop only reads registers
+struct RasterSamplerSSE2 {
+    const uint32_t* texels;     // First texel of the level
+    __m128 scale;               // TextureLevel::scale
+    __m128i uMask, vMask;       // width - 1, height - 1
+    __m128i tileRowShift;
+    __m128i tint;               // Modulation factors of argb as 16-bit lanes, two pixels' worth
+};
+
+inline RasterSamplerSSE2 Raster_SamplerSSE2(const RasterSetup& s) {
+    const TextureLevel& l = s.texture->levels[s.level];
+    RasterSamplerSSE2 t;
+    t.texels = s.texture->texels.data() + l.offset;
+    t.scale = _mm_set1_ps(l.scale);
+    t.uMask = _mm_set1_epi32(l.width - 1);
+    t.vMask = _mm_set1_epi32(l.height - 1);
+    t.tileRowShift = _mm_cvtsi32_si128(l.tileRowShift);
+    int m[4];
+    for (int k = 0; k < 4; k++) {
+        int c = s.argb >> (8 * k) & 255;
+        m[k] = c + (c >> 7);
+    }
+    t.tint = _mm_setr_epi16((short)m[0], (short)m[1], (short)m[2], (short)m[3],
+                            (short)m[0], (short)m[1], (short)m[2], (short)m[3]);
+    return t;
+}
+
+// Raster_Texel for 4 pixels with u/w uw, v/w vw and 1/w z
+inline __m128i Raster_TexelsSSE2(const RasterSamplerSSE2& t, __m128 uw, __m128 vw, __m128 z) {
+    __m128 k = _mm_div_ps(t.scale, z);
+    __m128i iu = _mm_and_si128(Raster_FloorSSE2(_mm_mul_ps(uw, k)), t.uMask);
+    __m128i iv = _mm_and_si128(Raster_FloorSSE2(_mm_mul_ps(vw, k)), t.vMask);
+
+    // Texture_TexelIndex, 4 at once. Both Morton spreads run together with
+    // u in the low and v in the high 16 bits: abc -> a0b0c
+    __m128i tile = _mm_add_epi32(_mm_sll_epi32(_mm_srli_epi32(iv, TEXTURE_TILE_SHIFT), t.tileRowShift),
+                                 _mm_srli_epi32(iu, TEXTURE_TILE_SHIFT));
+    __m128i m = _mm_and_si128(_mm_or_si128(iu, _mm_slli_epi32(iv, 16)), _mm_set1_epi32(0x00070007));
+    m = _mm_and_si128(_mm_or_si128(m, _mm_slli_epi32(m, 2)), _mm_set1_epi32(0x00130013));
+    m = _mm_and_si128(_mm_or_si128(m, _mm_slli_epi32(m, 1)), _mm_set1_epi32(0x00150015));
+    m = _mm_and_si128(_mm_or_si128(m, _mm_srli_epi32(m, 15)), _mm_set1_epi32(0x3F));
+    __m128i index = _mm_or_si128(_mm_slli_epi32(tile, 2 * TEXTURE_TILE_SHIFT), m);
+    alignas(16) uint32_t at[4];
+    _mm_store_si128((__m128i*)at, index);
+    __m128i texel = _mm_setr_epi32((int)t.texels[at[0]], (int)t.texels[at[1]], (int)t.texels[at[2]], (int)t.texels[at[3]]);
+
+    // Raster_Modulate: 8 bits x 9 bits fits the 16-bit lanes
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(texel, zero), t.tint), 8);
+    __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(texel, zero), t.tint), 8);
+    return _mm_packus_epi16(lo, hi);
+}
+
+MATH3D_TARGET_AVX2
+inline __m256i Raster_FloorAVX2(__m256 f) {
+    __m256i i = _mm256_cvttps_epi32(f);
+    return _mm256_add_epi32(i, _mm256_castps_si256(_mm256_cmp_ps(_mm256_cvtepi32_ps(i), f, _CMP_GT_OQ)));
+}
+
+// Textured colors of a whole block from (bx, by) with AVX2, written where
+// bit x of rowBits[y] is set: row by row, one divide and one gather per
+// row, the same operations per lane as Raster_TexelsSSE2 so the texels
+// are identical
+MATH3D_TARGET_AVX2
+inline void Raster_TexelBlockAVX2(Framebuffer& fb, const RasterSetup& s, const RasterSamplerSSE2& t,
+                                  int bx, int by, const uint8_t* rowBits) {
+    const __m256 x = _mm256_add_ps(_mm256_set1_ps((float)bx), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256 zx = _mm256_mul_ps(_mm256_set1_ps(s.zx), x);
+    const __m256 ux = _mm256_mul_ps(_mm256_set1_ps(s.ux), x), vx = _mm256_mul_ps(_mm256_set1_ps(s.vx), x);
+    const __m256 scale = _mm256_broadcastss_ps(t.scale);
+    const __m256i uMask = _mm256_broadcastd_epi32(t.uMask), vMask = _mm256_broadcastd_epi32(t.vMask);
+    const __m256i zero = _mm256_setzero_si256(), tint = _mm256_broadcastsi128_si256(t.tint);
+    const __m256i laneBit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+    for (int r = 0; r < RASTER_BLOCK; r++) {
+        if (!rowBits[r]) continue;
+        int y = by + r;
+        __m256 z = _mm256_add_ps(_mm256_set1_ps(Raster_RowDepth(s, y)), zx);
+        __m256 uw = _mm256_add_ps(_mm256_set1_ps(s.uy0 + s.udy * (y + 0.5f)), ux);
+        __m256 vw = _mm256_add_ps(_mm256_set1_ps(s.vy0 + s.vdy * (y + 0.5f)), vx);
+        __m256 k = _mm256_div_ps(scale, z);
+        __m256i iu = _mm256_and_si256(Raster_FloorAVX2(_mm256_mul_ps(uw, k)), uMask);
+        __m256i iv = _mm256_and_si256(Raster_FloorAVX2(_mm256_mul_ps(vw, k)), vMask);
+
+        __m256i tile = _mm256_add_epi32(_mm256_sll_epi32(_mm256_srli_epi32(iv, TEXTURE_TILE_SHIFT), t.tileRowShift),
+                                        _mm256_srli_epi32(iu, TEXTURE_TILE_SHIFT));
+        __m256i m = _mm256_and_si256(_mm256_or_si256(iu, _mm256_slli_epi32(iv, 16)), _mm256_set1_epi32(0x00070007));
+        m = _mm256_and_si256(_mm256_or_si256(m, _mm256_slli_epi32(m, 2)), _mm256_set1_epi32(0x00130013));
+        m = _mm256_and_si256(_mm256_or_si256(m, _mm256_slli_epi32(m, 1)), _mm256_set1_epi32(0x00150015));
+        m = _mm256_and_si256(_mm256_or_si256(m, _mm256_srli_epi32(m, 15)), _mm256_set1_epi32(0x3F));
+        __m256i index = _mm256_or_si256(_mm256_slli_epi32(tile, 2 * TEXTURE_TILE_SHIFT), m);
+        __m256i texel = _mm256_i32gather_epi32((const int*)t.texels, index, 4);
+
+        __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(texel, zero), tint), 8);
+        __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(texel, zero), tint), 8);
+        __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(rowBits[r]), laneBit), laneBit);
+        __m256i* cPtr = (__m256i*)(fb.Row(y) + bx);
+        _mm256_storeu_si256(cPtr, _mm256_blendv_epi8(_mm256_loadu_si256(cPtr), _mm256_packus_epi16(lo, hi), mask));
+    }
+}
+
+// Whole 8x8 block inside the scissor and the framebuffer: two 4-wide groups per row.
+// partial: bit k set if edge k crosses this block and must be tested per pixel.
+inline int Raster_BlockSSE2(Framebuffer& fb, const RasterSetup& s, int bx, int by,
+                             int partial, bool depthAccept) {
+    DepthBuffer& db = fb.depth;
+    const __m128i minusOne = _mm_set1_epi32(-1);
+    __m128i eLo[3], eHi[3], stepY[3];
+    int nEdges = 0;
+    for (int k = 0; k < 3; k++) {
+        if (!(partial & (1 << k))) continue;
+        // Values of a crossing edge stay within 8 * (|a| + |b|), so int32 is enough here
+        int32_t e = (int32_t)(s.e0[k] + s.a[k] * bx + s.b[k] * by);
+        int32_t ak = (int32_t)s.a[k];
+        eLo[nEdges] = _mm_setr_epi32(e, e + ak, e + 2 * ak, e + 3 * ak);
+        eHi[nEdges] = _mm_add_epi32(eLo[nEdges], _mm_set1_epi32(4 * ak));
+        stepY[nEdges] = _mm_set1_epi32((int32_t)s.b[k]);
+        nEdges++;
+    }
+
+    const __m128 zx = _mm_set1_ps(s.zx);
+    const __m128 xLo = _mm_setr_ps((float)bx, (float)(bx + 1), (float)(bx + 2), (float)(bx + 3));
+    const __m128 xHi = _mm_add_ps(xLo, _mm_set1_ps(4.0f));
+    const __m128i color = _mm_set1_epi32((int)s.argb);
+
+    // Textured: the x terms of u/w and v/w are the same in every row
+    const bool textured = s.texture != nullptr;
+    const bool avx2 = textured && Math_SimdLevel() == SIMD_AVX2;
+    RasterSamplerSSE2 sampler;
+    __m128 uxLo, uxHi, vxLo, vxHi;
+    if (textured) {
+        sampler = Raster_SamplerSSE2(s);
+        __m128 ux = _mm_set1_ps(s.ux), vx = _mm_set1_ps(s.vx);
+        uxLo = _mm_mul_ps(ux, xLo); uxHi = _mm_mul_ps(ux, xHi);
+        vxLo = _mm_mul_ps(vx, xLo); vxHi = _mm_mul_ps(vx, xHi);
+    }
+    uint8_t rowBits[RASTER_BLOCK] = {};
+    __m128 zMax = _mm_setzero_ps();
+    int pixels = 0;
+
+    for (int y = by; y < by + RASTER_BLOCK; y++) {
+        __m128i mLo = minusOne, mHi = minusOne;
+        for (int k = 0; k < nEdges; k++) {
+            mLo = _mm_and_si128(mLo, _mm_cmpgt_epi32(eLo[k], minusOne));
+            mHi = _mm_and_si128(mHi, _mm_cmpgt_epi32(eHi[k], minusOne));
+            eLo[k] = _mm_add_epi32(eLo[k], stepY[k]);
+            eHi[k] = _mm_add_epi32(eHi[k], stepY[k]);
+        }
+
+        __m128i* cPtr = (__m128i*)(fb.Row(y) + bx);
+        float* zPtr = db.Row(y) + bx;
+        __m128 zy = _mm_set1_ps(Raster_RowDepth(s, y));
+        __m128 zLo = _mm_add_ps(zy, _mm_mul_ps(zx, xLo));
+        __m128 zHi = _mm_add_ps(zy, _mm_mul_ps(zx, xHi));
+        if (s.depthTest) {
+            __m128 oldLo = _mm_loadu_ps(zPtr), oldHi = _mm_loadu_ps(zPtr + 4);
+            if (!depthAccept) {
+                mLo = _mm_and_si128(mLo, _mm_castps_si128(_mm_cmpgt_ps(zLo, oldLo)));
+                mHi = _mm_and_si128(mHi, _mm_castps_si128(_mm_cmpgt_ps(zHi, oldHi)));
+            }
+            __m128 fLo = _mm_castsi128_ps(mLo), fHi = _mm_castsi128_ps(mHi);
+            _mm_storeu_ps(zPtr, _mm_or_ps(_mm_and_ps(fLo, zLo), _mm_andnot_ps(fLo, oldLo)));
+            _mm_storeu_ps(zPtr + 4, _mm_or_ps(_mm_and_ps(fHi, zHi), _mm_andnot_ps(fHi, oldHi)));
+            zMax = _mm_max_ps(zMax, _mm_max_ps(_mm_and_ps(fLo, zLo), _mm_and_ps(fHi, zHi)));
+        }
+        int bits = _mm_movemask_ps(_mm_castsi128_ps(mLo)) | (_mm_movemask_ps(_mm_castsi128_ps(mHi)) << 4);
+        if (bits == 0) continue;
+        static const uint8_t nibbleBits[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+        pixels += nibbleBits[bits & 15] + nibbleBits[bits >> 4];
+        if (avx2) { rowBits[y - by] = (uint8_t)bits; continue; }     // Colored after the loop
+        __m128i colorLo = color, colorHi = color;
+        if (textured) {
+            __m128 uy = _mm_set1_ps(s.uy0 + s.udy * (y + 0.5f)), vy = _mm_set1_ps(s.vy0 + s.vdy * (y + 0.5f));
+            if (bits & 15) colorLo = Raster_TexelsSSE2(sampler, _mm_add_ps(uy, uxLo), _mm_add_ps(vy, vxLo), zLo);
+            if (bits >> 4) colorHi = Raster_TexelsSSE2(sampler, _mm_add_ps(uy, uxHi), _mm_add_ps(vy, vxHi), zHi);
+        }
+        __m128i cLo = _mm_loadu_si128(cPtr), cHi = _mm_loadu_si128(cPtr + 1);
+        _mm_storeu_si128(cPtr, _mm_or_si128(_mm_and_si128(mLo, colorLo), _mm_andnot_si128(mLo, cLo)));
+        _mm_storeu_si128(cPtr + 1, _mm_or_si128(_mm_and_si128(mHi, colorHi), _mm_andnot_si128(mHi, cHi)));
+    }
+
+    if (avx2 && pixels) Raster_TexelBlockAVX2(fb, s, sampler, bx, by, rowBits);
+    if (!s.depthTest || !pixels) return pixels;
+
+    // Update the hierarchical-Z bounds of this tile
+    float zm[4];
+    _mm_storeu_ps(zm, zMax);
+    int tx = bx >> DepthBuffer::TILE_SHIFT, ty = by >> DepthBuffer::TILE_SHIFT;
+    int tile = db.TileIndex(tx, ty);
+    db.tileMax[tile] = std::max(db.tileMax[tile], std::max(std::max(zm[0], zm[1]), std::max(zm[2], zm[3])));
+    __m128 zMin = _mm_set1_ps(3.4e38f);
+    for (int y = by; y < by + RASTER_BLOCK; y++) {
+        const float* zPtr = db.Row(y) + bx;
+        zMin = _mm_min_ps(zMin, _mm_min_ps(_mm_loadu_ps(zPtr), _mm_loadu_ps(zPtr + 4)));
+    }
+    _mm_storeu_ps(zm, zMin);
+    db.tileMin[tile] = std::min(std::min(zm[0], zm[1]), std::min(zm[2], zm[3]));
+    return pixels;
+}
+#endif
+
+// With depthTest off the depth buffer is neither read nor written. With a
+// texture, uv holds the corners' texture coordinates and argb modulates
+// the texels. Returns the number of pixels written (passed the depth test).
+inline int Raster_FillTriangle(Framebuffer& fb, const vec3d& a, const vec3d& b, const vec3d& c,
+                                uint32_t argb, const RasterRect& clip, bool depthTest,
+                                const Texture* texture = nullptr, const RasterUV* uv = nullptr) {
+    DepthBuffer& db = fb.depth;
+
+    // Snap to the subpixel grid, make the winding positive
+    const vec3d* v[3] = {&a, &b, &c};
+    int corner[3] = {0, 1, 2};
+    int64_t fx[3], fy[3];
+    for (int i = 0; i < 3; i++) {
+        fx[i] = (int64_t)lrintf(v[i]->x * RASTER_SUBPIXEL);
+        fy[i] = (int64_t)lrintf(v[i]->y * RASTER_SUBPIXEL);
+    }
+    int64_t area = (fx[1] - fx[0]) * (fy[2] - fy[0]) - (fy[1] - fy[0]) * (fx[2] - fx[0]);
+    if (area == 0) return 0;
+    if (area < 0) {
+        std::swap(fx[1], fx[2]); std::swap(fy[1], fy[2]); std::swap(v[1], v[2]); std::swap(corner[1], corner[2]);
+    }
+
+    int minX = std::max(clip.x0, (int)(std::min({fx[0], fx[1], fx[2]}) >> RASTER_SUBPIXEL_BITS));
+    int maxX = std::min(clip.x1 - 1, (int)(std::max({fx[0], fx[1], fx[2]}) >> RASTER_SUBPIXEL_BITS));
+    int minY = std::max(clip.y0, (int)(std::min({fy[0], fy[1], fy[2]}) >> RASTER_SUBPIXEL_BITS));
+    int maxY = std::min(clip.y1 - 1, (int)(std::max({fy[0], fy[1], fy[2]}) >> RASTER_SUBPIXEL_BITS));
+    if (minX > maxX || minY > maxY) return 0;
+
+    RasterSetup s;
+    s.argb = argb;
+    s.depthTest = depthTest;
+    const int64_t half = RASTER_SUBPIXEL / 2;
+    for (int k = 0; k < 3; k++) {
+        int i = k, j = (k + 1) % 3;
+        int64_t dx = fx[j] - fx[i], dy = fy[j] - fy[i];
+        // E(p) = dx * (p.y - y_i) - dy * (p.x - x_i), >= 0 inside
+        s.a[k] = -dy * RASTER_SUBPIXEL;
+        s.b[k] = dx * RASTER_SUBPIXEL;
+        s.e0[k] = dx * (half - fy[i]) - dy * (half - fx[i]);
+        // Top-left rule: pixels exactly on a right or bottom edge are left out
+        bool topLeft = (dy == 0 && dx > 0) || dy < 0;
+        if (!topLeft) s.e0[k] -= 1;
+    }
+
+    // Depth plane from the float positions (1/w is affine in screen space)
+    float e1x = v[1]->x - v[0]->x, e1y = v[1]->y - v[0]->y, e1z = v[1]->w - v[0]->w;
+    float e2x = v[2]->x - v[0]->x, e2y = v[2]->y - v[0]->y, e2z = v[2]->w - v[0]->w;
+    float det = e1x * e2y - e2x * e1y;
+    if (det == 0) return 0;
+    s.zx = (e1z * e2y - e2z * e1y) / det;
+    s.zdy = (e1x * e2z - e2x * e1z) / det;
+    s.zy0 = v[0]->w + s.zx * (0.5f - v[0]->x) - s.zdy * v[0]->y;
+    s.triNear = std::max({a.w, b.w, c.w});
+    s.triFar = std::min({a.w, b.w, c.w});
+
+    // Texture coordinate planes: u/w and v/w are affine in screen space too
+    s.texture = texture && texture->Valid() && uv ? texture : nullptr;
+    s.level = 0;
+    if (s.texture) {
+        float qu[3], qv[3];
+        for (int i = 0; i < 3; i++) {
+            qu[i] = uv->u[corner[i]] * s.texture->Width() * v[i]->w;
+            qv[i] = uv->v[corner[i]] * s.texture->Height() * v[i]->w;
+        }
+        auto plane = [&](const float q[3], float& px, float& py0, float& pdy) {
+            float e1q = q[1] - q[0], e2q = q[2] - q[0];
+            px = (e1q * e2y - e2q * e1y) / det;
+            pdy = (e1x * e2q - e2x * e1q) / det;
+            py0 = q[0] + px * (0.5f - v[0]->x) - pdy * v[0]->y;
+        };
+        plane(qu, s.ux, s.uy0, s.udy);
+        plane(qv, s.vx, s.vy0, s.vdy);
+    }
+
+    const int bmask = ~(RASTER_BLOCK - 1);
+    int pixels = 0;
+    for (int by = minY & bmask; by <= maxY; by += RASTER_BLOCK) {
+        for (int bx = minX & bmask; bx <= maxX; bx += RASTER_BLOCK) {
+            int tile = db.TileIndex(bx >> DepthBuffer::TILE_SHIFT, by >> DepthBuffer::TILE_SHIFT);
+            if (depthTest && s.triNear < db.tileMin[tile]) continue;    // Hidden by hierarchical Z
+
+            // Classify the block against each edge from its 4 corner pixels
+            int partial = 0;
+            bool reject = false;
+            for (int k = 0; k < 3 && !reject; k++) {
+                int64_t e = s.e0[k] + s.a[k] * bx + s.b[k] * by;
+                int64_t ea = s.a[k] * (RASTER_BLOCK - 1), eb = s.b[k] * (RASTER_BLOCK - 1);
+                int64_t lo = e + std::min<int64_t>(ea, 0) + std::min<int64_t>(eb, 0);
+                int64_t hi = e + std::max<int64_t>(ea, 0) + std::max<int64_t>(eb, 0);
+                if (hi < 0) reject = true;
+                else if (lo < 0) partial |= 1 << k;
+            }
+            if (reject) continue;
+
+            bool depthAccept = !depthTest || s.triFar > db.tileMax[tile];
+            if (s.texture) s.level = Raster_BlockLevel(s, bx, by);
+#if defined(MATH3D_SSE2)
+            bool inside = bx >= clip.x0 && by >= clip.y0 &&
+                          bx + RASTER_BLOCK <= clip.x1 && by + RASTER_BLOCK <= clip.y1;
+            if (inside) { pixels += Raster_BlockSSE2(fb, s, bx, by, partial, depthAccept); continue; }
+#endif
+            pixels += Raster_BlockScalar(fb, s, bx, by, clip, depthAccept);
+        }
+    }
+    return pixels;
+}
+
+// ============== Line ==============
+// Wireframe edges lie on their own triangle, so the depth test has a small
+// bias. The whole line is always walked so clipping does not shift pixels.
+inline void Raster_DrawLine(Framebuffer& fb, const vec3d& a, const vec3d& b, uint32_t argb,
+                            const RasterRect& clip, bool depthTest) {
+    int x1 = (int)a.x, y1 = (int)a.y, x2 = (int)b.x, y2 = (int)b.y;
+    int dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+    int dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+    int err = dx + dy;
+    int steps = std::max(dx, -dy);
+    float z = a.w, dz = steps > 0 ? (b.w - a.w) / steps : 0.0f;
+    while (true) {
+        if (x1 >= clip.x0 && x1 < clip.x1 && y1 >= clip.y0 && y1 < clip.y1) {
+            if (!depthTest || z * 1.01f >= fb.depth.Row(y1)[x1]) fb.Row(y1)[x1] = argb;
+        }
+        if (x1 == x2 && y1 == y2) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x1 += sx; }
+        if (e2 <= dx) { err += dx; y1 += sy; }
+        z += dz;
+    }
+}
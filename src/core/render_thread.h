@@ -0,0 +1,82 @@
+/*
+    render_thread.h - Pipelined Frame Worker
+    A single thread that renders one frame while the caller handles input
+    and UI for the next one and presents the previous one. Submit() hands
+    over a job and returns at once, Wait() blocks until it has finished.
+    Calls alternate (at most one job in flight), so everything the job
+    reads may only change between Wait() and the next Submit().
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// ============== Render Thread ==============
+class RenderThread {
+public:
+    RenderThread() = default;
+    ~RenderThread() { Stop(); }
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Run job on the worker (started on first use); the previous job must be done
+    void Submit(std::function<void()> job) {
+        if (!worker.joinable()) {
+            stopping = false;
+            worker = std::thread(&RenderThread::WorkerLoop, this);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = std::move(job);
+            busy = true;
+        }
+        wake.notify_all();
+    }
+
+    // Block until the submitted job (if any) has finished
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return !busy; });
+    }
+
+    void Stop() {
+        if (!worker.joinable()) return;
+        Wait();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+private:
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    std::function<void()> pending;
+    bool busy = false;
+    bool stopping = false;
+
+    void WorkerLoop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || pending; });
+                if (stopping) return;
+                job = std::move(pending);
+                pending = nullptr;
+            }
+            job();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy = false;
+            }
+            done.notify_all();
+        }
+    }
+};
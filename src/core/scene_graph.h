@@ -0,0 +1,128 @@
+/*
+    scene_graph.h - Transform Hierarchy with Dirty Flags
+    Nodes with a local transform, a cached world transform and a world
+    bounding sphere. SetLocal() only marks the node; Update() recomputes
+    the world matrices and bounds of the marked subtrees, so its cost
+    follows what changed, not the size of the scene.
+
+    Nodes live in parallel arrays and a parent always has a smaller index
+    than its children. Visiting the dirty nodes in index order therefore
+    reaches every ancestor before its descendants, and each changed
+    subtree is walked exactly once.
+*/
+
+#pragma once
+
+#include "../math3d/math3d.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// ============== Scene Graph ==============
+class SceneGraph {
+public:
+    enum { NONE = -1 };
+
+    size_t Count() const { return local.size(); }
+
+    void Clear() {
+        local.clear(); world.clear();
+        parent.clear(); firstChild.clear(); nextSibling.clear();
+        boundCenter.clear(); boundRadius.clear();
+        worldCenter.clear(); worldRadius.clear();
+        dirty.clear(); dirtyList.clear(); updated.clear();
+    }
+
+    void Reserve(size_t n) {
+        local.reserve(n); world.reserve(n);
+        parent.reserve(n); firstChild.reserve(n); nextSibling.reserve(n);
+        boundCenter.reserve(n); boundRadius.reserve(n);
+        worldCenter.reserve(n); worldRadius.reserve(n);
+        dirty.reserve(n); dirtyList.reserve(n);
+    }
+
+    // New node under `parentNode` (NONE for a root); world is valid after Update()
+    int AddNode(int parentNode, const mat4x3& localTransform) {
+        int node = (int)local.size();
+        local.push_back(localTransform);
+        world.push_back(localTransform);
+        parent.push_back(parentNode);
+        firstChild.push_back(NONE);
+        nextSibling.push_back(NONE);
+        if (parentNode != NONE) {
+            nextSibling[node] = firstChild[parentNode];
+            firstChild[parentNode] = node;
+        }
+        boundCenter.push_back(vec3d());
+        boundRadius.push_back(0);
+        worldCenter.push_back(vec3d());
+        worldRadius.push_back(0);
+        dirty.push_back(0);
+        MarkDirty(node);
+        return node;
+    }
+
+    void SetLocal(int node, const mat4x3& m) {
+        local[node] = m;
+        MarkDirty(node);
+    }
+
+    // Bounding sphere of the node's own content in its local space (radius 0: none)
+    void SetBounds(int node, const vec3d& center, float radius) {
+        boundCenter[node] = center;
+        boundRadius[node] = radius;
+        MarkDirty(node);
+    }
+
+    const mat4x3& Local(int node) const { return local[node]; }
+    const mat4x3& World(int node) const { return world[node]; }
+    int Parent(int node) const { return parent[node]; }
+    const vec3d& WorldCenter(int node) const { return worldCenter[node]; }
+    float WorldRadius(int node) const { return worldRadius[node]; }
+
+    // Bring world matrices and bounds up to date, returns the nodes recomputed
+    size_t Update() {
+        updated.clear();
+        if (dirtyList.empty()) return 0;
+        std::sort(dirtyList.begin(), dirtyList.end());
+        for (int root : dirtyList) {
+            if (!dirty[root]) continue;         // Already reached from a dirty ancestor
+            stack.push_back(root);
+            while (!stack.empty()) {
+                int n = stack.back();
+                stack.pop_back();
+                int p = parent[n];
+                world[n] = p == NONE ? local[n] : Aff_Mul(local[n], world[p]);
+                worldCenter[n] = Aff_MulVec(world[n], boundCenter[n]);
+                worldRadius[n] = boundRadius[n] * Aff_MaxScale(world[n]);
+                dirty[n] = 0;
+                updated.push_back(n);
+                for (int c = firstChild[n]; c != NONE; c = nextSibling[c]) stack.push_back(c);
+            }
+        }
+        dirtyList.clear();
+        return updated.size();
+    }
+
+    // Whether nodes were changed since the last Update()
+    bool Dirty() const { return !dirtyList.empty(); }
+
+    // Nodes whose world transform changed in the last Update()
+    const std::vector<int>& Updated() const { return updated; }
+
+private:
+    std::vector<mat4x3> local, world;
+    std::vector<int> parent, firstChild, nextSibling;
+    std::vector<vec3d> boundCenter, worldCenter;
+    std::vector<float> boundRadius, worldRadius;
+    std::vector<uint8_t> dirty;
+    std::vector<int> dirtyList;     // Marked since the last Update(), unordered
+    std::vector<int> updated;
+    std::vector<int> stack;
+
+    void MarkDirty(int node) {
+        if (dirty[node]) return;
+        dirty[node] = 1;
+        dirtyList.push_back(node);
+    }
+};
@@ -0,0 +1,186 @@
+/*
+    texture.h - Mipmapped Textures in Tiled Morton Order
+    0xAARRGGBB textures for the rasterizer, with power-of-two sizes and a
+    chain of box-filtered mip levels, built once, down to the level whose
+    shorter side is one texel.
+
+    Every level is stored in 8x8 texel tiles (256 bytes, four cache
+    lines), tile rows left to right, and in Morton (Z) order inside a
+    tile. Texels that are close on screen are close in memory in any
+    direction, so a triangle that walks the texture diagonally or
+    vertically touches about as many cache lines as one walking it
+    horizontally. With the level picked from the UV derivatives, a
+    minified texture is read from a level about as small as its screen
+    area instead of skipping through the full-size image.
+*/
+
+#pragma once
+
+#include "mapped_file.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const int TEXTURE_TILE_SHIFT = 3;                   // 8x8 texel tiles
+const int TEXTURE_MAX_LOG2 = 12;                    // 4096 texels per side at most
+const int TEXTURE_MAX_LEVELS = TEXTURE_MAX_LOG2 + 1;
+
+// ============== Texel Addressing ==============
+namespace texture {
+
+// Bits 0-2 of x spread to bits 0, 2, 4
+inline uint32_t Morton3(uint32_t x) {
+    return (x & 1) | (x & 2) << 1 | (x & 4) << 2;
+}
+
+inline int Log2(int n) {
+    int l = 0;
+    while ((1 << l) < n) l++;
+    return l;
+}
+
+} // namespace texture
+
+// Index of texel (x, y) inside a level whose rows have 2^tileRowShift tiles
+inline uint32_t Texture_TexelIndex(uint32_t x, uint32_t y, int tileRowShift) {
+    uint32_t tile = ((y >> TEXTURE_TILE_SHIFT) << tileRowShift) + (x >> TEXTURE_TILE_SHIFT);
+    return tile << (2 * TEXTURE_TILE_SHIFT) | texture::Morton3(x & 7) | texture::Morton3(y & 7) << 1;
+}
+
+// ============== Texture ==============
+struct TextureLevel {
+    int width = 0, height = 0;          // Powers of two
+    int tileRowShift = 0;               // log2 of the tiles per row
+    float scale = 1.0f;                 // Texels of this level per level-0 texel
+    size_t offset = 0;                  // First texel in Texture::texels
+};
+
+struct Texture {
+    std::vector<uint32_t> texels;       // All levels, each in tiles
+    TextureLevel levels[TEXTURE_MAX_LEVELS];
+    int levelCount = 0;
+
+    bool Valid() const { return levelCount > 0; }
+    int Width() const { return levels[0].width; }
+    int Height() const { return levels[0].height; }
+    size_t MemoryBytes() const { return texels.capacity() * sizeof(uint32_t); }
+
+    // Texel (x, y) of `level`; coordinates wrap around (repeat)
+    uint32_t Fetch(int level, int x, int y) const {
+        const TextureLevel& l = levels[level];
+        return texels[l.offset + Texture_TexelIndex(x & (l.width - 1), y & (l.height - 1), l.tileRowShift)];
+    }
+};
+
+// ============== Creation ==============
+// Texture from row-major 0xAARRGGBB pixels. Sizes that are not powers of
+// two (or are over the limit) are resampled to the nearest that is.
+inline void Texture_Create(Texture& tex, const uint32_t* pixels, int width, int height) {
+    using namespace texture;
+    tex = Texture();
+    if (width <= 0 || height <= 0) return;
+
+    auto pow2 = [](int n) {
+        int l = Log2(n);
+        if (l > 0 && (1 << l) - n > n - (1 << (l - 1))) l--;     // Nearer to the smaller one
+        return 1 << std::min(l, TEXTURE_MAX_LOG2);
+    };
+    int w = pow2(width), h = pow2(height);
+    std::vector<uint32_t> level((size_t)w * h), next;
+    for (int y = 0; y < h; y++) {
+        const uint32_t* row = pixels + (size_t)((int64_t)y * height / h) * width;
+        for (int x = 0; x < w; x++) level[(size_t)y * w + x] = row[(int64_t)x * width / w];
+    }
+
+    size_t total = 0;
+    for (int lw = w, lh = h; ; lw /= 2, lh /= 2) {
+        TextureLevel& l = tex.levels[tex.levelCount];
+        l.width = lw; l.height = lh;
+        l.tileRowShift = std::max(Log2(lw) - TEXTURE_TILE_SHIFT, 0);
+        l.scale = (float)lw / w;
+        l.offset = total;
+        int tilesX = 1 << l.tileRowShift, tilesY = std::max(lh >> TEXTURE_TILE_SHIFT, 1);
+        total += (size_t)tilesX * tilesY << (2 * TEXTURE_TILE_SHIFT);
+        tex.levelCount++;
+        if (lw == 1 || lh == 1) break;
+    }
+    tex.texels.assign(total, 0);
+
+    for (int i = 0; i < tex.levelCount; i++) {
+        const TextureLevel& l = tex.levels[i];
+        for (int y = 0; y < l.height; y++)
+            for (int x = 0; x < l.width; x++)
+                tex.texels[l.offset + Texture_TexelIndex(x, y, l.tileRowShift)] = level[(size_t)y * l.width + x];
+        if (i + 1 == tex.levelCount) break;
+
+        // Next level: average of each 2x2 block
+        const TextureLevel& n = tex.levels[i + 1];
+        next.assign((size_t)n.width * n.height, 0);
+        for (int y = 0; y < n.height; y++) {
+            const uint32_t* r0 = &level[(size_t)(2 * y) * l.width];
+            const uint32_t* r1 = r0 + l.width;
+            for (int x = 0; x < n.width; x++) {
+                uint32_t a = r0[2 * x], b = r0[2 * x + 1], c = r1[2 * x], d = r1[2 * x + 1];
+                uint32_t avg = 0;
+                for (int k = 0; k < 32; k += 8)
+                    avg |= ((a >> k & 255) + (b >> k & 255) + (c >> k & 255) + (d >> k & 255) + 2) / 4 << k;
+                next[(size_t)y * n.width + x] = avg;
+            }
+        }
+        level.swap(next);
+    }
+}
+
+// Two-tone checkerboard of `squares` x `squares` fields with a thin grid,
+// the texture used when none is loaded
+inline void Texture_CreateChecker(Texture& tex, int size = 256, int squares = 8) {
+    std::vector<uint32_t> pixels((size_t)size * size);
+    int field = std::max(size / squares, 1);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            bool odd = ((x / field) ^ (y / field)) & 1;
+            bool line = x % field == 0 || y % field == 0;
+            pixels[(size_t)y * size + x] = line ? 0xFF202020u : odd ? 0xFFE8C070u : 0xFFF4F4F4u;
+        }
+    }
+    Texture_Create(tex, pixels.data(), size, size);
+}
+
+// ============== Loading ==============
+// Binary PPM (P6, 8 bits per channel)
+inline bool Texture_LoadPpm(const char* path, Texture& tex, std::string& error) {
+    MappedFile file;
+    if (!file.Open(path)) { error = std::string("cannot open ") + path; return false; }
+    const unsigned char* p = (const unsigned char*)file.Data();
+    const unsigned char* end = p + file.Size();
+
+    // Header: magic, width, height, maxval, separated by whitespace and comments
+    int fields[3];
+    if (end - p < 2 || p[0] != 'P' || p[1] != '6') { error = "not a binary PPM (P6) file"; return false; }
+    p += 2;
+    for (int& f : fields) {
+        while (p < end && (isspace(*p) || *p == '#')) {
+            if (*p == '#') while (p < end && *p != '\n') p++;
+            else p++;
+        }
+        if (p == end || !isdigit(*p)) { error = "bad PPM header"; return false; }
+        f = 0;
+        while (p < end && isdigit(*p) && f < 1000000) f = f * 10 + (*p++ - '0');
+    }
+    int width = fields[0], height = fields[1];
+    if (width <= 0 || height <= 0 || width > 65536 || height > 65536 || fields[2] != 255) {
+        error = "unsupported PPM (8-bit RGB only)";
+        return false;
+    }
+    if (p == end) { error = "truncated PPM"; return false; }
+    p++;    // Single whitespace before the pixels
+    if ((size_t)(end - p) < (size_t)width * height * 3) { error = "truncated PPM"; return false; }
+
+    std::vector<uint32_t> pixels((size_t)width * height);
+    for (size_t i = 0; i < pixels.size(); i++, p += 3)
+        pixels[i] = 0xFF000000u | (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    Texture_Create(tex, pixels.data(), width, height);
+    return true;
+}
@@ -0,0 +1,149 @@
+/*
+    thread_pool.h - Work-stealing Thread Pool
+    Runs index-parallel jobs (ParallelFor) on a fixed set of workers.
+    Each worker owns a queue seeded with a contiguous block of indices;
+    when it runs dry it steals from the back of the other queues. The
+    calling thread takes part as worker 0.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// ============== Thread Pool ==============
+class ThreadPool {
+public:
+    ThreadPool() = default;
+    ~ThreadPool() { Stop(); }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static int HardwareThreads() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n ? (int)n : 1;
+    }
+
+    // Total number of threads used by ParallelFor, including the caller
+    void SetThreadCount(int n) {
+        n = std::max(1, n);
+        if (n == threadCount) return;
+        Stop();
+        threadCount = n;
+        queues.clear();
+        for (int i = 0; i < n; i++) queues.emplace_back(new WorkQueue());
+        stopping = false;
+        for (int i = 1; i < n; i++) workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+
+    int ThreadCount() const { return threadCount; }
+
+    // Calls fn(index, worker) for every index in [0, count); returns when all are done.
+    // worker is in [0, ThreadCount()) and can index per-thread scratch data.
+    template <class F>
+    void ParallelFor(int count, F&& fn) {
+        if (count <= 0) return;
+        if (threadCount == 1 || count == 1) {
+            for (int i = 0; i < count; i++) fn(i, 0);
+            return;
+        }
+
+        // Publish the job before any task becomes visible
+        jobContext = (void*)&fn;
+        jobCall = [](void* ctx, int index, int worker) { (*(typename std::remove_reference<F>::type*)ctx)(index, worker); };
+        remaining.store(count, std::memory_order_relaxed);
+
+        for (int w = 0; w < threadCount; w++) {
+            int begin = (int)((long long)count * w / threadCount);
+            int end = (int)((long long)count * (w + 1) / threadCount);
+            std::lock_guard<std::mutex> lock(queues[w]->mutex);
+            for (int i = begin; i < end; i++) queues[w]->tasks.push_back(i);
+        }
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            generation++;
+        }
+        wake.notify_all();
+
+        RunTasks(0);
+        while (remaining.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    int threadCount = 1;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    void* jobContext = nullptr;
+    void (*jobCall)(void*, int, int) = nullptr;
+    std::atomic<int> remaining{0};
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    unsigned long long generation = 0;
+    bool stopping = false;
+
+    bool PopOwn(int w, int& task) {
+        WorkQueue& q = *queues[w];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) return false;
+        task = q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+    }
+
+    bool Steal(int w, int& task) {
+        for (int k = 1; k < threadCount; k++) {
+            WorkQueue& q = *queues[(w + k) % threadCount];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) continue;
+            task = q.tasks.back();
+            q.tasks.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    void RunTasks(int w) {
+        int task;
+        while (PopOwn(w, task) || Steal(w, task)) {
+            jobCall(jobContext, task, w);
+            remaining.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    void WorkerLoop(int w) {
+        unsigned long long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            RunTasks(w);
+        }
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
+        workers.clear();
+    }
+};
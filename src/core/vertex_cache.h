@@ -0,0 +1,129 @@
+/*
+    vertex_cache.h - Vertex Cache Optimization
+    Orders triangles so each vertex is used again while it is still
+    recent (Tom Forsyth's linear-speed vertex cache optimisation): every
+    vertex scores by its position in a simulated LRU cache and by how few
+    triangles still need it, and the best triangle around the cache is
+    emitted next.
+
+    The engine transforms each vertex once per frame into a full
+    post-transform buffer, so the order does not change the work there;
+    it keeps the triangles' vertex reads close together and makes the
+    order a streaming (FIFO cache) consumer would see cheap.
+    VertexCache_Acmr() measures that: vertices transformed per triangle
+    with a FIFO of VCACHE_SIZE entries, 3 for no reuse, about 0.5 at best.
+*/
+
+#pragma once
+
+#include "mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+const int VCACHE_SIZE = 32;
+
+// ============== Optimization ==============
+namespace vcache {
+
+inline float VertexScore(int cachePos, uint32_t remaining) {
+    if (remaining == 0) return -1.0f;
+    float score = 0;
+    if (cachePos >= 0) {
+        if (cachePos < 3) score = 0.75f;    // Just used: the triangle's own corners
+        else score = powf(1.0f - (cachePos - 3) / (float)(VCACHE_SIZE - 3), 1.5f);
+    }
+    return score + 2.0f / sqrtf((float)remaining);      // Finish off nearly done vertices
+}
+
+} // namespace vcache
+
+// Order for the nTris triangles of `indices` (vertex ids below nVerts):
+// order[i] is the triangle to draw i-th
+inline void VertexCache_Order(const uint32_t* indices, size_t nTris, size_t nVerts, uint32_t* order) {
+    using namespace vcache;
+    // Triangles of every vertex, flattened
+    std::vector<uint32_t> triStart(nVerts + 1, 0), vertTris(nTris * 3);
+    for (size_t i = 0; i < nTris * 3; i++) triStart[indices[i] + 1]++;
+    for (size_t v = 0; v < nVerts; v++) triStart[v + 1] += triStart[v];
+    std::vector<uint32_t> remaining(nVerts), fill(triStart.begin(), triStart.end() - 1);
+    for (size_t i = 0; i < nTris * 3; i++) vertTris[fill[indices[i]]++] = (uint32_t)(i / 3);
+    for (size_t v = 0; v < nVerts; v++) remaining[v] = triStart[v + 1] - triStart[v];
+
+    std::vector<int> cachePos(nVerts, -1);
+    std::vector<float> vertScore(nVerts), triScore(nTris);
+    std::vector<uint8_t> emitted(nTris, 0);
+    for (size_t v = 0; v < nVerts; v++) vertScore[v] = VertexScore(-1, remaining[v]);
+    for (size_t t = 0; t < nTris; t++)
+        triScore[t] = vertScore[indices[t * 3]] + vertScore[indices[t * 3 + 1]] + vertScore[indices[t * 3 + 2]];
+
+    uint32_t cache[VCACHE_SIZE + 3];
+    int cacheCount = 0;
+    size_t nextScan = 0;        // Fallback: triangles before this are all emitted
+    for (size_t out = 0; out < nTris; out++) {
+        // Best triangle around the cache, or the best remaining one
+        int64_t best = -1;
+        float bestScore = -1e30f;
+        for (int c = 0; c < cacheCount; c++) {
+            uint32_t v = cache[c];
+            for (uint32_t i = triStart[v]; i < triStart[v + 1]; i++) {
+                uint32_t t = vertTris[i];
+                if (!emitted[t] && triScore[t] > bestScore) { bestScore = triScore[t]; best = t; }
+            }
+        }
+        if (best < 0) {
+            while (emitted[nextScan]) nextScan++;
+            for (size_t t = nextScan; t < nTris; t++)
+                if (!emitted[t] && triScore[t] > bestScore) { bestScore = triScore[t]; best = (int64_t)t; }
+        }
+        uint32_t tri = (uint32_t)best;
+        order[out] = tri;
+        emitted[tri] = 1;
+
+        // Its corners move to the front of the cache, the rest shift back
+        uint32_t newCache[VCACHE_SIZE + 3];
+        int newCount = 0;
+        for (int i = 0; i < 3; i++) {
+            uint32_t v = indices[tri * 3 + i];
+            newCache[newCount++] = v;
+            remaining[v]--;
+        }
+        for (int c = 0; c < cacheCount; c++) {
+            uint32_t v = cache[c];
+            if (v != newCache[0] && v != newCache[1] && v != newCache[2]) newCache[newCount++] = v;
+        }
+        for (int c = VCACHE_SIZE; c < newCount; c++) cachePos[newCache[c]] = -1;     // Fell out
+        cacheCount = std::min(newCount, VCACHE_SIZE);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        // Rescore the cached vertices and their triangles
+        for (int c = 0; c < newCount; c++) {
+            uint32_t v = newCache[c];
+            if (c < VCACHE_SIZE) cachePos[v] = c;
+            vertScore[v] = VertexScore(cachePos[v], remaining[v]);
+        }
+        for (int c = 0; c < newCount; c++) {
+            uint32_t v = newCache[c];
+            for (uint32_t i = triStart[v]; i < triStart[v + 1]; i++) {
+                uint32_t t = vertTris[i];
+                if (!emitted[t])
+                    triScore[t] = vertScore[indices[t * 3]] + vertScore[indices[t * 3 + 1]] + vertScore[indices[t * 3 + 2]];
+            }
+        }
+    }
+}
+
+// ============== Measurement ==============
+// Average vertices transformed per triangle (ACMR) through a FIFO cache
+inline float VertexCache_Acmr(const Mesh& mesh, int cacheSize = VCACHE_SIZE) {
+    size_t nTris = mesh.TriangleCount();
+    if (nTris == 0) return 0;
+    std::vector<uint32_t> insertedAt(mesh.VertexCount(), 0);    // Miss count after insertion, 0 = never
+    uint32_t misses = 0;
+    for (uint32_t v : mesh.indices) {
+        if (insertedAt[v] && misses - insertedAt[v] < (uint32_t)cacheSize) continue;
+        insertedAt[v] = ++misses;
+    }
+    return (float)misses / nTris;
+}
@@ -0,0 +1,691 @@
+/*
+    3D Graphics Benchmark - Headless
+
+    Drives Engine3D without a window over a set of scenes (cube grids,
+    instanced cube fields, loaded meshes, point clouds) and resolutions,
+    and reports the throughput of every pipeline stage. Then times each math3d routine on its own, and scene
+    graph updates of a large hierarchy with few or many changed nodes.
+
+    Build with ENGINE_HEADLESS defined; no SDL library is linked.
+
+    Usage: 3D_Matrix_bench [options]
+      --cubes N[,N...]      Cube-grid scenes (default 1,1000,20000)
+      --instances N[,N...]  Scenes of N instanced cubes (default 10000,100000)
+      --mesh PATH           Add a scene from an OBJ/PLY file or mesh cache (repeatable)
+      --points N[,N...]     Scenes of N generated scan points (default none)
+      --cloud PATH          Add a point cloud scene from a PLY/XYZ/PTS file (repeatable)
+      --point-density D     Points drawn per pixel a chunk covers, 0 = all (default 4)
+      --res WxH[,WxH...]    Resolutions (default 640x480,1280x720,1920x1080)
+      --frames N            Measured frames per run (default 100)
+      --warmup N            Unmeasured frames before that (default 10)
+      --threads N           Raster threads (default: hardware threads)
+      --wireframe           Draw edges on top of the filled triangles
+      --textured            Sample the checkerboard texture (meshes with texture coordinates)
+      --occlusion           Cull against the previous frame's depth
+      --no-lod              Always draw the full meshes
+      --no-scenes           Only run the microbenchmarks
+      --no-math             Skip the microbenchmarks (math3d, scene graph)
+      --json PATH           Also write all results as JSON ("-" = stdout)
+      --trace PATH          Chrome trace of the measured frames of the first run
+
+    Replay (instead of the above):
+      --replay LOG          Play back an input log recorded with 3D_Matrix --record
+      --step S              Fixed frame time of S seconds instead of the recorded times
+      --csv PATH            Per-frame time, stage times and image hash as CSV
+
+    A replay draws exactly the frames the recorded session drew (the same
+    mesh, texture and settings at every frame, taken from the log) through
+    the serial DrawFrame() path, so two builds can be compared frame by
+    frame: equal hashes mean equal images. --threads overrides the raster
+    thread count the log carries.
+*/
+
+#define SDL_MAIN_HANDLED
+#include "core/engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double SecondsSince(BenchClock::time_point start) {
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// ============== Scene Benchmarks ==============
+struct BenchScene {
+    std::string name;
+    int instances = 0;      // Engine3D::CreateInstanceGrid, 0 = single object
+    // Built once and shared by every run of the scene; none for a point cloud
+    std::shared_ptr<const MeshGeometry> geometry;
+    std::shared_ptr<const MeshLevels> levels;
+    std::shared_ptr<const PointCloud> points;   // Drawn instead of the mesh when set
+};
+
+// Chunk `mesh` and build its levels of detail for `scene`
+static void SetSceneMesh(BenchScene& scene, Mesh mesh) {
+    scene.geometry = MeshGeometry_Build(std::move(mesh));
+    auto levels = std::make_shared<MeshLevels>();
+    MeshLevels_Build(scene.geometry->mesh, *levels);
+    scene.levels = std::move(levels);
+}
+
+struct BenchResult {
+    std::string scene;
+    int width = 0, height = 0, threads = 0, frames = 0;
+    size_t vertices = 0, triangles = 0, points = 0;
+    float acmr = 0;                             // Mesh vertices per triangle through the vertex cache
+    double frameSeconds = 0;                    // Whole frame incl. clear, per frame
+    RenderStats perFrame;                       // Counts and seconds averaged per frame
+};
+
+static BenchResult RunScene(const BenchScene& scene, int width, int height, int threads,
+                            int warmup, int frames, bool wireframe, bool textured, bool occlusion, bool lod,
+                            float pointDensity, const char* tracePath) {
+    Engine3D engine;
+    engine.InitHeadless(width, height);
+    if (scene.geometry) engine.SetMesh(scene.geometry, scene.levels);
+    engine.CreateInstanceGrid(scene.instances);
+    engine.SetPoints(scene.points);
+    engine.pointDensity = pointDensity;
+    engine.objDist = 3.0f;
+    engine.rasterThreads = threads;
+    engine.showWireframe = wireframe;
+    engine.textured = textured;
+    engine.occlusionCulling = occlusion;
+    engine.lodEnabled = lod;
+
+    BenchResult r;
+    r.scene = scene.name;
+    r.width = width; r.height = height;
+    r.threads = threads; r.frames = frames;
+    r.vertices = engine.LodMesh(0).VertexCount();
+    r.triangles = engine.LodMesh(0).TriangleCount() * std::max(scene.instances, 1);
+    r.acmr = engine.meshAcmr;
+    if (scene.points) {
+        r.vertices = r.triangles = 0;
+        r.points = scene.points->Count();
+    }
+
+    // Fixed timestep so every run sees the same sequence of poses
+    const float dt = 1.0f / 60.0f;
+    for (int f = 0; f < warmup + frames; f++) {
+        if (f == warmup && tracePath) Profiler_Get().StartTrace(frames, tracePath);
+        BenchClock::time_point start = BenchClock::now();
+        engine.BeginFrame();
+        engine.Update(dt);
+        engine.Render();
+        engine.EndFrame();
+        double frameSeconds = SecondsSince(start);
+        if (f < warmup) continue;
+
+        const RenderStats& s = engine.stats;
+        r.frameSeconds += frameSeconds;
+        r.perFrame.instances += s.instances;
+        r.perFrame.instancesVisible += s.instancesVisible;
+        r.perFrame.chunksVisible += s.chunksVisible;
+        r.perFrame.vertices += s.vertices;
+        r.perFrame.vertexRefs += s.vertexRefs;
+        r.perFrame.trisIn += s.trisIn;
+        r.perFrame.trisLod += s.trisLod;
+        r.perFrame.trisVisible += s.trisVisible;
+        r.perFrame.trisRaster += s.trisRaster;
+        r.perFrame.pixels += s.pixels;
+        r.perFrame.points += s.points;
+        for (int i = 0; i < RenderStats::STAGE_COUNT; i++) r.perFrame.seconds[i] += s.seconds[i];
+    }
+
+    r.frameSeconds /= frames;
+    r.perFrame.instances /= frames;
+    r.perFrame.instancesVisible /= frames;
+    r.perFrame.chunksVisible /= frames;
+    r.perFrame.vertices /= frames;
+    r.perFrame.vertexRefs /= frames;
+    r.perFrame.trisIn /= frames;
+    r.perFrame.trisLod /= frames;
+    r.perFrame.trisVisible /= frames;
+    r.perFrame.trisRaster /= frames;
+    r.perFrame.pixels /= frames;
+    r.perFrame.points /= frames;
+    for (int i = 0; i < RenderStats::STAGE_COUNT; i++) r.perFrame.seconds[i] /= frames;
+    return r;
+}
+
+static void PrintResult(FILE* out, const BenchResult& r) {
+    const RenderStats& s = r.perFrame;
+    fprintf(out, "%-16s %5dx%-5d %2d thr  %9zu tris  %8.3f ms/frame  %8.1f fps  (visible %zu, raster %zu, filled %zu px)\n",
+           r.scene.c_str(), r.width, r.height, r.threads, r.triangles,
+           r.frameSeconds * 1e3, 1.0 / r.frameSeconds, s.trisVisible, s.trisRaster, s.pixels);
+    for (int i = 0; i < RenderStats::STAGE_COUNT; i++) {
+        double sec = std::max(s.seconds[i], 1e-9);
+        fprintf(out, "    %-10s %8.3f ms  %10.2f Mtris/s", RenderStats::StageName(i),
+               s.seconds[i] * 1e3, s.StageTris(i) / sec * 1e-6);
+        if (RenderStats::StageFillsPixels(i)) fprintf(out, "  %10.2f Mpix/s\n", s.pixels / sec * 1e-6);
+        else fprintf(out, "  %10s Mpix/s\n", "-");
+    }
+    if (r.points) {
+        fprintf(out, "    points     %8zu of %zu per frame from %zu chunks, %.2f Mpoints/s splatted\n",
+                s.points, r.points, s.chunksVisible, s.points / std::max(s.seconds[RenderStats::TRANSFORM], 1e-9) * 1e-6);
+        return;
+    }
+    fprintf(out, "    vertices   %8zu per frame, %5.1f%% reused (cache order %.3f per triangle)\n",
+            s.vertices, s.VertexHitRate() * 100, r.acmr);
+}
+
+// ============== Replay ==============
+// FNV-1a over the pixels, a word at a time
+static uint64_t HashPixels(const Framebuffer& fb) {
+    uint64_t h = 14695981039346656037ull;
+    for (uint32_t p : fb.pixels) h = (h ^ p) * 1099511628211ull;
+    return (h ^ (uint64_t)fb.width << 32 ^ (uint64_t)fb.height) * 1099511628211ull;
+}
+
+static int RunReplay(const char* logPath, const char* csvPath, int threads, float step, FILE* report) {
+    InputLogReader log;
+    InputLogHeader header;
+    std::string error;
+    if (!log.Open(logPath, header, error)) {
+        fprintf(stderr, "Failed to read %s: %s\n", logPath, error.c_str());
+        return 1;
+    }
+    Engine3D engine;
+    engine.InitHeadless(header.width, header.height);
+    if (!header.meshPath.empty() && !engine.LoadMesh(header.meshPath.c_str())) return 1;
+    if (!header.texturePath.empty() && !engine.LoadTexture(header.texturePath.c_str())) return 1;
+    if (!header.pointsPath.empty() && !engine.LoadPoints(header.pointsPath.c_str())) return 1;
+    if (!engine.FrameSettings::Unpack(header.settings)) {
+        fprintf(stderr, "Failed to read %s: settings from another version\n", logPath);
+        return 1;
+    }
+    engine.presented.Resize(header.width, header.height);
+    engine.pipelined = false;           // Each frame is drawn and timed on its own
+
+    FILE* csv = nullptr;
+    if (csvPath) {
+        csv = fopen(csvPath, "w");
+        if (!csv) {
+            fprintf(stderr, "Cannot write %s\n", csvPath);
+            return 1;
+        }
+        fprintf(csv, "frame,dt,drawn,width,height,ms,transform_ms,cull_ms,clip_ms,raster_ms,triangles,pixels,hash\n");
+    }
+
+    std::vector<double> drawnSeconds;
+    uint64_t runHash = 14695981039346656037ull;
+    int frames = 0, skipped = 0;
+    InputFrame frame;
+    while (log.Next(frame, error)) {
+        if (step > 0) frame.dt = step;
+        if (!engine.ApplyInput(frame)) {
+            error = "settings from another version";
+            break;
+        }
+        if (threads > 0) engine.rasterThreads = threads;
+        int full = engine.framesFull, partial = engine.framesPartial;
+        BenchClock::time_point start = BenchClock::now();
+        engine.DrawFrame();
+        double seconds = SecondsSince(start);
+
+        const char* drawn = engine.framesFull > full ? "full" : engine.framesPartial > partial ? "partial" : "skipped";
+        bool idle = drawn[0] == 's';
+        if (idle) skipped++;
+        else drawnSeconds.push_back(seconds);
+        uint64_t hash = HashPixels(engine.presented);
+        runHash = (runHash ^ hash) * 1099511628211ull;
+        if (csv) {
+            const RenderStats& s = engine.presentedStats;
+            fprintf(csv, "%d,%.6f,%s,%d,%d,%.4f", frames, frame.dt, drawn,
+                    engine.presented.width, engine.presented.height, seconds * 1e3);
+            for (int i = 0; i < RenderStats::STAGE_COUNT; i++) fprintf(csv, ",%.4f", idle ? 0.0 : s.seconds[i] * 1e3);
+            fprintf(csv, ",%zu,%zu,%016llx\n", idle ? 0 : s.trisRaster, idle ? 0 : s.pixels, (unsigned long long)hash);
+        }
+        frames++;
+    }
+    if (csv) fclose(csv);
+    if (!error.empty()) {
+        fprintf(stderr, "Failed to read %s at frame %d: %s\n", logPath, frames, error.c_str());
+        return 1;
+    }
+
+    fprintf(report, "Replayed %s: %d frames at %dx%d, %d drawn, %d skipped\n", logPath, frames,
+            header.width, header.height, frames - skipped, skipped);
+    if (!drawnSeconds.empty()) {
+        std::vector<double> t = drawnSeconds;
+        std::sort(t.begin(), t.end());
+        double sum = 0;
+        for (double v : t) sum += v;
+        auto pct = [&](double p) { return t[std::min(t.size() - 1, (size_t)(p * t.size()))] * 1e3; };
+        fprintf(report, "Drawn frames: mean %.3f ms, median %.3f ms, p95 %.3f ms, max %.3f ms\n",
+                sum / t.size() * 1e3, pct(0.5), pct(0.95), t.back() * 1e3);
+    }
+    fprintf(report, "Image hash over all frames: %016llx\n", (unsigned long long)runHash);
+    return 0;
+}
+
+// ============== Math Microbenchmarks ==============
+struct MathResult {
+    std::string name;
+    double nsPerOp;
+};
+
+static volatile float benchSink;
+
+static float Fold(float v) { return v; }
+static float Fold(const vec3d& v) { return v.x + v.y + v.z + v.w; }
+static float Fold(const mat4x4& m) { return m.m[0][0] + m.m[1][1] + m.m[2][2] + m.m[3][3] + m.m[3][0]; }
+static float Fold(const mat4x3& m) { return m.m[0][0] + m.m[1][1] + m.m[2][2] + m.m[3][0]; }
+
+// Inputs cycle through small tables so calls can't be folded away
+const int MATH_TABLE = 256;
+struct MathInputs {
+    vec3d v[MATH_TABLE];
+    float a[MATH_TABLE];
+    mat4x4 m[MATH_TABLE];
+    mat4x3 aff[MATH_TABLE];
+
+    MathInputs() {
+        srand(1234);
+        auto rnd = [] { return (float)rand() / RAND_MAX * 2.0f - 1.0f; };
+        for (int i = 0; i < MATH_TABLE; i++) {
+            v[i] = {rnd() * 10, rnd() * 10, rnd() * 10 + 20, 1};
+            a[i] = rnd() * 3.14159f;
+            aff[i] = Aff_RotEulerTrans(rnd() * 3, rnd() * 3, rnd() * 3, rnd(), rnd(), rnd() + 5);
+            m[i] = Aff_ToMat(aff[i]);
+        }
+    }
+};
+
+// Time fn(i) over `ops` calls and return nanoseconds per call
+template <class F>
+static double TimeOps(size_t ops, F&& fn) {
+    float acc = 0;
+    for (size_t i = 0; i < ops / 16; i++) acc += fn(i);     // Warm caches and clocks
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t i = 0; i < ops; i++) acc += fn(i);
+    double sec = SecondsSince(start);
+    benchSink = acc;
+    return sec * 1e9 / ops;
+}
+
+static std::vector<MathResult> RunMathBench() {
+    static MathInputs in;
+    std::vector<MathResult> results;
+    const size_t ops = 2000000;
+    const int M = MATH_TABLE - 1;
+    vec3d up = {0, 1, 0};
+    mat4x4 proj = Mat_Proj(90, 0.75f, 0.1f, 1000);
+
+#define MATH_BENCH(name, expr) \
+    results.push_back({name, TimeOps(ops, [&](size_t i) { (void)i; return Fold(expr); })})
+
+    MATH_BENCH("Vec_Add", Vec_Add(in.v[i & M], in.v[(i + 1) & M]));
+    MATH_BENCH("Vec_Sub", Vec_Sub(in.v[i & M], in.v[(i + 1) & M]));
+    MATH_BENCH("Vec_Mul", Vec_Mul(in.v[i & M], in.a[i & M]));
+    MATH_BENCH("Vec_Div", Vec_Div(in.v[i & M], in.a[i & M] + 4));
+    MATH_BENCH("Vec_Dot", Vec_Dot(in.v[i & M], in.v[(i + 1) & M]));
+    MATH_BENCH("Vec_Cross", Vec_Cross(in.v[i & M], in.v[(i + 1) & M]));
+    MATH_BENCH("Vec_Norm", Vec_Norm(in.v[i & M]));
+    MATH_BENCH("Mat_MulVec", Mat_MulVec(in.m[i & M], in.v[(i + 1) & M]));
+    MATH_BENCH("Mat_Identity", Mat_Identity());
+    MATH_BENCH("Mat_RotX", Mat_RotX(in.a[i & M]));
+    MATH_BENCH("Mat_RotY", Mat_RotY(in.a[i & M]));
+    MATH_BENCH("Mat_RotZ", Mat_RotZ(in.a[i & M]));
+    MATH_BENCH("Mat_Trans", Mat_Trans(in.a[i & M], 1, 2));
+    MATH_BENCH("Mat_Proj", Mat_Proj(60 + in.a[i & M], 0.75f, 0.1f, 1000));
+    MATH_BENCH("Mat_Mul", Mat_Mul(in.m[i & M], in.m[(i + 1) & M]));
+    MATH_BENCH("Mat_PointAt", Mat_PointAt(in.v[i & M], in.v[(i + 1) & M], up));
+    MATH_BENCH("Mat_QuickInv", Mat_QuickInv(in.m[i & M]));
+    MATH_BENCH("Math_SinCos", ([&] { float s, c; Math_SinCos(in.a[i & M], s, c); return s + c; }()));
+    MATH_BENCH("Aff_Identity", Aff_Identity());
+    MATH_BENCH("Aff_FromMat", Aff_FromMat(in.m[i & M]));
+    MATH_BENCH("Aff_ToMat", Aff_ToMat(in.aff[i & M]));
+    MATH_BENCH("Aff_MulVec", Aff_MulVec(in.aff[i & M], in.v[(i + 1) & M]));
+    MATH_BENCH("Aff_MulDir", Aff_MulDir(in.aff[i & M], in.v[(i + 1) & M]));
+    MATH_BENCH("Aff_Mul", Aff_Mul(in.aff[i & M], in.aff[(i + 1) & M]));
+    MATH_BENCH("Aff_MulMat", Aff_MulMat(in.aff[i & M], proj));
+    MATH_BENCH("Aff_Inverse", Aff_Inverse(in.aff[i & M]));
+    MATH_BENCH("Aff_QuickInv", Aff_QuickInv(in.aff[i & M]));
+    MATH_BENCH("Aff_RotEulerTrans", Aff_RotEulerTrans(in.a[i & M], in.a[(i + 1) & M], in.a[(i + 2) & M], 1, 2, 3));
+    MATH_BENCH("Aff_RotEuler", Aff_RotEuler(in.a[i & M], in.a[(i + 1) & M], in.a[(i + 2) & M]));
+    MATH_BENCH("Aff_PointAt", Aff_PointAt(in.v[i & M], in.v[(i + 1) & M], up));
+    MATH_BENCH("Mat_MVP", Mat_MVP(in.aff[i & M], in.aff[(i + 1) & M], proj));
+    MATH_BENCH("Aff_MaxScale", Aff_MaxScale(in.aff[i & M]));
+    MATH_BENCH("Aff_MulBatch", ([&] { mat4x3 o; Aff_MulBatch(in.aff[i & M], &in.aff[(i + 1) & M], in.aff[(i + 2) & M], &o, 1); return Fold(o); }()));
+#undef MATH_BENCH
+    // cpuid is slow (and very slow under virtualization): fewer calls
+    results.push_back({"Math_DetectSimd", TimeOps(ops / 1000, [](size_t) { return (float)Math_DetectSimd(); })});
+
+    // Batch transforms: nanoseconds per vertex, once per available SIMD level
+    const size_t n = 1 << 16;
+    std::vector<float> x(n), y(n), z(n), ox(n), oy(n), oz(n), ow(n);
+    for (size_t i = 0; i < n; i++) {
+        const vec3d& v = in.v[i & M];
+        x[i] = v.x; y[i] = v.y; z[i] = v.z;
+    }
+    static const char* levelNames[] = {"scalar", "sse2", "avx2"};
+    SimdLevel detected = Math_DetectSimd();
+    const int reps = 64;
+    for (int level = SIMD_SCALAR; level <= detected; level++) {
+        Math_SetSimdLevel((SimdLevel)level);
+        auto batch = [&](const char* name, bool affine) {
+            double ns = TimeOps(reps, [&](size_t i) {
+                if (affine) Aff_MulVecBatch(in.aff[i & M], x.data(), y.data(), z.data(), ox.data(), oy.data(), oz.data(), n);
+                else Mat_MulVecBatch(in.m[i & M], x.data(), y.data(), z.data(), ox.data(), oy.data(), oz.data(), ow.data(), n);
+                return ox[i & (n - 1)];
+            });
+            results.push_back({std::string(name) + "/" + levelNames[level], ns / n});
+        };
+        batch("Mat_MulVecBatch", false);
+        batch("Aff_MulVecBatch", true);
+    }
+    Math_SetSimdLevel(detected);
+    return results;
+}
+
+// ============== Scene Graph Microbenchmark ==============
+struct SceneGraphResult {
+    std::string name;
+    size_t nodes, updated;      // Scene size, nodes recomputed per Update()
+    double usPerUpdate;
+};
+
+// 100 groups of 10 subgroups of 100 leaves below one root (~101k nodes);
+// each case changes some nodes, then times the Update() that follows
+static std::vector<SceneGraphResult> RunSceneGraphBench() {
+    SceneGraph graph;
+    std::vector<int> groups, leaves;
+    int root = graph.AddNode(SceneGraph::NONE, Aff_Identity());
+    for (int g = 0; g < 100; g++) {
+        int group = graph.AddNode(root, Aff_RotEulerTrans(0, g * 0.1f, 0, (float)g, 0, 0));
+        groups.push_back(group);
+        for (int s = 0; s < 10; s++) {
+            int sub = graph.AddNode(group, Aff_RotEulerTrans(s * 0.2f, 0, 0, 0, (float)s, 0));
+            for (int l = 0; l < 100; l++) {
+                int leaf = graph.AddNode(sub, Aff_RotEulerTrans(0, 0, l * 0.05f, 0, 0, (float)l));
+                graph.SetBounds(leaf, vec3d(), 1.0f);
+                leaves.push_back(leaf);
+            }
+        }
+    }
+    graph.Update();
+
+    std::vector<SceneGraphResult> results;
+    auto run = [&](const char* name, int reps, std::function<void(int)> change) {
+        double sec = 0;
+        size_t updated = 0;
+        for (int r = 0; r < reps; r++) {
+            change(r);
+            BenchClock::time_point start = BenchClock::now();
+            updated += graph.Update();
+            sec += SecondsSince(start);
+        }
+        results.push_back({name, graph.Count(), updated / reps, sec * 1e6 / reps});
+    };
+    auto spin = [](int r) { return Aff_RotEulerTrans(0, r * 0.01f, 0, 0, 0, 0); };
+    run("unchanged", 1000, [&](int) {});
+    run("1 leaf", 1000, [&](int r) { graph.SetLocal(leaves[r * 7919 % leaves.size()], spin(r)); });
+    run("100 leaves", 200, [&](int r) {
+        for (int i = 0; i < 100; i++) graph.SetLocal(leaves[(r * 100 + i) * 7919 % leaves.size()], spin(r));
+    });
+    run("1 group", 200, [&](int r) { graph.SetLocal(groups[r % groups.size()], spin(r)); });
+    run("root (all)", 20, [&](int r) { graph.SetLocal(root, spin(r)); });
+    return results;
+}
+
+// ============== JSON Output ==============
+static void WriteJson(FILE* f, const std::vector<BenchResult>& scenes, const std::vector<MathResult>& math,
+                      const std::vector<SceneGraphResult>& graph, int warmup) {
+    static const char* levelNames[] = {"scalar", "sse2", "avx2"};
+    fprintf(f, "{\n  \"machine\": {\"hardware_threads\": %d, \"simd\": \"%s\"},\n",
+            ThreadPool::HardwareThreads(), levelNames[Math_DetectSimd()]);
+    fprintf(f, "  \"warmup_frames\": %d,\n  \"scenes\": [", warmup);
+    for (size_t k = 0; k < scenes.size(); k++) {
+        const BenchResult& r = scenes[k];
+        const RenderStats& s = r.perFrame;
+        fprintf(f, "%s\n    {\"scene\": \"%s\", \"width\": %d, \"height\": %d, \"threads\": %d, \"frames\": %d,\n",
+                k ? "," : "", r.scene.c_str(), r.width, r.height, r.threads, r.frames);
+        fprintf(f, "     \"vertices\": %zu, \"triangles\": %zu, \"lod_skipped_triangles\": %zu,\n",
+                r.vertices, r.triangles, s.trisLod);
+        fprintf(f, "     \"visible_triangles\": %zu, \"raster_triangles\": %zu,\n", s.trisVisible, s.trisRaster);
+        fprintf(f, "     \"transformed_vertices\": %zu, \"vertex_hit_rate\": %.4f, \"vertex_acmr\": %.4f,\n",
+                s.vertices, s.VertexHitRate(), r.acmr);
+        fprintf(f, "     \"instances\": %zu, \"visible_instances\": %zu, \"visible_chunks\": %zu, \"filled_pixels\": %zu,\n",
+                s.instances, s.instancesVisible, s.chunksVisible, s.pixels);
+        fprintf(f, "     \"points\": %zu, \"drawn_points\": %zu,\n", r.points, s.points);
+        fprintf(f, "     \"frame_ms\": %.6f, \"fps\": %.3f,\n     \"stages\": {",
+                r.frameSeconds * 1e3, 1.0 / r.frameSeconds);
+        for (int i = 0; i < RenderStats::STAGE_COUNT; i++) {
+            double sec = std::max(s.seconds[i], 1e-9);
+            fprintf(f, "%s\n       \"%s\": {\"ms\": %.6f, \"tris_per_s\": %.1f",
+                    i ? "," : "", RenderStats::StageName(i), s.seconds[i] * 1e3, s.StageTris(i) / sec);
+            // Filled pixels per second, only for the stage that fills them
+            if (RenderStats::StageFillsPixels(i)) fprintf(f, ", \"pixels_per_s\": %.1f", s.pixels / sec);
+            fputc('}', f);
+        }
+        fprintf(f, "\n     }}");
+    }
+    fprintf(f, "\n  ],\n  \"math\": [");
+    for (size_t k = 0; k < math.size(); k++)
+        fprintf(f, "%s\n    {\"name\": \"%s\", \"ns_per_op\": %.4f}", k ? "," : "", math[k].name.c_str(), math[k].nsPerOp);
+    fprintf(f, "\n  ],\n  \"scene_graph\": [");
+    for (size_t k = 0; k < graph.size(); k++)
+        fprintf(f, "%s\n    {\"name\": \"%s\", \"nodes\": %zu, \"updated\": %zu, \"us_per_update\": %.4f}",
+                k ? "," : "", graph[k].name.c_str(), graph[k].nodes, graph[k].updated, graph[k].usPerUpdate);
+    fprintf(f, "\n  ]\n}\n");
+}
+
+// ============== Main ==============
+static std::vector<std::string> SplitList(const char* s) {
+    std::vector<std::string> out;
+    std::string cur;
+    for (; *s; s++) {
+        if (*s == ',') { if (!cur.empty()) out.push_back(cur); cur.clear(); }
+        else cur += *s;
+    }
+    if (!cur.empty()) out.push_back(cur);
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> cubeCounts = {1, 1000, 20000};
+    std::vector<int> instanceCounts = {10000, 100000};
+    std::vector<const char*> meshPaths, cloudPaths;
+    std::vector<size_t> pointCounts;
+    std::vector<std::pair<int, int>> resolutions = {{640, 480}, {1280, 720}, {1920, 1080}};
+    int frames = 100, warmup = 10, threads = ThreadPool::HardwareThreads();
+    bool wireframe = false, textured = false, occlusion = false, lod = true, runScenes = true, runMath = true;
+    const char* jsonPath = nullptr;
+    const char* tracePath = nullptr;
+    const char* replayPath = nullptr;
+    const char* csvPath = nullptr;
+    float step = 0, pointDensity = 4.0f;
+    bool threadsGiven = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "--cubes") && val) {
+            cubeCounts.clear();
+            for (auto& s : SplitList(val)) cubeCounts.push_back(atoi(s.c_str()));
+            i++;
+        } else if (!strcmp(arg, "--instances") && val) {
+            instanceCounts.clear();
+            for (auto& s : SplitList(val)) instanceCounts.push_back(atoi(s.c_str()));
+            i++;
+        } else if (!strcmp(arg, "--mesh") && val) {
+            meshPaths.push_back(val); i++;
+        } else if (!strcmp(arg, "--points") && val) {
+            pointCounts.clear();
+            for (auto& s : SplitList(val)) pointCounts.push_back((size_t)atoll(s.c_str()));
+            i++;
+        } else if (!strcmp(arg, "--cloud") && val) {
+            cloudPaths.push_back(val); i++;
+        } else if (!strcmp(arg, "--point-density") && val) {
+            pointDensity = std::max(0.0f, (float)atof(val)); i++;
+        } else if (!strcmp(arg, "--res") && val) {
+            resolutions.clear();
+            for (auto& s : SplitList(val)) {
+                int w = 0, h = 0;
+                if (sscanf(s.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0) resolutions.push_back({w, h});
+            }
+            i++;
+        } else if (!strcmp(arg, "--frames") && val) {
+            frames = std::max(1, atoi(val)); i++;
+        } else if (!strcmp(arg, "--warmup") && val) {
+            warmup = std::max(0, atoi(val)); i++;
+        } else if (!strcmp(arg, "--threads") && val) {
+            threads = std::max(1, atoi(val)); i++;
+            threadsGiven = true;
+        } else if (!strcmp(arg, "--json") && val) {
+            jsonPath = val; i++;
+        } else if (!strcmp(arg, "--trace") && val) {
+            if (!ENGINE_PROFILER) {
+                fprintf(stderr, "--trace needs a build with ENGINE_PROFILER=1\n");
+                return 1;
+            }
+            tracePath = val; i++;
+        } else if (!strcmp(arg, "--replay") && val) {
+            replayPath = val; i++;
+        } else if (!strcmp(arg, "--csv") && val) {
+            csvPath = val; i++;
+        } else if (!strcmp(arg, "--step") && val) {
+            step = (float)atof(val); i++;
+        } else if (!strcmp(arg, "--wireframe")) {
+            wireframe = true;
+        } else if (!strcmp(arg, "--textured")) {
+            textured = true;
+        } else if (!strcmp(arg, "--occlusion")) {
+            occlusion = true;
+        } else if (!strcmp(arg, "--no-lod")) {
+            lod = false;
+        } else if (!strcmp(arg, "--no-scenes")) {
+            runScenes = false;
+        } else if (!strcmp(arg, "--no-math")) {
+            runMath = false;
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            return 1;
+        }
+    }
+
+    // Human-readable report goes to stderr when the JSON takes stdout
+    FILE* report = jsonPath && !strcmp(jsonPath, "-") ? stderr : stdout;
+    if (replayPath) return RunReplay(replayPath, csvPath, threadsGiven ? threads : 0, step, report);
+
+    std::vector<BenchResult> sceneResults;
+    if (runScenes) {
+        std::vector<BenchScene> scenes;
+        for (int n : cubeCounts) {
+            if (n <= 0) continue;
+            BenchScene s;
+            s.name = "cubes:" + std::to_string(n);
+            Mesh mesh;
+            Mesh_CreateCubeGrid(mesh, n);
+            Mesh_Fit(mesh, 2.0f);
+            SetSceneMesh(s, std::move(mesh));
+            scenes.push_back(std::move(s));
+        }
+        for (int n : instanceCounts) {
+            if (n <= 0) continue;
+            BenchScene s;
+            s.name = "instances:" + std::to_string(n);
+            Mesh mesh;
+            Mesh_CreateCube(mesh);
+            Mesh_Fit(mesh, 2.0f);
+            SetSceneMesh(s, std::move(mesh));
+            s.instances = n;
+            scenes.push_back(std::move(s));
+        }
+        for (const char* path : meshPaths) {
+            BenchScene s;
+            MeshLoadStats loadStats;
+            bool prepared = MeshCache_IsCachePath(path);
+            auto geometry = std::make_shared<MeshGeometry>();
+            auto levels = std::make_shared<MeshLevels>();
+            bool ok = prepared ? MeshCache_Load(path, geometry->mesh, geometry->chunks, levels->lods,
+                                                levels->chunks, loadStats)
+                               : Mesh_Load(path, geometry->mesh, loadStats);
+            if (!ok) {
+                fprintf(stderr, "Failed to load %s: %s\n", path, loadStats.error.c_str());
+                return 1;
+            }
+            if (prepared) {
+                s.geometry = std::move(geometry);
+                s.levels = std::move(levels);
+            } else {
+                Mesh_Fit(geometry->mesh, 2.0f);
+                SetSceneMesh(s, std::move(geometry->mesh));
+            }
+            const char* base = strrchr(path, '/');
+            s.name = base ? base + 1 : path;
+            scenes.push_back(std::move(s));
+        }
+        for (size_t n : pointCounts) {
+            if (n == 0) continue;
+            BenchScene s;
+            s.name = "points:" + std::to_string(n);
+            auto cloud = std::make_shared<PointCloud>();
+            PointCloud_CreateScan(*cloud, n);
+            PointCloud_Fit(*cloud, 2.0f);
+            PointCloud_BuildChunks(*cloud);
+            s.points = std::move(cloud);
+            scenes.push_back(std::move(s));
+        }
+        for (const char* path : cloudPaths) {
+            BenchScene s;
+            MeshLoadStats loadStats;
+            auto cloud = std::make_shared<PointCloud>();
+            if (!PointCloud_Load(path, *cloud, loadStats)) {
+                fprintf(stderr, "Failed to load %s: %s\n", path, loadStats.error.c_str());
+                return 1;
+            }
+            PointCloud_Fit(*cloud, 2.0f);
+            PointCloud_BuildChunks(*cloud);
+            const char* base = strrchr(path, '/');
+            s.name = base ? base + 1 : path;
+            s.points = std::move(cloud);
+            scenes.push_back(std::move(s));
+        }
+
+        for (const BenchScene& scene : scenes) {
+            for (auto& res : resolutions) {
+                sceneResults.push_back(RunScene(scene, res.first, res.second, threads, warmup, frames, wireframe,
+                                                textured, occlusion, lod, pointDensity,
+                                                sceneResults.empty() ? tracePath : nullptr));
+                PrintResult(report, sceneResults.back());
+            }
+        }
+    }
+
+    std::vector<MathResult> mathResults;
+    if (runMath) {
+        mathResults = RunMathBench();
+        fprintf(report, "\n%-28s %10s\n", "math3d", "ns/op");
+        for (auto& m : mathResults) fprintf(report, "%-28s %10.3f\n", m.name.c_str(), m.nsPerOp);
+    }
+
+    std::vector<SceneGraphResult> graphResults;
+    if (runMath) {
+        graphResults = RunSceneGraphBench();
+        fprintf(report, "\n%-28s %10s %10s %12s\n", "scene graph", "nodes", "updated", "us/update");
+        for (auto& g : graphResults)
+            fprintf(report, "%-28s %10zu %10zu %12.3f\n", g.name.c_str(), g.nodes, g.updated, g.usPerUpdate);
+    }
+
+    if (jsonPath) {
+        bool toStdout = !strcmp(jsonPath, "-");
+        FILE* f = toStdout ? stdout : fopen(jsonPath, "w");
+        if (!f) {
+            fprintf(stderr, "Cannot write %s\n", jsonPath);
+            return 1;
+        }
+        WriteJson(f, sceneResults, mathResults, graphResults, warmup);
+        if (!toStdout) fclose(f);
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+    Mesh Cache Converter
+
+    Turns an OBJ or binary PLY file into a mesh cache (.mcache) that the
+    engine loads without parsing or rebuilding anything: the mesh is fitted
+    into the engine's 2-unit box, snapped to the 16-bit position grid, cut
+    into chunks and simplified into levels of detail, then written out.
+
+    Usage: 3D_Matrix_meshconv INPUT.obj|INPUT.ply OUTPUT.mcache
+*/
+
+#include "core/mesh_cache.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock ConvClock;
+
+static double SecondsSince(ConvClock::time_point start) {
+    return std::chrono::duration<double>(ConvClock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3 || !MeshCache_IsCachePath(argv[2])) {
+        fprintf(stderr, "Usage: %s INPUT.obj|INPUT.ply OUTPUT.mcache\n", argv[0]);
+        return 1;
+    }
+    const char* inPath = argv[1];
+    const char* outPath = argv[2];
+
+    Mesh mesh;
+    MeshLoadStats stats;
+    if (!Mesh_Load(inPath, mesh, stats)) {
+        fprintf(stderr, "Failed to load %s: %s\n", inPath, stats.error.c_str());
+        return 1;
+    }
+    printf("Loaded %s (%s): %zu vertices, %zu triangles in %.3f s\n",
+           inPath, stats.format, stats.vertexCount, stats.triangleCount, stats.seconds);
+
+    // Same steps as Engine3D::LoadMesh, with every level on the stored grid
+    ConvClock::time_point start = ConvClock::now();
+    float acmrIn = VertexCache_Acmr(mesh);
+    Mesh_Fit(mesh, 2.0f);
+    Mesh_Quantize(mesh);
+    MeshChunks chunks;
+    Mesh_BuildChunks(mesh, chunks);
+    Mesh_ComputeFacePlanes(mesh);
+    std::vector<MeshLod> lods;
+    Mesh_BuildLods(mesh, lods);
+    std::vector<MeshChunks> lodChunks(lods.size());
+    for (size_t l = 0; l < lods.size(); l++) {
+        Mesh_Quantize(lods[l].mesh);
+        Mesh_BuildChunks(lods[l].mesh, lodChunks[l]);
+        Mesh_ComputeFacePlanes(lods[l].mesh);
+    }
+    printf("Built %zu chunks and %zu levels of detail in %.3f s\n", chunks.chunks.size(), lods.size(),
+           SecondsSince(start));
+    printf("Vertex cache: %.3f -> %.3f vertices per triangle\n", acmrIn, VertexCache_Acmr(mesh));
+    for (size_t l = 0; l < lods.size(); l++)
+        printf("    LOD %zu: %zu triangles, error %.5f\n", l + 1, lods[l].mesh.TriangleCount(), lods[l].error);
+
+    std::string error;
+    start = ConvClock::now();
+    if (!MeshCache_Write(outPath, mesh, chunks, lods, lodChunks, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    MeshLoadStats check;
+    MeshChunks checkChunks;
+    std::vector<MeshLod> checkLods;
+    std::vector<MeshChunks> checkLodChunks;
+    if (!MeshCache_Load(outPath, mesh, checkChunks, checkLods, checkLodChunks, check)) {
+        fprintf(stderr, "Written file does not read back: %s\n", check.error.c_str());
+        return 1;
+    }
+    printf("Wrote %s: %.1f MB in %.3f s (reads back in %.3f s)\n", outPath,
+           check.fileBytes / (1024.0 * 1024.0), SecondsSince(start) - check.seconds, check.seconds);
+    return 0;
+}
@@ -7,13 +7,142 @@
     - math3d/math3d.h : Vector and matrix operations
     - core/engine.h   : 3D rendering engine
     - SDLApp.h        : SDL2 + ImGui framework
+
+    Usage: 3D_Matrix [mesh.obj | mesh.ply | mesh.mcache] [--texture FILE.ppm | --textured]
+                     [--points FILE] [--record FILE.log] [--batch DIR [options]]
+
+    --texture loads a binary PPM image and draws the mesh textured with it,
+    --textured draws it with the built-in checkerboard. Both need a mesh
+    with texture coordinates (the default cube has them).
+
+    --points draws a point cloud (binary PLY, or text .xyz / .pts with
+    x y z [r g b] per line) instead of the mesh.
+
+    --record writes the session's input (frame times, movement keys,
+    control panel changes, resizes) to a log that 3D_Matrix_bench --replay
+    plays back headless, frame for frame.
+
+    With --batch, no window opens: a turntable sequence is rendered on all
+    cores and written to DIR/frame_00000.png, ...
+      --frames N            Frames in the sequence (default 120)
+      --res WxH             Resolution (default 1920x1080)
+      --format png|ppm      Image format (default png)
+      --turns T             Full turns of the object (default 1)
+      --tilt A              Object tilt towards the camera, radians (default 0.35)
+      --dist D              Object distance (default 5)
+      --instances N         Instance grid instead of a single object
+      --threads N           Frames rendered at once (default: hardware threads)
+      --wireframe           Draw edges over the filled triangles
 */
 
 #include "core/engine.h"
+#include "core/batch_render.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ============== Batch Mode ==============
+struct BatchScene {
+    float tilt = 0.35f, dist = 5.0f;
+    int instances = 0;
+    bool wireframe = false;
+};
+
+static int RunBatch(const char* meshPath, const char* texturePath, const char* pointsPath, bool textured,
+                    const BatchOptions& opt, const BatchScene& setup) {
+    Engine3D scene;
+    if (meshPath) { if (!scene.LoadMesh(meshPath)) return 1; }
+    else scene.CreateCube();
+    scene.TakeLevels(true);     // Every frame draws with the levels of detail
+    if (texturePath && !scene.LoadTexture(texturePath)) return 1;
+    if (pointsPath && !scene.LoadPoints(pointsPath)) return 1;
+    scene.textured = textured;
+    scene.rotX = setup.tilt;
+    scene.objDist = setup.dist;
+    scene.instanceCount = setup.instances;
+    scene.showWireframe = setup.wireframe;
+
+    printf("Rendering %d frames at %dx%d on %d threads into %s\n", opt.frames, opt.width, opt.height,
+           std::min(opt.threads, opt.frames), opt.outDir.c_str());
+    BatchStats stats;
+    bool ok = Batch_Render(scene, opt, stats, [&](int done) {
+        printf("\r%d / %d", done, opt.frames);
+        fflush(stdout);
+    });
+    printf("\n");
+    if (!ok) {
+        fprintf(stderr, "%s\n", stats.error.c_str());
+        return 1;
+    }
+    printf("Wrote %d frames (%.1f MB) in %.2f s, %.1f frames/s\n", stats.framesWritten,
+           stats.bytesWritten / (1024.0 * 1024.0), stats.seconds, stats.framesWritten / stats.seconds);
+    printf("Thread time: render %.2f s, encode+write %.2f s, waiting for the writers %.2f s\n",
+           stats.renderSeconds, stats.writeSeconds, stats.stallSeconds);
+    return 0;
+}
 
 // ============== Main ==============
 int main(int argc, char* argv[]) {
+    const char* meshPath = nullptr;
+    const char* texturePath = nullptr;
+    const char* pointsPath = nullptr;
+    const char* recordPath = nullptr;
+    bool batch = false, textured = false;
+    BatchOptions opt;
+    BatchScene setup;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* val = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg[0] != '-') {
+            meshPath = arg;
+        } else if (!strcmp(arg, "--texture") && val) {
+            texturePath = val; i++;
+            textured = true;
+        } else if (!strcmp(arg, "--textured")) {
+            textured = true;
+        } else if (!strcmp(arg, "--points") && val) {
+            pointsPath = val; i++;
+        } else if (!strcmp(arg, "--record") && val) {
+            recordPath = val; i++;
+        } else if (!strcmp(arg, "--batch") && val) {
+            batch = true;
+            opt.outDir = val; i++;
+        } else if (!strcmp(arg, "--frames") && val) {
+            opt.frames = std::max(1, atoi(val)); i++;
+        } else if (!strcmp(arg, "--res") && val) {
+            if (sscanf(val, "%dx%d", &opt.width, &opt.height) != 2 || opt.width <= 0 || opt.height <= 0) {
+                fprintf(stderr, "Bad resolution: %s\n", val);
+                return 1;
+            }
+            i++;
+        } else if (!strcmp(arg, "--format") && val) {
+            opt.format = val; i++;
+        } else if (!strcmp(arg, "--turns") && val) {
+            opt.turns = (float)atof(val); i++;
+        } else if (!strcmp(arg, "--tilt") && val) {
+            setup.tilt = (float)atof(val); i++;
+        } else if (!strcmp(arg, "--dist") && val) {
+            setup.dist = (float)atof(val); i++;
+        } else if (!strcmp(arg, "--instances") && val) {
+            setup.instances = std::max(0, atoi(val)); i++;
+        } else if (!strcmp(arg, "--threads") && val) {
+            opt.threads = std::max(1, atoi(val)); i++;
+        } else if (!strcmp(arg, "--wireframe")) {
+            setup.wireframe = true;
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            return 1;
+        }
+    }
+    if (batch) return RunBatch(meshPath, texturePath, pointsPath, textured, opt, setup);
+
     Engine3D engine;
-    if (engine.Init()) engine.Run();
+    if (!engine.Init(meshPath)) return 1;
+    if (texturePath && !engine.LoadTexture(texturePath)) return 1;
+    if (pointsPath && !engine.LoadPoints(pointsPath)) return 1;
+    engine.textured = textured;
+    if (recordPath && !engine.StartRecording(recordPath, meshPath, texturePath, pointsPath)) return 1;
+    engine.Run();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,280 @@
+/*
+    Headless Engine Tests
+
+    Renders small scenes several ways that must give the same image and
+    compares them pixel for pixel (through hashes where only equality
+    matters): every SIMD level, scalar and SSE2 raster blocks, 1 and more
+    raster threads, partial and full redraws, and a recorded input log
+    against two replays of it. Run by ctest; writes its scratch files
+    (a mesh and an input log) to the working directory.
+
+    Usage: 3D_Matrix_tests
+*/
+
+#define SDL_MAIN_HANDLED
+#include "core/engine.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) failures++;
+}
+
+static uint64_t HashPixels(const Framebuffer& fb) {
+    uint64_t h = 14695981039346656037ull;
+    for (uint32_t p : fb.pixels) h = (h ^ p) * 1099511628211ull;
+    return (h ^ (uint64_t)fb.width << 32 ^ (uint64_t)fb.height) * 1099511628211ull;
+}
+
+static bool SameDepth(const Framebuffer& a, const Framebuffer& b) {
+    return a.depth.storage.size() == b.depth.storage.size() &&
+           !memcmp(a.depth.storage.data(), b.depth.storage.data(), a.depth.storage.size() * sizeof(float));
+}
+
+// ============== Scenes ==============
+const char* TEST_MESH_PATH = "3D_Matrix_tests.obj";
+const char* TEST_LOG_PATH = "3D_Matrix_tests.log";
+
+// A UV sphere with texture coordinates, enough triangles for every level
+// of detail, as an OBJ file (the engine loads and fits it like any other)
+static bool WriteSphereObj(const char* path, int n) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    for (int i = 0; i <= n; i++) {
+        for (int j = 0; j < n; j++) {
+            float theta = 3.14159265f * i / n, phi = 6.28318531f * j / n;
+            fprintf(f, "v %.6f %.6f %.6f\n", sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+            fprintf(f, "vt %.6f %.6f\n", (float)j / n * 4, (float)i / n * 2);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            int a = i * n + j + 1, b = i * n + (j + 1) % n + 1, c = a + n, d = b + n;
+            fprintf(f, "f %d/%d %d/%d %d/%d %d/%d\n", a, a, c, c, d, d, b, b);
+        }
+    }
+    return fclose(f) == 0;
+}
+
+// A headless engine drawing `scene`'s mesh and texture as a grid of
+// textured instances, or its points
+static void SetupEngine(Engine3D& engine, const Engine3D& scene, bool points) {
+    engine.InitHeadless(320, 240);
+    engine.presented.Resize(320, 240);
+    engine.SetMesh(scene.geometry, scene.levels);
+    engine.texture = scene.texture;
+    if (points) engine.SetPoints(scene.points);
+    engine.CreateInstanceGrid(points ? 0 : 27);
+    engine.autoRotate = false;
+    engine.rotX = 0.4f;
+    engine.rotZ = 0.2f;
+    engine.objDist = points ? 3.0f : 6.0f;
+    engine.textured = true;
+    engine.pipelined = false;
+}
+
+// Hash of one frame drawn with the given SIMD level and raster threads
+static uint64_t RenderHash(const Engine3D& scene, bool points, SimdLevel level, int threads) {
+    Math_SetSimdLevel(level);
+    Engine3D engine;
+    SetupEngine(engine, scene, points);
+    engine.rasterThreads = threads;
+    engine.DrawFrame();
+    engine.EndFrame();
+    Math_SetSimdLevel(Math_DetectSimd());
+    return HashPixels(engine.presented);
+}
+
+// ============== SIMD Levels and Threads ==============
+static void TestSimdLevels(const Engine3D& scene) {
+    for (bool points : {false, true}) {
+        uint64_t scalar = RenderHash(scene, points, SIMD_SCALAR, 1);
+        Check(RenderHash(scene, points, SIMD_SSE2, 1) == scalar,
+              points ? "points: SSE2 matches scalar" : "mesh: SSE2 matches scalar");
+        Check(RenderHash(scene, points, SIMD_AVX2, 1) == scalar,
+              points ? "points: AVX2 matches scalar" : "mesh: AVX2 matches scalar");
+    }
+    if (Math_DetectSimd() < SIMD_AVX2) printf("     (no AVX2 on this CPU, compared at %d)\n", (int)Math_DetectSimd());
+}
+
+// Triangles drawn whole go through the SSE2 blocks where those are built
+// in; cut into strips 4 pixels wide (narrower than a block) they all go
+// through the scalar one
+static void TestRasterBlocks() {
+    Texture texture;
+    Texture_CreateChecker(texture, 256, 8);
+    Framebuffer whole, strips;
+    whole.Resize(320, 240);
+    strips.Resize(320, 240);
+    whole.Clear();
+    strips.Clear();
+    whole.depth.Clear();
+    strips.depth.Clear();
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> x(-40, 360), y(-40, 280), w(0.05f, 2.0f), uv(-2, 3);
+    for (int i = 0; i < 300; i++) {
+        vec3d p[3];
+        RasterUV coords;
+        for (int k = 0; k < 3; k++) {
+            p[k] = {x(rng), y(rng), 0, w(rng)};
+            coords.u[k] = uv(rng);
+            coords.v[k] = uv(rng);
+        }
+        uint32_t argb = 0xFF000000u | (rng() & 0xFFFFFF);
+        bool textured = i % 2 == 0;
+        const Texture* tex = textured ? &texture : nullptr;
+        const RasterUV* uvs = textured ? &coords : nullptr;
+        Raster_FillTriangle(whole, p[0], p[1], p[2], argb, Raster_FullRect(whole), true, tex, uvs);
+        for (int x0 = 0; x0 < strips.width; x0 += 4) {
+            RasterRect strip;
+            strip.x0 = x0; strip.x1 = x0 + 4;
+            strip.y0 = 0; strip.y1 = strips.height;
+            Raster_FillTriangle(strips, p[0], p[1], p[2], argb, strip, true, tex, uvs);
+        }
+    }
+    Check(whole.pixels == strips.pixels && SameDepth(whole, strips), "raster: blocks match scalar strips");
+}
+
+static void TestThreads(const Engine3D& scene) {
+    for (bool points : {false, true}) {
+        uint64_t one = RenderHash(scene, points, Math_DetectSimd(), 1);
+        bool same = true;
+        for (int threads : {2, 3, 8}) same = same && RenderHash(scene, points, Math_DetectSimd(), threads) == one;
+        Check(same, points ? "points: 2, 3 and 8 threads match 1" : "mesh: 2, 3 and 8 threads match 1");
+    }
+}
+
+// ============== Partial Redraw ==============
+// Instances move one or two at a time; an engine redrawing only around
+// them must show what one redrawing everything shows
+static void TestPartialRedraw(const Engine3D& scene, bool wireframe) {
+    Engine3D partial, full;
+    for (Engine3D* e : {&partial, &full}) {
+        SetupEngine(*e, scene, false);
+        e->showWireframe = wireframe;
+    }
+    full.incrementalRedraw = false;
+    bool same = true;
+    for (int i = 0; i < 24; i++) {
+        for (Engine3D* e : {&partial, &full}) {
+            const std::vector<int>& nodes = e->instances.nodes;
+            if (i == 4) e->scene.SetLocal(nodes[5], Aff_RotEulerTrans(0.3f, 0.2f, 0, 1.5f, 0.7f, 0.4f));
+            if (i == 7) e->scene.SetLocal(nodes[13], Aff_RotEulerTrans(0.1f, 0.9f, 0, -2.0f, 1.0f, -1.0f));
+            if (i == 9) {
+                e->scene.SetLocal(nodes[2], Aff_RotEulerTrans(0, 0, 0, 0.5f, 0.5f, 0));
+                e->scene.SetLocal(nodes[20], Aff_RotEulerTrans(1, 0, 0, 3.0f, -2.0f, 2.0f));
+            }
+            if (i == 12) e->scene.SetLocal(nodes[7], Aff_RotEulerTrans(0, 0, 0, 0, 0, -50));   // Behind the camera
+            if (i == 15) e->scene.SetLocal(nodes[8], Aff_RotEulerTrans(0, 0, 0, 400, 0, 0));   // Off screen
+            if (i == 18) e->rotY = 0.5f;
+            e->DrawFrame();
+            e->EndFrame();
+        }
+        same = same && partial.presented.pixels == full.presented.pixels && SameDepth(partial.presented, full.presented);
+    }
+    if (wireframe) {
+        Check(same, "redraw: full frames with the wireframe match");
+    } else {
+        Check(partial.framesPartial > 0, "redraw: moved instances are redrawn partially");
+        Check(same, "redraw: partial frames match full ones");
+    }
+}
+
+// ============== Input Log Replay ==============
+// A session like Run()'s main loop: keys, control panel changes, a resize,
+// and levels of detail arriving from the background build
+static bool RecordSession(std::vector<uint64_t>& hashes) {
+    Engine3D e;
+    e.InitHeadless(320, 240);
+    e.presented.Resize(320, 240);
+    e.pipelined = false;
+    if (!e.LoadMesh(TEST_MESH_PATH)) return false;
+    e.instanceCount = 8;
+    if (!e.StartRecording(TEST_LOG_PATH, TEST_MESH_PATH, nullptr, nullptr)) return false;
+    for (int i = 0; i < 60; i++) {
+        float dt = 0.01f + 0.003f * (i % 7);
+        uint8_t keys = (i / 8) % 3 == 1 ? INPUT_KEY_FORWARD | INPUT_KEY_LEFT : (i % 11 == 0 ? INPUT_KEY_RIGHT : 0);
+        e.Update(dt, keys);
+        std::vector<uint8_t> beforeUI;
+        e.Settings().Pack(beforeUI);
+        if (i == 10) e.showWireframe = !e.showWireframe;
+        if (i == 20) e.instanceCount = 27;
+        if (i == 25) e.rotSpeed = 2.5f;
+        if (i == 30) { e.app.pendingWidth = 256; e.app.pendingHeight = 200; }
+        if (i == 35) e.renderScale = 0.7f;
+        if (i == 40) e.textured = true;
+        if (i == 50) e.renderScale = 1.0f;
+        // The levels land in the middle of the session however fast they build
+        if (i == 15) while (e.levelBuilder.Running() && !e.levelBuilder.Ready()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (e.levelBuilder.Ready()) e.levelsDue = true;
+        e.RecordFrame(dt, keys, beforeUI);
+        e.DrawFrame();
+        e.EndFrame();
+        hashes.push_back(HashPixels(e.presented));
+    }
+    e.StopRecording();
+    return e.LodCount() > 1;
+}
+
+// As 3D_Matrix_bench --replay does it
+static bool Replay(std::vector<uint64_t>& hashes) {
+    InputLogReader log;
+    InputLogHeader header;
+    std::string error;
+    if (!log.Open(TEST_LOG_PATH, header, error)) return false;
+    Engine3D e;
+    e.InitHeadless(header.width, header.height);
+    if (!e.LoadMesh(header.meshPath.c_str()) || !e.FrameSettings::Unpack(header.settings)) return false;
+    e.presented.Resize(header.width, header.height);
+    e.pipelined = false;
+    InputFrame frame;
+    while (log.Next(frame, error)) {
+        if (!e.ApplyInput(frame)) return false;
+        e.DrawFrame();
+        e.EndFrame();
+        hashes.push_back(HashPixels(e.presented));
+    }
+    return error.empty();
+}
+
+static void TestReplay() {
+    std::vector<uint64_t> recorded, first, second;
+    Check(RecordSession(recorded), "replay: session recorded with levels of detail");
+    Check(Replay(first) && first == recorded, "replay: first replay matches the session");
+    Check(Replay(second) && second == first, "replay: second replay matches the first");
+}
+
+int main() {
+    if (!WriteSphereObj(TEST_MESH_PATH, 24)) {
+        fprintf(stderr, "Cannot write %s\n", TEST_MESH_PATH);
+        return 1;
+    }
+    Engine3D scene;
+    if (!scene.LoadMesh(TEST_MESH_PATH)) return 1;
+    scene.TakeLevels(true);
+    auto cloud = std::make_shared<PointCloud>();
+    PointCloud_CreateScan(*cloud, 200000);
+    PointCloud_Fit(*cloud, 2.0f);
+    PointCloud_BuildChunks(*cloud);
+    scene.SetPoints(cloud);
+
+    TestSimdLevels(scene);
+    TestRasterBlocks();
+    TestThreads(scene);
+    TestPartialRedraw(scene, false);
+    TestPartialRedraw(scene, true);
+    TestReplay();
+
+    remove(TEST_MESH_PATH);
+    remove(TEST_LOG_PATH);
+    printf("%s\n", failures ? "FAILED" : "All tests passed");
+    return failures ? 1 : 0;
+}
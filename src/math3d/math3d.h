@@ -5,12 +5,37 @@
     Contains:
     - vec3d: 3D vector with homogeneous coordinate w
     - mat4x4: 4x4 transformation matrix
+    - mat4x3: affine matrix (rotation/scale + translation, last column implied)
     - Vector operations: add, sub, mul, div, dot, cross, normalize
     - Matrix operations: multiply, identity, rotation, translation, projection
+    - Affine operations: multiply, inverse, fused Euler and MVP builders
+    - Batch operations: transform whole x/y/z point streams (SSE2/AVX2)
 */
 
 #pragma once
 #include <cmath>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MATH3D_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(MATH3D_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MATH3D_SSE2 1
+#endif
+
+// AVX2 kernels are compiled for the AVX2 target and only called after a CPUID check
+#if defined(MATH3D_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MATH3D_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MATH3D_TARGET_AVX2
+#endif
 
 // ============== 3D Vector ==============
 struct vec3d {
@@ -22,6 +47,13 @@ struct mat4x4 {
     float m[4][4] = { 0 };
 };
 
+// ============== Affine Matrix ==============
+// Same row-vector layout as mat4x4 (p' = p * M, translation in row 3) with
+// the constant last column (0, 0, 0, 1) dropped: the 3x4 affine part.
+struct mat4x3 {
+    float m[4][3] = { 0 };
+};
+
 // ============== Vector Operations ==============
 
 // Vector addition: a + b
@@ -169,3 +201,355 @@ inline mat4x4 Mat_QuickInv(const mat4x4& m) {
     return r;
 }
 
+
+// ============== Affine Operations ==============
+
+// Sine and cosine of one angle in a single call
+inline void Math_SinCos(float a, float& s, float& c) {
+#if defined(__GNUC__) && !defined(__APPLE__) && !defined(__clang__)
+    __builtin_sincosf(a, &s, &c);
+#else
+    s = sinf(a); c = cosf(a);   // MSVC/Clang fuse these into one sincos
+#endif
+}
+
+inline mat4x3 Aff_Identity() {
+    mat4x3 m;
+    m.m[0][0] = 1; m.m[1][1] = 1; m.m[2][2] = 1;
+    return m;
+}
+
+// Drop the last column (assumed to be 0, 0, 0, 1)
+inline mat4x3 Aff_FromMat(const mat4x4& a) {
+    mat4x3 m;
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 3; c++) m.m[r][c] = a.m[r][c];
+    return m;
+}
+
+// Expand back to a full 4x4 matrix
+inline mat4x4 Aff_ToMat(const mat4x3& a) {
+    mat4x4 m;
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 3; c++) m.m[r][c] = a.m[r][c];
+    m.m[3][3] = 1;
+    return m;
+}
+
+// Affine × point (w = 1): 9 multiplies, 9 adds
+inline vec3d Aff_MulVec(const mat4x3& m, const vec3d& v) {
+    vec3d o;
+    o.x = v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + m.m[3][0];
+    o.y = v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + m.m[3][1];
+    o.z = v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + m.m[3][2];
+    return o;
+}
+
+// Affine × direction (w = 0): translation ignored
+inline vec3d Aff_MulDir(const mat4x3& m, const vec3d& v) {
+    vec3d o;
+    o.x = v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0];
+    o.y = v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1];
+    o.z = v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2];
+    o.w = 0;
+    return o;
+}
+
+// Affine × Affine: 36 multiplies instead of 64
+inline mat4x3 Aff_Mul(const mat4x3& a, const mat4x3& b) {
+    mat4x3 m;
+    for (int c = 0; c < 3; c++) {
+        for (int r = 0; r < 3; r++)
+            m.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c];
+        m.m[3][c] = a.m[3][0] * b.m[0][c] + a.m[3][1] * b.m[1][c] + a.m[3][2] * b.m[2][c] + b.m[3][c];
+    }
+    return m;
+}
+
+// Affine × general 4x4 (e.g. model-view × projection): 48 multiplies instead of 64
+inline mat4x4 Aff_MulMat(const mat4x3& a, const mat4x4& b) {
+    mat4x4 m;
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 3; r++)
+            m.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c];
+        m.m[3][c] = a.m[3][0] * b.m[0][c] + a.m[3][1] * b.m[1][c] + a.m[3][2] * b.m[2][c] + b.m[3][c];
+    }
+    return m;
+}
+
+// General affine inverse (handles scale and shear)
+inline mat4x3 Aff_Inverse(const mat4x3& a) {
+    const float (*m)[3] = a.m;
+    float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    float det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+    float inv = det != 0 ? 1.0f / det : 0.0f;
+    mat4x3 r;
+    r.m[0][0] = c00 * inv;
+    r.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+    r.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+    r.m[1][0] = c01 * inv;
+    r.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+    r.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+    r.m[2][0] = c02 * inv;
+    r.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+    r.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+    for (int c = 0; c < 3; c++)
+        r.m[3][c] = -(m[3][0] * r.m[0][c] + m[3][1] * r.m[1][c] + m[3][2] * r.m[2][c]);
+    return r;
+}
+
+// Inverse for rotation + translation only (transpose the rotation)
+inline mat4x3 Aff_QuickInv(const mat4x3& m) {
+    mat4x3 r;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) r.m[i][j] = m.m[j][i];
+    for (int c = 0; c < 3; c++)
+        r.m[3][c] = -(m.m[3][0] * r.m[0][c] + m.m[3][1] * r.m[1][c] + m.m[3][2] * r.m[2][c]);
+    return r;
+}
+
+// Euler rotation RotZ(az) × RotX(ax) × RotY(ay) followed by a translation,
+// built directly with one sincos per angle (no 4x4 products)
+inline mat4x3 Aff_RotEulerTrans(float ax, float ay, float az, float tx, float ty, float tz) {
+    float sx, cx, sy, cy, sz, cz;
+    Math_SinCos(ax, sx, cx);
+    Math_SinCos(ay, sy, cy);
+    Math_SinCos(az, sz, cz);
+    mat4x3 m;
+    m.m[0][0] = cz * cy - sz * sx * sy;  m.m[0][1] = sz * cx;  m.m[0][2] = cz * sy + sz * sx * cy;
+    m.m[1][0] = -sz * cy - cz * sx * sy; m.m[1][1] = cz * cx;  m.m[1][2] = cz * sx * cy - sz * sy;
+    m.m[2][0] = -cx * sy;                m.m[2][1] = -sx;      m.m[2][2] = cx * cy;
+    m.m[3][0] = tx; m.m[3][1] = ty; m.m[3][2] = tz;
+    return m;
+}
+
+inline mat4x3 Aff_RotEuler(float ax, float ay, float az) {
+    return Aff_RotEulerTrans(ax, ay, az, 0, 0, 0);
+}
+
+// "Point At" as an affine matrix
+inline mat4x3 Aff_PointAt(const vec3d& pos, const vec3d& target, const vec3d& up) {
+    return Aff_FromMat(Mat_PointAt(pos, target, up));
+}
+
+// Combined model-view-projection: world × view × proj in 36 + 48 multiplies
+inline mat4x4 Mat_MVP(const mat4x3& world, const mat4x3& view, const mat4x4& proj) {
+    return Aff_MulMat(Aff_Mul(world, view), proj);
+}
+
+// Largest scale factor along any local axis (bounding sphere radius scale)
+inline float Aff_MaxScale(const mat4x3& m) {
+    float s = 0;
+    for (int r = 0; r < 3; r++)
+        s = std::fmax(s, m.m[r][0] * m.m[r][0] + m.m[r][1] * m.m[r][1] + m.m[r][2] * m.m[r][2]);
+    return sqrtf(s);
+}
+
+// pre × m[i] × post for a whole array, e.g. per-instance world matrices
+inline void Aff_MulBatch(const mat4x3& pre, const mat4x3* m, const mat4x3& post, mat4x3* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = Aff_Mul(Aff_Mul(pre, m[i]), post);
+}
+
+// ============== Batch Operations ==============
+//
+// Points are passed as separate x/y/z streams (structure of arrays) with an
+// implied w = 1. Every lane computes x*m[0][c] + y*m[1][c] + z*m[2][c] + m[3][c]
+// with the same operation order as Mat_MulVec and no fused multiply-add, so
+// the SIMD and scalar paths give bit-identical results.
+
+enum SimdLevel { SIMD_SCALAR = 0, SIMD_SSE2 = 1, SIMD_AVX2 = 2 };
+
+// Best instruction set supported by this CPU and OS
+inline SimdLevel Math_DetectSimd() {
+#if defined(MATH3D_X86)
+    int level = SIMD_SCALAR;
+#if defined(MATH3D_SSE2)
+    level = SIMD_SSE2;
+#endif
+    unsigned int r[4] = {0, 0, 0, 0};
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0, avx = (info[2] & (1 << 28)) != 0;
+        __cpuidex(info, 7, 0);
+        r[1] = (unsigned)info[1];
+        if (osxsave && avx && (_xgetbv(0) & 6) == 6 && (r[1] & (1 << 5))) level = SIMD_AVX2;
+    }
+#else
+    if (__get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid(1, r[0], r[1], r[2], r[3]);
+        bool osxsave = (r[2] & (1u << 27)) != 0, avx = (r[2] & (1u << 28)) != 0;
+        unsigned int xcr0 = 0;
+        if (osxsave) { unsigned int edx; __asm__("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0)); }
+        __cpuid_count(7, 0, r[0], r[1], r[2], r[3]);
+        if (osxsave && avx && (xcr0 & 6) == 6 && (r[1] & (1u << 5))) level = SIMD_AVX2;
+    }
+#endif
+    return (SimdLevel)level;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+// Active level; starts at the detected one and can be lowered for testing
+inline SimdLevel& Math_SimdLevel() {
+    static SimdLevel level = Math_DetectSimd();
+    return level;
+}
+
+// Force a level (clamped to what the CPU supports)
+inline void Math_SetSimdLevel(SimdLevel level) {
+    SimdLevel best = Math_DetectSimd();
+    Math_SimdLevel() = level < best ? level : best;
+}
+
+inline void Mat_MulVecBatch_Scalar(const mat4x4& m, const float* x, const float* y, const float* z,
+                                   float* ox, float* oy, float* oz, float* ow, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        float vx = x[i], vy = y[i], vz = z[i];
+        float rx = vx * m.m[0][0] + vy * m.m[1][0] + vz * m.m[2][0] + m.m[3][0];
+        float ry = vx * m.m[0][1] + vy * m.m[1][1] + vz * m.m[2][1] + m.m[3][1];
+        float rz = vx * m.m[0][2] + vy * m.m[1][2] + vz * m.m[2][2] + m.m[3][2];
+        if (ow) ow[i] = vx * m.m[0][3] + vy * m.m[1][3] + vz * m.m[2][3] + m.m[3][3];
+        ox[i] = rx; oy[i] = ry; oz[i] = rz;
+    }
+}
+
+#if defined(MATH3D_SSE2)
+// 8 points per iteration as two 4-wide groups
+inline void Mat_MulVecBatch_SSE2(const mat4x4& m, const float* x, const float* y, const float* z,
+                                 float* ox, float* oy, float* oz, float* ow, size_t n) {
+    __m128 c[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int k = 0; k < 4; k++) c[r][k] = _mm_set1_ps(m.m[r][k]);
+
+    auto row = [&](__m128 vx, __m128 vy, __m128 vz, int k) {
+        return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, c[0][k]), _mm_mul_ps(vy, c[1][k])),
+                                     _mm_mul_ps(vz, c[2][k])), c[3][k]);
+    };
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (size_t j = i; j < i + 8; j += 4) {
+            __m128 vx = _mm_loadu_ps(x + j), vy = _mm_loadu_ps(y + j), vz = _mm_loadu_ps(z + j);
+            _mm_storeu_ps(ox + j, row(vx, vy, vz, 0));
+            _mm_storeu_ps(oy + j, row(vx, vy, vz, 1));
+            _mm_storeu_ps(oz + j, row(vx, vy, vz, 2));
+            if (ow) _mm_storeu_ps(ow + j, row(vx, vy, vz, 3));
+        }
+    }
+    Mat_MulVecBatch_Scalar(m, x + i, y + i, z + i, ox + i, oy + i, oz + i, ow ? ow + i : nullptr, n - i);
+}
+#endif
+
+#if defined(MATH3D_X86)
+// 8 points per iteration in one 8-wide group
+MATH3D_TARGET_AVX2
+inline void Mat_MulVecBatch_AVX2(const mat4x4& m, const float* x, const float* y, const float* z,
+                                 float* ox, float* oy, float* oz, float* ow, size_t n) {
+    __m256 c[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int k = 0; k < 4; k++) c[r][k] = _mm256_set1_ps(m.m[r][k]);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+        for (int k = 0; k < 4; k++) {
+            float* out = k == 0 ? ox : k == 1 ? oy : k == 2 ? oz : ow;
+            if (!out) continue;
+            __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, c[0][k]),
+                                     _mm256_mul_ps(vy, c[1][k])), _mm256_mul_ps(vz, c[2][k])), c[3][k]);
+            _mm256_storeu_ps(out + i, r);
+        }
+    }
+    Mat_MulVecBatch_Scalar(m, x + i, y + i, z + i, ox + i, oy + i, oz + i, ow ? ow + i : nullptr, n - i);
+}
+#endif
+
+// Transform n points: (ox, oy, oz, ow)[i] = (x, y, z, 1)[i] * m. ow may be null.
+// Output streams may alias the input streams.
+inline void Mat_MulVecBatch(const mat4x4& m, const float* x, const float* y, const float* z,
+                            float* ox, float* oy, float* oz, float* ow, size_t n) {
+    switch (Math_SimdLevel()) {
+#if defined(MATH3D_X86)
+        case SIMD_AVX2: Mat_MulVecBatch_AVX2(m, x, y, z, ox, oy, oz, ow, n); return;
+#endif
+#if defined(MATH3D_SSE2)
+        case SIMD_SSE2: Mat_MulVecBatch_SSE2(m, x, y, z, ox, oy, oz, ow, n); return;
+#endif
+        default: Mat_MulVecBatch_Scalar(m, x, y, z, ox, oy, oz, ow, n); return;
+    }
+}
+
+// ============== Affine Batch Operations ==============
+// Same contract as Mat_MulVecBatch for a mat4x3: 9 multiplies and 9 adds
+// per point, no w output.
+
+inline void Aff_MulVecBatch_Scalar(const mat4x3& m, const float* x, const float* y, const float* z,
+                                   float* ox, float* oy, float* oz, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        float vx = x[i], vy = y[i], vz = z[i];
+        ox[i] = vx * m.m[0][0] + vy * m.m[1][0] + vz * m.m[2][0] + m.m[3][0];
+        oy[i] = vx * m.m[0][1] + vy * m.m[1][1] + vz * m.m[2][1] + m.m[3][1];
+        oz[i] = vx * m.m[0][2] + vy * m.m[1][2] + vz * m.m[2][2] + m.m[3][2];
+    }
+}
+
+#if defined(MATH3D_SSE2)
+inline void Aff_MulVecBatch_SSE2(const mat4x3& m, const float* x, const float* y, const float* z,
+                                 float* ox, float* oy, float* oz, size_t n) {
+    __m128 c[4][3];
+    for (int r = 0; r < 4; r++)
+        for (int k = 0; k < 3; k++) c[r][k] = _mm_set1_ps(m.m[r][k]);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (size_t j = i; j < i + 8; j += 4) {
+            __m128 vx = _mm_loadu_ps(x + j), vy = _mm_loadu_ps(y + j), vz = _mm_loadu_ps(z + j);
+            float* out[3] = {ox + j, oy + j, oz + j};
+            for (int k = 0; k < 3; k++)
+                _mm_storeu_ps(out[k], _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, c[0][k]),
+                              _mm_mul_ps(vy, c[1][k])), _mm_mul_ps(vz, c[2][k])), c[3][k]));
+        }
+    }
+    Aff_MulVecBatch_Scalar(m, x + i, y + i, z + i, ox + i, oy + i, oz + i, n - i);
+}
+#endif
+
+#if defined(MATH3D_X86)
+MATH3D_TARGET_AVX2
+inline void Aff_MulVecBatch_AVX2(const mat4x3& m, const float* x, const float* y, const float* z,
+                                 float* ox, float* oy, float* oz, size_t n) {
+    __m256 c[4][3];
+    for (int r = 0; r < 4; r++)
+        for (int k = 0; k < 3; k++) c[r][k] = _mm256_set1_ps(m.m[r][k]);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+        float* out[3] = {ox + i, oy + i, oz + i};
+        for (int k = 0; k < 3; k++)
+            _mm256_storeu_ps(out[k], _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, c[0][k]),
+                             _mm256_mul_ps(vy, c[1][k])), _mm256_mul_ps(vz, c[2][k])), c[3][k]));
+    }
+    Aff_MulVecBatch_Scalar(m, x + i, y + i, z + i, ox + i, oy + i, oz + i, n - i);
+}
+#endif
+
+// Transform n points by an affine matrix. Output streams may alias the inputs.
+inline void Aff_MulVecBatch(const mat4x3& m, const float* x, const float* y, const float* z,
+                            float* ox, float* oy, float* oz, size_t n) {
+    switch (Math_SimdLevel()) {
+#if defined(MATH3D_X86)
+        case SIMD_AVX2: Aff_MulVecBatch_AVX2(m, x, y, z, ox, oy, oz, n); return;
+#endif
+#if defined(MATH3D_SSE2)
+        case SIMD_SSE2: Aff_MulVecBatch_SSE2(m, x, y, z, ox, oy, oz, n); return;
+#endif
+        default: Aff_MulVecBatch_Scalar(m, x, y, z, ox, oy, oz, n); return;
+    }
+}